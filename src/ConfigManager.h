@@ -10,6 +10,8 @@ struct HttpConfig
     int port{};
     size_t buffer_size{};
     int max_thread{};
+    int blocking_threads{};
+    int buffer_pool_size{};
 };
 
 struct HttpsConfig
@@ -32,6 +34,13 @@ struct WebDavConfig
     std::string prefix;
     std::string data_path;
     int max_recurse_depth{};
+    int traversal_threads{};
+    int directory_cache_size{};
+    bool watch_data_path{};
+    int sync_journal_size{100000};
+    int sync_page_size{1000};
+    int watch_timeout{60};
+    int watch_queue_size{256};
     std::string realm;
     std::string verification;
     std::vector<WebDavUser> users;
@@ -49,6 +58,10 @@ struct EngineConfig
 {
     std::string etag;
     std::string prop;
+    int cache_size{};
+    std::string cache_mode{"write-through"};
+    std::string etag_algorithm{"sha256"};
+    int etag_threads{};
 };
 
 struct DataConfig
@@ -56,6 +69,7 @@ struct DataConfig
     std::string sqlite_db;
     std::string etag_data;
     std::string prop_data;
+    int journal_compact_size{16};
 };
 
 struct Config
@@ -92,6 +106,8 @@ public:
     [[nodiscard]] uint16_t GetHttpPort() const noexcept;
     [[nodiscard]] uint16_t GetHttpMaxThread() const noexcept;
     [[nodiscard]] size_t GetHttpBufferSize() const noexcept;
+    [[nodiscard]] size_t GetHttpBlockingThreads() const noexcept;
+    [[nodiscard]] size_t GetHttpBufferPoolSize() const noexcept;
     [[nodiscard]] bool GetHttpsEnabled() const noexcept;
     [[nodiscard]] uint16_t GetHttpsPort() const noexcept;
     [[nodiscard]] bool GetHttpsOnly() const noexcept;
@@ -104,6 +120,13 @@ public:
     [[nodiscard]] const std::filesystem::path& GetWebDavAbsoluteDataPath() const noexcept;
     [[nodiscard]] std::filesystem::path GetWebDavAbsoluteDataPath(std::string_view url) const noexcept;
     [[nodiscard]] int8_t GetWebDavMaxRecurseDepth() const noexcept;
+    [[nodiscard]] size_t GetWebDavTraversalThreads() const noexcept;
+    [[nodiscard]] size_t GetWebDavDirectoryCacheSize() const noexcept;
+    [[nodiscard]] bool GetWebDavWatchDataPath() const noexcept;
+    [[nodiscard]] size_t GetWebDavSyncJournalSize() const noexcept;
+    [[nodiscard]] size_t GetWebDavSyncPageSize() const noexcept;
+    [[nodiscard]] int GetWebDavWatchTimeout() const noexcept;
+    [[nodiscard]] size_t GetWebDavWatchQueueSize() const noexcept;
     [[nodiscard]] const std::string& GetWebDavRealm() const noexcept;
     [[nodiscard]] const std::string& GetWebDavVerification() const noexcept;
     [[nodiscard]] auto GetWebDavUser(const std::string& user) const noexcept -> std::optional<WebDavUser>;
@@ -113,9 +136,14 @@ public:
     [[nodiscard]] const std::string& GetRedisPassword() const noexcept;
     [[nodiscard]] const std::string& GetETagEngine() const noexcept;
     [[nodiscard]] const std::string& GetPropEngine() const noexcept;
+    [[nodiscard]] size_t GetEngineCacheSize() const noexcept;
+    [[nodiscard]] const std::string& GetEngineCacheMode() const noexcept;
+    [[nodiscard]] const std::string& GetEngineETagAlgorithm() const noexcept;
+    [[nodiscard]] size_t GetEngineETagThreads() const noexcept;
     [[nodiscard]] const std::filesystem::path& GetSQLiteDB() const noexcept;
     [[nodiscard]] const std::filesystem::path& GetETagData() const noexcept;
     [[nodiscard]] const std::filesystem::path& GetPropData() const noexcept;
+    [[nodiscard]] uint64_t GetDataJournalCompactSize() const noexcept;
 
 private:
     void CreateDefaultConfig() const;
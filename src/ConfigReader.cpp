@@ -1,9 +1,11 @@
 #include "ConfigManager.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <thread>
 #include <unordered_set>
 
 #include "iguana/json_reader.hpp"
@@ -28,6 +30,8 @@ inline void CheckHttpConfig(const HttpConfig& http_config)
     assert(std::in_range<uint16_t>(http_config.port) && "[http.port] Must be within the range of [0-65535]");
     assert((http_config.buffer_size >= 1024) && "[http.buffer_size] Must be >= 1024");
     assert(std::in_range<uint8_t>(http_config.max_thread) && "[http.max_thread] Must be within the range of [0-65535]");
+    assert(std::in_range<uint8_t>(http_config.blocking_threads) && "[http.blocking_threads] Must be within the range of [0-255]");
+    assert((http_config.buffer_pool_size >= 0) && "[http.buffer_pool_size] Must be >= 0");
 }
 
 inline void CheckHttpsConfig(const HttpsConfig& https_config)
@@ -66,6 +70,12 @@ inline void CheckWebDavConfig(const WebDavConfig& webdav_config, std::filesystem
     }
 
     assert(std::in_range<int8_t>(webdav_config.max_recurse_depth) && "[webdav.max_recurse_depth] Must be within the range of [0-255]");
+    assert(std::in_range<uint8_t>(webdav_config.traversal_threads) && "[webdav.traversal_threads] Must be within the range of [0-255]");
+    assert((webdav_config.directory_cache_size >= 0) && "[webdav.directory_cache_size] Must be >= 0");
+    assert((webdav_config.sync_journal_size >= 1) && "[webdav.sync_journal_size] Must be >= 1");
+    assert((webdav_config.sync_page_size >= 1) && "[webdav.sync_page_size] Must be >= 1");
+    assert((webdav_config.watch_timeout >= 1) && "[webdav.watch_timeout] Must be >= 1");
+    assert((webdav_config.watch_queue_size >= 1) && "[webdav.watch_queue_size] Must be >= 1");
     assert(!webdav_config.realm.empty() && "[webdav.realm] Cannot be empty");
     assert((webdav_config.verification == "basic" || webdav_config.verification == "digest") &&
            "[webdav.verification] Must be one of them [basic|digest]");
@@ -90,6 +100,17 @@ inline void CheckEngineConfig(const EngineConfig& engine_config)
     std::unordered_set<std::string> engine_list{"memory", "sqlite", "redis"};
     assert(engine_list.contains(engine_config.etag) && "[engine.etag] Must be one of them [memory|sqlite|redis]");
     assert(engine_list.contains(engine_config.prop) && "[engine.prop] Must be one of them [memory|sqlite|redis]");
+    assert((engine_config.cache_size >= 0) && "[engine.cache_size] Must be >= 0");
+    assert((engine_config.cache_mode == "write-through" || engine_config.cache_mode == "write-back") &&
+           "[engine.cache_mode] Must be one of them [write-through|write-back]");
+    assert((engine_config.etag_algorithm == "sha256" || engine_config.etag_algorithm == "blake3" || engine_config.etag_algorithm == "xxh3") &&
+           "[engine.etag_algorithm] Must be one of them [sha256|blake3|xxh3]");
+    assert(std::in_range<uint8_t>(engine_config.etag_threads) && "[engine.etag_threads] Must be within the range of [0-255]");
+}
+
+inline void CheckDataConfig(const DataConfig& data_config)
+{
+    assert((data_config.journal_compact_size >= 1) && "[data.journal_compact_size] Must be >= 1");
 }
 
 ConfigManager::ConfigManager(const std::filesystem::path& config_file_path) : config_file_path_(config_file_path)
@@ -119,7 +140,8 @@ ConfigManager::ConfigManager(const std::filesystem::path& config_file_path) : co
     // Check EngineConfig
     CheckEngineConfig(config_.engine);
 
-    // The engine will create DataConfig, so it is not checked here.
+    // The engine will create the data files, so only the journal is checked here.
+    CheckDataConfig(config_.data);
 }
 
 void ConfigManager::SaveConfig() const
@@ -205,6 +227,8 @@ void ConfigManager::CreateDefaultConfig() const
     config.http.port = 8110;
     config.http.buffer_size = 1024;
     config.http.max_thread = 0;
+    config.http.blocking_threads = 0;
+    config.http.buffer_pool_size = 64;
 
     config.https.enable = false;
     config.https.port = 8111;
@@ -215,6 +239,13 @@ void ConfigManager::CreateDefaultConfig() const
     config.webdav.prefix = "/webdav";
     config.webdav.data_path = "./data";
     config.webdav.max_recurse_depth = 4;
+    config.webdav.traversal_threads = 0;
+    config.webdav.directory_cache_size = 64;
+    config.webdav.watch_data_path = true;
+    config.webdav.sync_journal_size = 100000;
+    config.webdav.sync_page_size = 1000;
+    config.webdav.watch_timeout = 60;
+    config.webdav.watch_queue_size = 256;
     config.webdav.realm = "WEBDAV_REALM";
     config.webdav.verification = "basic";
     config.webdav.users.emplace_back("test", "passw0rd");
@@ -226,10 +257,15 @@ void ConfigManager::CreateDefaultConfig() const
 
     config.engine.etag = "sqlite";
     config.engine.prop = "sqlite";
+    config.engine.cache_size = 32;
+    config.engine.cache_mode = "write-through";
+    config.engine.etag_algorithm = "sha256";
+    config.engine.etag_threads = 0;
 
     config.data.sqlite_db = "./metadata/data.db";
     config.data.etag_data = "./metadata/etag.db";
     config.data.prop_data = "./metadata/prop.db";
+    config.data.journal_compact_size = 16;
 
     std::ofstream file(config_file_path_, std::ios::out | std::ios::trunc);
     if (!file.is_open())
@@ -268,6 +304,23 @@ size_t ConfigManager::GetHttpBufferSize() const noexcept
     return config_.http.buffer_size;
 }
 
+size_t ConfigManager::GetHttpBufferPoolSize() const noexcept
+{
+    // MiB -> bytes
+    return static_cast<size_t>(config_.http.buffer_pool_size) * 1024 * 1024;
+}
+
+size_t ConfigManager::GetHttpBlockingThreads() const noexcept
+{
+    // 0 means two per core, these threads mostly sit in syscalls waiting for the disk or the database
+    if (config_.http.blocking_threads <= 0)
+    {
+        return std::max<size_t>(std::thread::hardware_concurrency() * 2, 2);
+    }
+
+    return static_cast<size_t>(config_.http.blocking_threads);
+}
+
 bool ConfigManager::GetHttpsEnabled() const noexcept
 {
     return config_.https.enable;
@@ -355,6 +408,48 @@ int8_t ConfigManager::GetWebDavMaxRecurseDepth() const noexcept
     return static_cast<int8_t>(config_.webdav.max_recurse_depth);
 }
 
+size_t ConfigManager::GetWebDavTraversalThreads() const noexcept
+{
+    // 0 means one per core, a directory walk is mostly waiting on stat so more rarely helps
+    if (config_.webdav.traversal_threads <= 0)
+    {
+        return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    return static_cast<size_t>(config_.webdav.traversal_threads);
+}
+
+size_t ConfigManager::GetWebDavDirectoryCacheSize() const noexcept
+{
+    // MiB -> bytes
+    return static_cast<size_t>(config_.webdav.directory_cache_size) * 1024 * 1024;
+}
+
+bool ConfigManager::GetWebDavWatchDataPath() const noexcept
+{
+    return config_.webdav.watch_data_path;
+}
+
+size_t ConfigManager::GetWebDavSyncJournalSize() const noexcept
+{
+    return static_cast<size_t>(config_.webdav.sync_journal_size);
+}
+
+size_t ConfigManager::GetWebDavSyncPageSize() const noexcept
+{
+    return static_cast<size_t>(config_.webdav.sync_page_size);
+}
+
+int ConfigManager::GetWebDavWatchTimeout() const noexcept
+{
+    return config_.webdav.watch_timeout;
+}
+
+size_t ConfigManager::GetWebDavWatchQueueSize() const noexcept
+{
+    return static_cast<size_t>(config_.webdav.watch_queue_size);
+}
+
 const std::string& ConfigManager::GetWebDavRealm() const noexcept
 {
     return config_.webdav.realm;
@@ -407,6 +502,33 @@ const std::string& ConfigManager::GetPropEngine() const noexcept
     return config_.engine.prop;
 }
 
+size_t ConfigManager::GetEngineCacheSize() const noexcept
+{
+    // MiB -> bytes
+    return static_cast<size_t>(config_.engine.cache_size) * 1024 * 1024;
+}
+
+const std::string& ConfigManager::GetEngineCacheMode() const noexcept
+{
+    return config_.engine.cache_mode;
+}
+
+const std::string& ConfigManager::GetEngineETagAlgorithm() const noexcept
+{
+    return config_.engine.etag_algorithm;
+}
+
+size_t ConfigManager::GetEngineETagThreads() const noexcept
+{
+    // 0 means one per core, only large files hashed with blake3 are split over them
+    if (config_.engine.etag_threads <= 0)
+    {
+        return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    return static_cast<size_t>(config_.engine.etag_threads);
+}
+
 const std::filesystem::path& ConfigManager::GetSQLiteDB() const noexcept
 {
     static std::filesystem::path path = config_.data.sqlite_db;
@@ -424,3 +546,9 @@ const std::filesystem::path& ConfigManager::GetPropData() const noexcept
     static std::filesystem::path path = config_.data.prop_data;
     return path;
 }
+
+uint64_t ConfigManager::GetDataJournalCompactSize() const noexcept
+{
+    // MiB -> bytes
+    return static_cast<uint64_t>(config_.data.journal_compact_size) * 1024 * 1024;
+}
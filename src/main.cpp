@@ -1,6 +1,8 @@
+#include <cstdint>
 #include <exception>
 #include <stdexcept>
 #include <locale>
+#include <string>
 
 #include <cinatra/coro_http_server.hpp>
 
@@ -19,11 +21,55 @@
 #include "routes/webdav/propfind.h"
 #include "routes/webdav/proppatch.h"
 #include "routes/webdav/put.h"
+#include "routes/webdav/report.h"
 #include "routes/webdav/unlock.h"
 
 #include "ConfigManager.h"
+#include "iguana/json_writer.hpp"
 #include "logger.hpp"
 #include "section/RequireXMLBody.h"
+#include "services/DirectoryCacheService.h"
+#include "services/FileETagServiceFactory.h"
+#include "services/FilePropServiceFactory.h"
+#include "services/FileWatcherService.h"
+#include "services/NotificationService.h"
+#include "services/file_etag/HashScheduler.h"
+#include "utils/buffer_pool.h"
+
+struct DirectoryCacheStatus
+{
+    uint64_t memory_usage = 0;
+};
+
+// counters of the caches, buffers, the file watcher and the watch requests
+// a growing watcher.queue_overflows means fs.inotify.max_queued_events is too small
+struct ServerStatus
+{
+    FileWatcher::Stats watcher;
+    DirectoryCacheStatus directory_cache;
+    utils::BufferPoolStats buffer_pool;
+    utils::CacheStats etag_cache;
+    utils::CacheStats prop_cache;
+    FileETagService::HashSchedulerStats etag_hashing;
+    Notification::NotificationStats watch;
+};
+
+// served behind the same verification as the webdav routes, the counters tell what is stored and how busy it is
+static void server_status(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+{
+    const ServerStatus status{FileWatcher::Service::GetInstance().GetStats(),
+                              {DirectoryCache::Service::GetInstance().GetMemoryUsage()},
+                              utils::BufferPool::GetInstance().GetStats(),
+                              FileETagService::GetCacheStats(),
+                              FilePropService::GetCacheStats(),
+                              FileETagService::HashScheduler::GetInstance().GetStats(),
+                              Notification::Service::GetInstance().GetStats()};
+
+    std::string body;
+    iguana::to_json(status, body);
+    res.set_content_type<cinatra::resp_content_type::json>();
+    res.set_status_and_content(cinatra::status_type::ok, std::move(body));
+}
 
 int main()
 {
@@ -55,6 +101,8 @@ int main()
             app.set_http_handler<MOVE>(webdav_prefix, R::MOVE, Section::BasicAuth{});
             app.set_http_handler<LOCK>(webdav_prefix, R::LOCK, Section::BasicAuth{}, Section::RequireXMLBody{});
             app.set_http_handler<UNLOCK>(webdav_prefix, R::UNLOCK, Section::BasicAuth{});
+            app.set_http_handler<REPORT>(webdav_prefix, R::REPORT, Section::BasicAuth{}, Section::RequireXMLBody{});
+            app.set_http_handler<GET>("/status", server_status, Section::BasicAuth{});
         }
         else if (verify == "digest")
         {
@@ -71,6 +119,8 @@ int main()
             app.set_http_handler<MOVE>(webdav_prefix, R::MOVE, Section::DigestAuth{});
             app.set_http_handler<LOCK>(webdav_prefix, R::LOCK, Section::DigestAuth{}, Section::RequireXMLBody{});
             app.set_http_handler<UNLOCK>(webdav_prefix, R::UNLOCK, Section::DigestAuth{});
+            app.set_http_handler<REPORT>(webdav_prefix, R::REPORT, Section::DigestAuth{}, Section::RequireXMLBody{});
+            app.set_http_handler<GET>("/status", server_status, Section::DigestAuth{});
         }
         else
         {
@@ -83,6 +133,15 @@ int main()
             res.set_status_and_content(status_type::ok, "<h1>The server has been started.</h1>");
         });
 
+        if (conf.GetWebDavWatchDataPath())
+        {
+            FileWatcher::Service::GetInstance().Start();
+        }
+
+        // the engines connect (or open their data) here rather than on an I/O thread serving the first request
+        FileETagService::GetService();
+        FilePropService::GetService();
+
         LOG_INFO_FMT("Server running at {}://{}:{}", conf.GetHttpsEnabled() ? "https" : "http", conf.GetHttpHost(),
                      conf.GetHttpsEnabled() ? conf.GetHttpsPort() : conf.GetHttpPort());
 
@@ -7,6 +7,8 @@
 #include "http_exceptions.hpp"
 #include "logger.hpp"
 #include "services/FileLockService.h"
+#include "services/MutationService.h"
+#include "utils/blocking.h"
 
 static inline std::string GetLockToken(std::string if_header)
 {
@@ -23,92 +25,98 @@ static inline std::string GetLockToken(std::string if_header)
 namespace Routes::WebDAV
 {
 
-void COPY(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> COPY(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
     const auto& conf = ConfigManager::GetInstance();
 
     try
     {
-        // source
         fs::path source_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-        if (!fs::exists(source_path))
-        {
-            throw NotFoundException("Source not found");
-        }
+        const std::string_view dest_header = req.get_header_value("Destination");
+        const std::string_view overwite_header = req.get_header_value("Overwrite");
 
         // if header
         const std::string if_header_str{req.get_header_value("If")};
         std::string lock_token = GetLockToken(if_header_str);
 
-        // is locked?
-        static auto& lock_service = FileLock::Service::GetInstance();
-        if (lock_service.IsLocked(source_path, true))
-        {
-            const auto* lock_list = lock_service.GetAllLock(source_path);
-            for (const auto& lock : *lock_list)
+        // a recursive copy can take a long time, none of it may happen on the I/O thread
+        co_await utils::blocking::run([&]() {
+            // source
+            if (!fs::exists(source_path))
             {
-                if (lock.second->scope == FileLock::LockScope::EXCLUSIVE || lock.second->type == FileLock::LockType::READ)
+                throw NotFoundException("Source not found");
+            }
+
+            // is locked?
+            static auto& lock_service = FileLock::Service::GetInstance();
+            if (lock_service.IsLocked(source_path, true))
+            {
+                for (const auto& lock : lock_service.GetAllLock(source_path))
                 {
-                    throw LockedException("Source is locked");
+                    if (lock.second.scope == FileLock::LockScope::EXCLUSIVE || lock.second.type == FileLock::LockType::READ)
+                    {
+                        throw LockedException("Source is locked");
+                    }
                 }
             }
-        }
-
-        // destination header
-        const std::string_view& dest_header = req.get_header_value("Destination");
-        if (dest_header.empty())
-        {
-            throw BadRequestException("Destination header not found");
-        }
-
-        // copy in place?
-        fs::path dest_path = conf.GetWebDavAbsoluteDataPath(dest_header);
-        if (source_path == dest_path)
-        {
-            throw ConflictException("Source and Destination are the same");
-        }
-
-        // destination no exists
-        if (!fs::exists(dest_path))
-        {
-            if (fs::is_directory(source_path))
+
+            // destination header
+            if (dest_header.empty())
+            {
+                throw BadRequestException("Destination header not found");
+            }
+
+            // copy in place?
+            fs::path dest_path = conf.GetWebDavAbsoluteDataPath(dest_header);
+            if (source_path == dest_path)
+            {
+                throw ConflictException("Source and Destination are the same");
+            }
+            MutationService::Intent intent{dest_path};
+
+            // destination no exists
+            if (!fs::exists(dest_path))
             {
-                fs::copy(source_path, dest_path, fs::copy_options::recursive);
+                if (fs::is_directory(source_path))
+                {
+                    fs::copy(source_path, dest_path, fs::copy_options::recursive);
+                }
+                else
+                {
+                    fs::copy(source_path, dest_path);
+                }
+                MutationService::Commit(dest_path, MutationService::Op::CREATE);
+                return;
+            }
+
+            // Overwrite?
+            if (overwite_header.empty())
+            {
+                throw BadRequestException("Overwrite header not found");
+            }
+
+            if (overwite_header[0] == 'F')
+            {
+                throw PreconditionFailedException("Destination already exists");
+            }
+
+            if (overwite_header[0] != 'T')
+            {
+                throw BadRequestException("Invalid Overwrite header");
+            }
+
+            if (fs::is_directory(dest_path))
+            {
+                fs::copy(source_path, dest_path, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
             }
             else
             {
-                fs::copy(source_path, dest_path);
+                fs::copy(source_path, dest_path, fs::copy_options::overwrite_existing);
             }
-            res.set_status(cinatra::status_type::ok);
-            return;
-        }
-
-        // Overwrite?
-        const std::string_view& overwite_header = req.get_header_value("Overwrite");
-        if (overwite_header.empty())
-        {
-            throw BadRequestException("Overwrite header not found");
-        }
-
-        if (overwite_header[0] == 'F')
-        {
-            throw PreconditionFailedException("Destination already exists");
-        }
-
-        if (overwite_header[0] != 'T')
-        {
-            throw BadRequestException("Invalid Overwrite header");
-        }
-
-        if (fs::is_directory(dest_path))
-        {
-            fs::copy(source_path, dest_path, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
-        }
-        else
-        {
-            fs::copy(source_path, dest_path, fs::copy_options::overwrite_existing);
-        }
+            MutationService::Commit(dest_path, MutationService::Op::MODIFY);
+        });
+
         res.set_status(cinatra::status_type::ok);
     }
     catch (const NotFoundException& err)
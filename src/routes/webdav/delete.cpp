@@ -5,12 +5,14 @@
 #include "ConfigManager.h"
 #include "http_exceptions.hpp"
 #include "services/FileLockService.h"
+#include "services/MutationService.h"
 #include "logger.hpp"
+#include "utils/blocking.h"
 
 namespace Routes::WebDAV
 {
 
-void DEL(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> DEL(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
     static const auto& conf = ConfigManager::GetInstance();
@@ -18,21 +20,28 @@ void DEL(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
     try
     {
         fs::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-        if (!std::filesystem::exists(abs_path))
-        {
-            throw BadRequestException("File not found");
-        }
-
-        static auto& lock_service = FileLock::Service::GetInstance();
-        if (lock_service.IsLocked(abs_path))
-        {
-            throw LockedException("File is locked");
-        }
-
-        if (fs::is_directory(abs_path))
-            fs::remove_all(abs_path);
-        else
-            fs::remove(abs_path);
+
+        // a recursive delete of a large tree would stall every connection of the I/O thread
+        co_await utils::blocking::run([&]() {
+            if (!std::filesystem::exists(abs_path))
+            {
+                throw BadRequestException("File not found");
+            }
+
+            static auto& lock_service = FileLock::Service::GetInstance();
+            if (lock_service.IsLocked(abs_path))
+            {
+                throw LockedException("File is locked");
+            }
+
+            MutationService::Intent intent{abs_path};
+            if (fs::is_directory(abs_path))
+                fs::remove_all(abs_path);
+            else
+                fs::remove(abs_path);
+            MutationService::Commit(abs_path, MutationService::Op::REMOVE);
+        });
+
         res.set_status(cinatra::status_type::ok);
     }
     catch (const BadRequestException& err)
@@ -1,78 +1,187 @@
 #include "get.h"
+#include <chrono>
 #include <ctime>
 #include <filesystem>
-#include <fstream>
+#include <format>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 
-#include <async_simple/coro/SyncAwait.h>
 #include <cinatra/coro_http_connection.hpp>
-#include <pugixml.hpp>
 
 #include "ConfigManager.h"
 #include "http_exceptions.hpp"
 #include "logger.hpp"
+#include "routes/webdav/watch.h"
 #include "services/FileETagServiceFactory.h"
+#include "utils/blocking.h"
+#include "utils/file.h"
+#include "utils/http.h"
+#include "utils/range.h"
 
-inline async_simple::coro::Lazy<void> SendFile(cinatra::coro_http_response& res, const std::filesystem::path& path)
+constexpr std::string_view MULTIPART_BOUNDARY = "DAVSYNC_BYTERANGES_BOUNDARY";
+
+inline std::string ContentRange(const utils::range::ByteRange& range, uint64_t file_size)
+{
+    return std::format("bytes {}-{}/{}", range.first, range.last, file_size);
+}
+
+/*
+    Writes the response head and the body (whole file, one range or multipart/byteranges) by hand, bypassing cinatra's
+    response buffer. The Content-Length is always known up front, multipart bodies are streamed part by part.
+ */
+inline async_simple::coro::Lazy<void> SendFile(cinatra::coro_http_request& req, cinatra::coro_http_response& res,
+                                               const std::filesystem::path& path, const std::string& etag)
 {
-    using namespace cinatra;
+    namespace fs = std::filesystem;
+    using utils::range::ByteRange;
+
+    std::optional<utils::file::RandomAccessFile> file;
+    uint64_t file_size = 0;
+    std::time_t file_time = 0;
+    co_await utils::blocking::run([&]() {
+        file.emplace(path);
+        if (!file->is_open())
+        {
+            throw std::runtime_error("Unable to open the specified file");
+        }
+
+        file_size = fs::file_size(path);
+        file_time = std::chrono::system_clock::to_time_t(std::chrono::clock_cast<std::chrono::system_clock>(fs::last_write_time(path)));
+    });
+    const std::string last_modified = utils::http::format_http_date(file_time);
+
+    // Range is ignored when If-Range does not describe the current file anymore
+    std::optional<std::vector<ByteRange>> ranges;
+    if (const std::string_view range_header = req.get_header_value("Range"); !range_header.empty())
+    {
+        if (utils::range::if_range_matches(req.get_header_value("If-Range"), etag, file_time))
+        {
+            ranges = utils::range::parse_range(range_header, file_size);
+        }
+    }
+
+    int status = 200;
+    uint64_t content_length = file_size;
+    utils::http::HeaderListT headers{
+        {"Accept-Ranges", "bytes"},
+        {"ETag", etag},
+        {"Last-Modified", last_modified},
+    };
+    std::vector<std::string> part_heads;
+
+    if (!ranges.has_value())
+    {
+        headers.emplace_back("Content-Type", "application/octet-stream");
+    }
+    else if (ranges->empty())
+    {
+        status = 416;
+        content_length = 0;
+        headers.emplace_back("Content-Range", std::format("bytes */{}", file_size));
+    }
+    else if (ranges->size() == 1)
+    {
+        status = 206;
+        content_length = ranges->front().length();
+        headers.emplace_back("Content-Type", "application/octet-stream");
+        headers.emplace_back("Content-Range", ContentRange(ranges->front(), file_size));
+    }
+    else
+    {
+        status = 206;
+        content_length = 0;
+        for (const auto& range : *ranges)
+        {
+            part_heads.push_back(std::format("\r\n--{}\r\nContent-Type: application/octet-stream\r\nContent-Range: {}\r\n\r\n",
+                                             MULTIPART_BOUNDARY, ContentRange(range, file_size)));
+            content_length += part_heads.back().size() + range.length();
+        }
+        content_length += MULTIPART_BOUNDARY.size() + 8; // "\r\n--" boundary "--\r\n"
+        headers.emplace_back("Content-Type", std::format("multipart/byteranges; boundary={}", MULTIPART_BOUNDARY));
+    }
+    headers.emplace_back("Content-Length", std::to_string(content_length));
 
-    std::ifstream ifs(path, std::ios::binary);
-    res.set_format_type(format_type::chunked);
+    // the response is written by hand from here on
+    res.set_delay(true);
 
-    coro_http_connection* const conn = res.get_conn();
-    if (!(co_await conn->begin_chunked()))
+    cinatra::coro_http_connection* const conn = res.get_conn();
+    if (!(co_await conn->write_data(utils::http::build_response_head(status, headers))))
     {
         co_return;
     }
 
-    const auto& conf = ConfigManager::GetInstance();
-    const size_t BUFFER_SIZE = conf.GetHttpBufferSize();
-    std::vector<char> buffer(BUFFER_SIZE);
-    size_t readed = 0;
-    bool ok;
-    while ((readed = ifs.readsome(&buffer[0], BUFFER_SIZE)) > 0)
-    {
-        buffer.resize(readed);
-        ok = co_await conn->write_chunked({buffer.begin(), buffer.end()});
-        if (!ok)
+    bool ok = true;
+    if (status == 416)
+    {
+        co_return;
+    }
+
+    if (!ranges.has_value())
+    {
+        ok = co_await utils::http::send_file_range(conn, *file, 0, file_size);
+    }
+    else if (ranges->size() == 1)
+    {
+        ok = co_await utils::http::send_file_range(conn, *file, ranges->front().first, ranges->front().length());
+    }
+    else
+    {
+        for (size_t i = 0; ok && i < ranges->size(); ++i)
         {
-            co_return;
+            ok = co_await conn->write_data(part_heads[i]);
+            ok = ok && co_await utils::http::send_file_range(conn, *file, (*ranges)[i].first, (*ranges)[i].length());
         }
+        ok = ok && co_await conn->write_data(std::format("\r\n--{}--\r\n", MULTIPART_BOUNDARY));
+    }
+
+    if (!ok)
+    {
+        // the client has been promised more bytes than it got, the connection can not be reused
+        conn->close();
     }
-    co_return;
 }
 
 namespace Routes::WebDAV
 {
 
-void GET(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> GET(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
     const auto& conf = ConfigManager::GetInstance();
 
+    // a collection can not be read, only watched for changes below it
+    if (!req.get_query_value("watch").empty())
+    {
+        co_await WATCH(req, res);
+        co_return;
+    }
+
     try
     {
         fs::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-        if (!fs::exists(abs_path))
-        {
-            throw NotFoundException("File not found.");
-        }
+        co_await utils::blocking::run([&abs_path]() {
+            const fs::file_status status = fs::status(abs_path);
+            if (!fs::exists(status))
+            {
+                throw NotFoundException("File not found.");
+            }
 
-        if (fs::is_directory(abs_path))
-        {
-            throw BadRequestException("Directory not allowed.");
-        }
+            if (fs::is_directory(status))
+            {
+                throw BadRequestException("Directory not allowed.");
+            }
 
-        if (!fs::is_regular_file(abs_path))
-        {
-            throw BadRequestException("Not a regular file.");
-        }
+            if (!fs::is_regular_file(status))
+            {
+                throw BadRequestException("Not a regular file.");
+            }
+        });
 
-        auto& etag_service = FileETagService::GetService();
-        std::string etag = etag_service.Set(abs_path);
+        // only rehashes when the file changed since the etag was stored
+        static auto& etag_service = FileETagService::GetService();
+        const std::string etag = co_await etag_service.GetValidatedAsync(abs_path);
         if (etag.empty())
         {
             throw std::runtime_error("Failed to compute ETag.");
@@ -85,9 +194,8 @@ void GET(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
         const std::string_view& client_etag = req.get_header_value("If-None-Match");
         if (client_etag.empty() || client_etag != etag)
         {
-            res.add_header("ETag", etag);
-            async_simple::coro::syncAwait(SendFile(res, abs_path));
-            return;
+            co_await SendFile(req, res, abs_path, etag);
+            co_return;
         }
 
         // ETag matched
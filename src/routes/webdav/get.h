@@ -2,10 +2,11 @@
 
 #include <cinatra/coro_http_request.hpp>
 #include <cinatra/coro_http_response.hpp>
+#include <async_simple/coro/Lazy.h>
 
 namespace Routes::WebDAV
 {
 
-void GET(cinatra::coro_http_request& req, cinatra::coro_http_response& res);
+async_simple::coro::Lazy<void> GET(cinatra::coro_http_request& req, cinatra::coro_http_response& res);
 
 } // namespace Routes::WebDAV
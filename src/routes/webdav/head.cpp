@@ -1,30 +1,63 @@
 #include "head.h"
+#include <ctime>
 #include <filesystem>
+#include <string>
 
 #include "ConfigManager.h"
+#include "services/FileETagServiceFactory.h"
+#include "utils/blocking.h"
 #include "utils/file.h"
 
 namespace Routes::WebDAV
 {
 
-void HEAD(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> HEAD(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
     const auto& conf = ConfigManager::GetInstance();
 
     fs::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-    if (!fs::exists(abs_path))
+
+    struct HeadInfo
     {
-        res.set_status(cinatra::status_type::not_found);
-        return;
+        bool exists = false;
+        std::string last_modified;
+        std::string etag;
+    };
+    HeadInfo info = co_await utils::blocking::run([&abs_path]() {
+        HeadInfo info{};
+        if (!fs::exists(abs_path))
+        {
+            return info;
+        }
+
+        char buffer[100];
+        std::strftime(buffer, 100, "%a, %d %b %Y %H:%M:%S GMT", utils::file::get_last_modified(abs_path));
+
+        info.exists = true;
+        info.last_modified = buffer;
+        return info;
+    });
+
+    // the etag may have to be recomputed, which reads the whole file
+    static auto& etag_service = FileETagService::GetService();
+    if (info.exists)
+    {
+        info.etag = co_await etag_service.GetValidatedAsync(abs_path);
     }
 
-    char buffer[100];
-    std::strftime(buffer, 100, "%a, %d %b %Y %H:%M:%S GMT", utils::file::get_last_modified(abs_path));
+    if (!info.exists)
+    {
+        res.set_status(cinatra::status_type::not_found);
+        co_return;
+    }
 
     res.add_header("Content-Type", "application/octet-stream");
-    res.add_header("Last-Modified", buffer);
-    res.add_header("ETag",  buffer);
+    res.add_header("Last-Modified", info.last_modified);
+    if (!info.etag.empty())
+    {
+        res.add_header("ETag", info.etag);
+    }
     res.set_status(cinatra::status_type::ok);
 }
 
@@ -19,6 +19,7 @@
 #include "http_exceptions.hpp"
 #include "logger.hpp"
 #include "services/FileLockService.h"
+#include "utils/blocking.h"
 #include "utils/webdav.h"
 
 /*
@@ -94,7 +95,7 @@ namespace Routes::WebDAV
 {
 
 // https://fullstackplayer.github.io/WebDAV-RFC4918-CN/06-%E9%94%81%E5%AE%9A.html
-void LOCK(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> LOCK(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
 
@@ -122,7 +123,9 @@ void LOCK(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
         {
             throw BadRequestException("if header missing");
         }
-        utils::webdav::check_precondition(abs_path, std::string{if_header_value});
+        co_await utils::blocking::run([&abs_path, conditions = std::string{if_header_value}]() {
+            utils::webdav::check_precondition(abs_path, conditions);
+        });
 
         // lock depth
         short lock_depth = std::numeric_limits<short>::max();
@@ -211,7 +214,7 @@ void LOCK(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
         }
 
         // if the URL is not mapped to any resource during the request, a new empty resource will be created and directly locked.
-        EnsurePathExists(abs_path);
+        co_await utils::blocking::run([&abs_path]() { EnsurePathExists(abs_path); });
 
         // create a lock
         FileLock::EntryLock lock;
@@ -5,11 +5,13 @@
 #include "ConfigManager.h"
 #include "http_exceptions.hpp"
 #include "logger.hpp"
+#include "services/MutationService.h"
+#include "utils/blocking.h"
 
 namespace Routes::WebDAV
 {
 
-void MKCOL(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> MKCOL(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
     const auto& conf = ConfigManager::GetInstance();
@@ -17,16 +19,20 @@ void MKCOL(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
     try
     {
         fs::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-        if (fs::exists(abs_path))
-        {
-            if (fs::is_directory(abs_path))
+        co_await utils::blocking::run([&]() {
+            if (fs::exists(abs_path))
             {
-                throw ConflictException("The resource already exists");
+                if (fs::is_directory(abs_path))
+                {
+                    throw ConflictException("The resource already exists");
+                }
+                throw MethodNotAllowedException("The request method is not allowed for this resource");
             }
-            throw MethodNotAllowedException("The request method is not allowed for this resource");
-        }
 
-        fs::create_directories(abs_path);
+            MutationService::Intent intent{abs_path};
+            fs::create_directories(abs_path);
+            MutationService::Commit(abs_path, MutationService::Op::CREATE);
+        });
     }
     catch (const ConflictException& err)
     {
@@ -5,11 +5,13 @@
 #include "http_exceptions.hpp"
 #include "logger.hpp"
 #include "services/FileLockService.h"
+#include "services/MutationService.h"
+#include "utils/blocking.h"
 
 namespace Routes::WebDAV
 {
 
-void MOVE(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> MOVE(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
     static const auto& conf = ConfigManager::GetInstance();
@@ -17,71 +19,81 @@ void MOVE(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
     try
     {
         fs::path source_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-        if (!fs::exists(source_path))
-        {
-            throw NotFoundException("File not found");
-        }
+        const std::string_view dest_header = req.get_header_value("Destination");
+        const std::string_view overwite_header = req.get_header_value("Overwrite");
 
-        static auto& lock_service = FileLock::Service::GetInstance();
-        if (lock_service.IsLocked(source_path))
-        {
-            throw LockedException("File is locked");
-        }
+        // moving a tree is a copy plus a remove_all, none of it may happen on the I/O thread
+        co_await utils::blocking::run([&]() {
+            if (!fs::exists(source_path))
+            {
+                throw NotFoundException("File not found");
+            }
 
-        const std::string_view& dest_header = req.get_header_value("Destination");
-        if (dest_header.empty())
-        {
-            throw BadRequestException("Destination header is empty");
-        }
+            static auto& lock_service = FileLock::Service::GetInstance();
+            if (lock_service.IsLocked(source_path))
+            {
+                throw LockedException("File is locked");
+            }
 
-        fs::path dest_path = conf.GetWebDavAbsoluteDataPath(dest_header);
-        if (source_path == dest_path)
-        {
-            throw BadRequestException("Source and Destination are the same");
-        }
+            if (dest_header.empty())
+            {
+                throw BadRequestException("Destination header is empty");
+            }
 
-        if (!fs::exists(dest_path))
-        {
-            if (fs::is_directory(source_path))
+            fs::path dest_path = conf.GetWebDavAbsoluteDataPath(dest_header);
+            if (source_path == dest_path)
             {
-                fs::copy(source_path, dest_path, fs::copy_options::recursive);
-                fs::remove_all(source_path);
+                throw BadRequestException("Source and Destination are the same");
             }
-            else
+            MutationService::Intent source_intent{source_path};
+            MutationService::Intent dest_intent{dest_path};
+
+            if (!fs::exists(dest_path))
             {
-                fs::copy(source_path, dest_path);
-                fs::remove(source_path);
+                if (fs::is_directory(source_path))
+                {
+                    fs::copy(source_path, dest_path, fs::copy_options::recursive);
+                    fs::remove_all(source_path);
+                }
+                else
+                {
+                    fs::copy(source_path, dest_path);
+                    fs::remove(source_path);
+                }
+                MutationService::Commit(source_path, MutationService::Op::REMOVE);
+                MutationService::Commit(dest_path, MutationService::Op::CREATE);
+                return;
+            }
+
+            if (overwite_header.empty())
+            {
+                throw BadRequestException("Overwrite header is empty");
             }
-            res.set_status(cinatra::status_type::ok);
-            return;
-        }
 
-        const std::string_view& overwite_header = req.get_header_value("Overwrite");
-        if (overwite_header.empty())
-        {
-            throw BadRequestException("Overwrite header is empty");
-        }
+            if (overwite_header[0] == 'F')
+            {
+                throw BadRequestException("Overwrite header is false");
+            }
 
-        if (overwite_header[0] == 'F')
-        {
-            throw BadRequestException("Overwrite header is false");
-        }
+            if (overwite_header[0] != 'T')
+            {
+                throw BadRequestException("Invalid Overwrite header");
+            }
 
-        if (overwite_header[0] != 'T')
-        {
-            throw BadRequestException("Invalid Overwrite header");
-        }
+            if (fs::is_directory(dest_path))
+            {
+                fs::copy(source_path, dest_path, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+                fs::remove_all(source_path);
+            }
+            else
+            {
+                fs::copy(source_path, dest_path, fs::copy_options::overwrite_existing);
+                fs::remove(source_path);
+            }
+            MutationService::Commit(source_path, MutationService::Op::REMOVE);
+            MutationService::Commit(dest_path, MutationService::Op::MODIFY);
+        });
 
-        if (fs::is_directory(dest_path))
-        {
-            fs::copy(source_path, dest_path, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
-            fs::remove_all(source_path);
-        }
-        else
-        {
-            fs::copy(source_path, dest_path, fs::copy_options::overwrite_existing);
-            fs::remove(source_path);
-        }
         res.set_status(cinatra::status_type::ok);
     }
     catch (const NotFoundException& err)
@@ -3,9 +3,10 @@
 namespace Routes::WebDAV
 {
 
-void POST(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> POST(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     // TODO
+    co_return;
 }
 
 } // namespace Routes::WebDAV
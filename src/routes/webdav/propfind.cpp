@@ -2,20 +2,20 @@
 
 #include <cstdint>
 #include <filesystem>
-#include <sstream>
 
-#include <pugixml.hpp>
 #include <system_error>
 
 #include "ConfigManager.h"
 #include "http_exceptions.hpp"
 #include "logger.hpp"
+#include "utils/blocking.h"
+#include "utils/multistatus.h"
 #include "utils/webdav.h"
 
 namespace Routes::WebDAV
 {
 
-void PROPFIND(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> PROPFIND(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
     const auto& conf = ConfigManager::GetInstance();
@@ -23,8 +23,9 @@ void PROPFIND(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
     try
     {
         fs::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-        bool is_file = std::filesystem::is_regular_file(abs_path);
-        if (!is_file && !std::filesystem::is_directory(abs_path))
+        const fs::file_status status = co_await utils::blocking::run([&abs_path]() { return fs::status(abs_path); });
+        bool is_file = fs::is_regular_file(status);
+        if (!is_file && !fs::is_directory(status))
         {
             throw NotFoundException("path not found");
         }
@@ -39,18 +40,29 @@ void PROPFIND(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
             depth = depth_header == "Infinity" ? conf.GetWebDavMaxRecurseDepth() : static_cast<int8_t>(std::stoi(depth_header));
         }
 
-        pugi::xml_document xml_doc;
-        pugi::xml_node root = utils::webdav::generate_multistatus_header(xml_doc);
-        utils::webdav::generate_response_list_recurse(root, abs_path, depth);
-        std::ostringstream oss;
-        xml_doc.save(oss);
+        // the document is streamed while the tree is walked, the response is written by hand from here on
+        res.set_delay(true);
 
-        res.add_header("Content-Type", "application/xml; charset=utf-8");
-        res.add_header("Allow", is_file ? "OPTIONS, GET, HEAD, PUT, DELETE, PROPFIND, PROPPATCH, COPY, MOVE, LOCK, UNLOCK"
-                                        : "OPTIONS, GET, HEAD, DELETE, PROPFIND, PROPPATCH, MKCOL, COPY, MOVE, LOCK, UNLOCK");
-        res.set_status(cinatra::status_type::multi_status);
-        res.set_content_type<cinatra::resp_content_type::xml>();
-        res.set_content(oss.str());
+        utils::webdav::MultistatusWriter writer{res.get_conn(), utils::webdav::MULTISTATUS_BUFFER_SIZE};
+        bool ok = co_await writer.Begin(
+            {{"Allow", is_file ? "OPTIONS, GET, HEAD, PUT, DELETE, PROPFIND, PROPPATCH, COPY, MOVE, LOCK, UNLOCK"
+                               : "OPTIONS, GET, HEAD, DELETE, PROPFIND, PROPPATCH, MKCOL, COPY, MOVE, LOCK, UNLOCK, REPORT"}});
+        try
+        {
+            ok = ok && co_await utils::webdav::generate_response_list_recurse(writer, abs_path, depth);
+            ok = ok && co_await writer.End();
+        }
+        catch (const std::exception& err)
+        {
+            LOG_ERROR(err.what())
+            ok = false;
+        }
+
+        // the status line is gone already, a half written body can only be reported by dropping the connection
+        if (!ok)
+        {
+            res.get_conn()->close();
+        }
     }
     catch (const NotFoundException& err)
     {
@@ -62,7 +74,7 @@ void PROPFIND(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
         LOG_INFO(err.what())
         res.set_status(cinatra::status_type::bad_request);
     }
-    catch (const std::system_error& err)
+    catch (const std::exception& err)
     {
         LOG_ERROR(err.what())
         res.set_status(cinatra::status_type::internal_server_error);
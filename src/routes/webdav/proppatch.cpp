@@ -9,13 +9,13 @@
 namespace Routes::WebDAV
 {
 
-void PROPPATCH(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> PROPPATCH(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     const std::string body{req.get_body()};
     if (body.empty())
     {
         res.set_status(cinatra::status_type::bad_request);
-        return;
+        co_return;
     }
 
     try
@@ -24,14 +24,14 @@ void PROPPATCH(cinatra::coro_http_request& req, cinatra::coro_http_response& res
         if (!doc.load_string(body.data()))
         {
             res.set_status(cinatra::status_type::bad_request);
-            return;
+            co_return;
         }
 
         pugi::xml_node root_node = doc.child("D:propertyupdate");
         if (root_node.empty())
         {
             res.set_status(cinatra::status_type::bad_request);
-            return;
+            co_return;
         }
 
         for (auto prop_node : root_node.children())
@@ -47,13 +47,13 @@ void PROPPATCH(cinatra::coro_http_request& req, cinatra::coro_http_response& res
         }
 
         res.set_status(cinatra::status_type::ok);
-        return;
+        co_return;
     }
     catch (const std::exception& err)
     {
         LOG_ERROR(err.what())
         res.set_status(cinatra::status_type::internal_server_error);
-        return;
+        co_return;
     }
 }
 
@@ -12,6 +12,8 @@
 #include "logger.hpp"
 #include "services/FileETagServiceFactory.h"
 #include "services/FileLockService.h"
+#include "services/MutationService.h"
+#include "utils/blocking.h"
 
 namespace Routes::WebDAV
 {
@@ -24,12 +26,13 @@ async_simple::coro::Lazy<void> PUT(cinatra::coro_http_request& req, cinatra::cor
     try
     {
         std::filesystem::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-        if (!fs::exists(abs_path))
+        const fs::file_status status = co_await utils::blocking::run([&abs_path]() { return fs::status(abs_path); });
+        if (!fs::exists(status))
         {
             throw NotFoundException("The specified file does not exist");
         }
 
-        if (fs::is_directory(abs_path))
+        if (fs::is_directory(status))
         {
             throw ConflictException("The specified path is a directory");
         }
@@ -40,24 +43,25 @@ async_simple::coro::Lazy<void> PUT(cinatra::coro_http_request& req, cinatra::cor
         }
 
         static auto& lock_service = FileLock::Service::GetInstance();
-        const auto* lock_list = lock_service.GetAllLock(abs_path);
-        if (lock_list != nullptr)
+        for (const auto& lock : lock_service.GetAllLock(abs_path))
         {
-            for (const auto& lock : *lock_list)
+            if (lock.second.type == FileLock::LockType::WRITE || lock.second.scope == FileLock::LockScope::EXCLUSIVE)
             {
-                if (lock.second->type == FileLock::LockType::WRITE || lock.second->scope == FileLock::LockScope::EXCLUSIVE)
-                {
-                    throw LockedException("The specified file is locked");
-                }
+                throw LockedException("The specified file is locked");
             }
         }
 
-        std::ofstream ofs(abs_path);
+        // a PUT cut short by the client still leaves a changed file, committed when the intent ends
+        MutationService::Intent intent{abs_path};
+        std::ofstream ofs{};
+        co_await utils::blocking::run([&ofs, &abs_path]() { ofs.open(abs_path, std::ios::binary | std::ios::trunc); });
         if (!ofs.is_open())
         {
             throw std::runtime_error("Unable to open the specified file");
         }
 
+        // the etag is computed from the chunks as they arrive, so the file never has to be read back
+        FileETagService::ETagHasher etag_hasher{};
         cinatra::chunked_result result{};
         while (true)
         {
@@ -67,15 +71,22 @@ async_simple::coro::Lazy<void> PUT(cinatra::coro_http_request& req, cinatra::cor
             if (result.eof)
                 break;
 
-            ofs.write(result.data.data(), result.data.size());
+            // the chunk stays valid until the next read_chunked(), which waits for this
+            co_await utils::blocking::run([&ofs, &etag_hasher, data = result.data]() {
+                ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+                etag_hasher.Update(data);
+            });
         }
 
-        ofs.flush();
-        ofs.close();
-
         // update etag
-        static auto& etag_service = FileETagService::GetService();
-        etag_service.Set(abs_path);
+        co_await utils::blocking::run([&ofs, &abs_path, &etag_hasher]() {
+            ofs.flush();
+            ofs.close();
+
+            static auto& etag_service = FileETagService::GetService();
+            etag_service.Set(abs_path, etag_hasher.Final());
+            MutationService::Commit(abs_path, MutationService::Op::MODIFY);
+        });
 
         res.set_status(cinatra::status_type::ok);
     }
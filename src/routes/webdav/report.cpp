@@ -0,0 +1,246 @@
+#include "report.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <pugixml.hpp>
+
+#include "ConfigManager.h"
+#include "http_exceptions.hpp"
+#include "logger.hpp"
+#include "services/ChangeJournalService.h"
+#include "utils/blocking.h"
+#include "utils/multistatus.h"
+#include "utils/path.h"
+#include "utils/webdav.h"
+
+constexpr std::string_view INVALID_SYNC_TOKEN_BODY =
+    R"(<?xml version="1.0" encoding="utf-8"?><D:error xmlns:D="DAV:"><D:valid-sync-token/></D:error>)";
+
+namespace Routes::WebDAV
+{
+
+struct SyncCollection
+{
+    // 0 for the initial sync
+    uint64_t token = 0;
+    bool infinite = false;
+    size_t limit = 0;
+};
+
+// clients choose whatever prefix they like for the DAV: namespace, so elements are matched by their local name
+static pugi::xml_node child_element(const pugi::xml_node& parent, const std::string_view local_name)
+{
+    for (const pugi::xml_node child : parent.children())
+    {
+        std::string_view name = child.name();
+        if (const size_t colon = name.find(':'); colon != std::string_view::npos)
+        {
+            name.remove_prefix(colon + 1);
+        }
+        if (name == local_name)
+        {
+            return child;
+        }
+    }
+    return {};
+}
+
+/*
+    <D:sync-collection xmlns:D="DAV:">
+        <D:sync-token>http://davsync/ns/sync/42</D:sync-token>
+        <D:sync-level>1</D:sync-level>
+        <D:limit><D:nresults>100</D:nresults></D:limit>
+        <D:prop>...</D:prop>
+    </D:sync-collection>
+
+    The requested properties are not looked at, every response carries the same ones PROPFIND reports.
+ */
+static std::optional<SyncCollection> parse_sync_collection(const std::string& body, const size_t page_size)
+{
+    pugi::xml_document doc;
+    if (!doc.load_string(body.c_str()))
+    {
+        throw BadRequestException("parse xml body failed");
+    }
+
+    const pugi::xml_node root = child_element(doc, "sync-collection");
+    if (root.empty())
+    {
+        throw ForbiddenException("unsupported report");
+    }
+
+    const std::string_view sync_token = child_element(root, "sync-token").text().as_string();
+    const std::optional<uint64_t> token = sync_token.empty() ? 0 : ChangeJournal::parse_sync_token(sync_token);
+    if (!token.has_value())
+    {
+        return std::nullopt;
+    }
+
+    SyncCollection sync{*token, std::string_view{child_element(root, "sync-level").text().as_string()} == "infinite", page_size};
+    if (const pugi::xml_node nresults = child_element(child_element(root, "limit"), "nresults"); !nresults.empty())
+    {
+        sync.limit = std::clamp<size_t>(nresults.text().as_ullong(), 1, page_size);
+    }
+    return sync;
+}
+
+// what a change reports, the resource as it is now or a 404 for one that is gone
+static async_simple::coro::Lazy<bool> write_change(utils::webdav::MultistatusWriter& writer, const std::filesystem::path& path,
+                                                   const std::string& journal_etag, const bool expand)
+{
+    namespace fs = std::filesystem;
+
+    std::optional<utils::webdav::ResourceInfo> info = co_await utils::blocking::run([&path, &journal_etag]() {
+        std::optional<utils::webdav::ResourceInfo> info;
+        if (const fs::directory_entry entry{path}; entry.is_directory() || entry.is_regular_file())
+        {
+            info = utils::webdav::make_resource_info(entry, utils::webdav::to_href(path, entry.is_directory()));
+            if (info->etag.empty())
+            {
+                info->etag = journal_etag;
+            }
+        }
+        return info;
+    });
+    if (!info.has_value())
+    {
+        co_return co_await writer.WriteStatus(utils::webdav::to_href(path, false), "404 Not Found");
+    }
+
+    // a collection created or replaced (made, copied or moved in) is one change in the journal, its members come along
+    if (expand && info->is_directory)
+    {
+        static const int8_t max_depth = ConfigManager::GetInstance().GetWebDavMaxRecurseDepth();
+        co_return co_await utils::webdav::generate_response_list_recurse(writer, path, max_depth);
+    }
+
+    co_return co_await writer.Write(*info);
+}
+
+// RFC 6578 sync-collection, the changes below the collection since the client's sync token
+async_simple::coro::Lazy<void> REPORT(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+{
+    namespace fs = std::filesystem;
+    const auto& conf = ConfigManager::GetInstance();
+    static auto& change_journal = ChangeJournal::Service::GetInstance();
+
+    try
+    {
+        fs::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
+        const fs::file_status status = co_await utils::blocking::run([&abs_path]() { return fs::status(abs_path); });
+        if (!fs::exists(status))
+        {
+            throw NotFoundException("path not found");
+        }
+        if (!fs::is_directory(status))
+        {
+            throw ForbiddenException("sync-collection of a non-collection");
+        }
+
+        const auto sync = parse_sync_collection(std::string{req.get_body()}, conf.GetWebDavSyncPageSize());
+
+        // taken before anything is read, a change made meanwhile is reported (again) by the next sync
+        const auto [valid, current] = co_await utils::blocking::run([&sync]() {
+            const bool valid = sync.has_value() && (sync->token == 0 || change_journal.IsValidToken(sync->token));
+            return std::pair{valid, change_journal.CurrentToken()};
+        });
+        if (!valid)
+        {
+            res.set_content_type<cinatra::resp_content_type::xml>();
+            res.set_status_and_content(cinatra::status_type::forbidden, std::string{INVALID_SYNC_TOKEN_BODY});
+            co_return;
+        }
+
+        // one more than fits tells whether the page is the last one
+        std::vector<ChangeJournal::Change> changes;
+        if (sync->token != 0)
+        {
+            changes = co_await utils::blocking::run(
+                [&abs_path, &sync, current]() { return change_journal.ChangesSince(abs_path, sync->token, current, sync->limit + 1); });
+        }
+        const bool truncated = changes.size() > sync->limit;
+        if (truncated)
+        {
+            changes.resize(sync->limit);
+        }
+        const std::string next_token = ChangeJournal::to_sync_token(truncated ? changes.back().token : current);
+
+        res.set_delay(true);
+
+        utils::webdav::MultistatusWriter writer{res.get_conn(), utils::webdav::MULTISTATUS_BUFFER_SIZE};
+        bool ok = co_await writer.Begin();
+        try
+        {
+            if (sync->token == 0)
+            {
+                // the initial sync lists the members, not the collection itself
+                ok = ok && co_await utils::webdav::generate_response_list_recurse(writer, abs_path,
+                                                                                  sync->infinite ? conf.GetWebDavMaxRecurseDepth() : 1, false);
+            }
+
+            // sync-level 1 reports the member a change happened in (or below), once per page
+            std::unordered_set<std::string> written;
+            for (const auto& change : changes)
+            {
+                const fs::path changed{change.path};
+                const fs::path member = sync->infinite ? changed : abs_path / *changed.lexically_relative(abs_path).begin();
+                if (!ok || !written.insert(utils::path::to_string(member)).second)
+                {
+                    continue;
+                }
+
+                const bool expand = sync->infinite && change.op != MutationService::Op::REMOVE;
+                ok = co_await write_change(writer, member, member == changed ? change.etag : std::string{}, expand);
+            }
+
+            // RFC 6578 3.6, the client asks again with the token below for the rest
+            if (ok && truncated)
+            {
+                ok = co_await writer.WriteStatus(utils::webdav::to_href(abs_path, true), "507 Insufficient Storage");
+            }
+            ok = ok && co_await writer.End(next_token);
+        }
+        catch (const std::exception& err)
+        {
+            LOG_ERROR(err.what())
+            ok = false;
+        }
+
+        // the status line is gone already, a half written body can only be reported by dropping the connection
+        if (!ok)
+        {
+            res.get_conn()->close();
+        }
+    }
+    catch (const NotFoundException& err)
+    {
+        LOG_INFO(err.what())
+        res.set_status(cinatra::status_type::not_found);
+    }
+    catch (const BadRequestException& err)
+    {
+        LOG_INFO(err.what())
+        res.set_status(cinatra::status_type::bad_request);
+    }
+    catch (const ForbiddenException& err)
+    {
+        LOG_INFO(err.what())
+        res.set_status(cinatra::status_type::forbidden);
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        res.set_status(cinatra::status_type::internal_server_error);
+    }
+}
+
+} // namespace Routes::WebDAV
@@ -4,11 +4,12 @@
 #include "http_exceptions.hpp"
 #include "logger.hpp"
 #include "services/FileLockService.h"
+#include "utils/blocking.h"
 
 namespace Routes::WebDAV
 {
 
-void UNLOCK(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+async_simple::coro::Lazy<void> UNLOCK(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
 {
     namespace fs = std::filesystem;
     static const auto& conf = ConfigManager::GetInstance();
@@ -17,7 +18,7 @@ void UNLOCK(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
     try
     {
         std::filesystem::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
-        if (!fs::exists(abs_path))
+        if (!(co_await utils::blocking::run([&abs_path]() { return fs::exists(abs_path); })))
         {
             throw NotFoundException("The specified file does not exist");
         }
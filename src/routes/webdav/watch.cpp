@@ -0,0 +1,178 @@
+#include "watch.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cinatra/coro_http_connection.hpp>
+
+#include "ConfigManager.h"
+#include "http_exceptions.hpp"
+#include "iguana/json_writer.hpp"
+#include "logger.hpp"
+#include "services/ChangeJournalService.h"
+#include "services/NotificationService.h"
+#include "utils/blocking.h"
+#include "utils/webdav.h"
+
+struct WatchChange
+{
+    std::string href;
+    std::string op;
+};
+
+/*
+    {"changed":true,"overflow":false,"sync_token":"http://davsync/ns/sync/42","changes":[{"href":"/webdav/a/b","op":"modify"}]}
+
+    sync_token is where the client syncs (REPORT) from when something changed, and watches from next time when nothing
+    did. It is empty when the client's token is too old, it has to sync from scratch. The changes are the ones seen
+    while waiting, a hint only: an overflow drops some, and one that landed before the wait is only known as changed.
+ */
+struct WatchResponse
+{
+    bool changed = false;
+    bool overflow = false;
+    std::string sync_token;
+    std::vector<WatchChange> changes;
+};
+
+static std::string op_name(const MutationService::Op op)
+{
+    switch (op)
+    {
+    case MutationService::Op::CREATE:
+        return "create";
+    case MutationService::Op::REMOVE:
+        return "remove";
+    default:
+        return "modify";
+    }
+}
+
+namespace Routes::WebDAV
+{
+
+// GET <collection>?watch=1[&since=<sync token>][&timeout=<seconds>], answers once something below the collection changed
+async_simple::coro::Lazy<void> WATCH(cinatra::coro_http_request& req, cinatra::coro_http_response& res)
+{
+    namespace fs = std::filesystem;
+    const auto& conf = ConfigManager::GetInstance();
+    static auto& change_journal = ChangeJournal::Service::GetInstance();
+    static auto& notification = Notification::Service::GetInstance();
+
+    try
+    {
+        fs::path abs_path = conf.GetWebDavAbsoluteDataPath(req.get_url());
+        const fs::file_status status = co_await utils::blocking::run([&abs_path]() { return fs::status(abs_path); });
+        if (!fs::exists(status))
+        {
+            throw NotFoundException("path not found");
+        }
+        if (!fs::is_directory(status))
+        {
+            throw BadRequestException("only collections can be watched");
+        }
+
+        // the client may wait for less than [webdav.watch_timeout], never for more
+        std::chrono::seconds timeout{conf.GetWebDavWatchTimeout()};
+        if (const std::string_view value = req.get_query_value("timeout"); !value.empty())
+        {
+            int seconds = 0;
+            const char* last = value.data() + value.size();
+            if (const auto [end, ec] = std::from_chars(value.data(), last, seconds); ec != std::errc{} || end != last)
+            {
+                throw BadRequestException("invalid timeout");
+            }
+            timeout = std::clamp(std::chrono::seconds{seconds}, std::chrono::seconds{0}, timeout);
+        }
+
+        // subscribed before the journal is read, a change landing in between wakes the wait below right away
+        Notification::Subscription subscription = notification.Subscribe(abs_path, req.get_conn()->socket().get_executor());
+
+        // where the client stands: the token it sent when that is still valid, the latest one when it sent none
+        struct Position
+        {
+            uint64_t current = 0;
+            std::optional<uint64_t> base;
+            bool changed = false;
+        };
+        const std::string since{req.get_query_value("since")};
+        Position position = co_await utils::blocking::run([&abs_path, &since]() {
+            Position position{change_journal.CurrentToken()};
+            if (since.empty())
+            {
+                position.base = position.current;
+                return position;
+            }
+
+            // a token the journal no longer covers counts as a change, the client syncs from scratch
+            position.base = ChangeJournal::parse_sync_token(since);
+            if (!position.base.has_value() || !change_journal.IsValidToken(*position.base))
+            {
+                position.base.reset();
+                position.changed = true;
+                return position;
+            }
+
+            position.changed = !change_journal.ChangesSince(abs_path, *position.base, position.current, 1).empty();
+            return position;
+        });
+
+        WatchResponse response;
+        response.changed = position.changed;
+        if (!position.changed)
+        {
+            Notification::Batch batch = co_await subscription->Wait(timeout);
+            response.changed = !batch.events.empty() || batch.overflowed;
+            response.overflow = batch.overflowed;
+            for (const auto& event : batch.events)
+            {
+                response.changes.push_back({utils::webdav::to_href(event.path, false), op_name(event.op)});
+
+                // published between subscribing and reading the journal, already below the token read
+                if (event.token != 0)
+                {
+                    position.base = std::min(*position.base, event.token - 1);
+                }
+            }
+
+            // nothing below the collection changed up to the latest token
+            if (!response.changed)
+            {
+                position.base = position.current;
+            }
+        }
+        response.sync_token = position.base.has_value() ? ChangeJournal::to_sync_token(*position.base) : std::string{};
+
+        std::string body;
+        iguana::to_json(response, body);
+        res.add_header("Cache-Control", "no-store");
+        res.set_content_type<cinatra::resp_content_type::json>();
+        res.set_status_and_content(cinatra::status_type::ok, std::move(body));
+    }
+    catch (const NotFoundException& err)
+    {
+        LOG_INFO(err.what())
+        res.set_status(cinatra::status_type::not_found);
+    }
+    catch (const BadRequestException& err)
+    {
+        LOG_INFO(err.what())
+        res.set_status(cinatra::status_type::bad_request);
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        res.set_status(cinatra::status_type::internal_server_error);
+    }
+}
+
+} // namespace Routes::WebDAV
@@ -0,0 +1,188 @@
+#include "ChangeJournalService.h"
+
+#include <charconv>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "ConfigManager.h"
+#include "logger.hpp"
+#include "utils/path.h"
+
+namespace ChangeJournal
+{
+
+static constexpr std::string_view SYNC_TOKEN_PREFIX = "http://davsync/ns/sync/";
+
+static constexpr auto INSERT_SQL = "INSERT INTO ChangeJournalTable (path, op, etag) VALUES (?1, ?2, ?3)";
+
+static constexpr auto LAST_TOKEN_SQL = "SELECT last_insert_rowid()";
+
+static constexpr auto PRUNE_SQL = "DELETE FROM ChangeJournalTable WHERE token <= ?1";
+
+static constexpr auto RESET_SQL = "DELETE FROM ChangeJournalTable WHERE token < ?1";
+
+// the latest reset row, see Reset()
+static constexpr auto FLOOR_SQL = "SELECT IFNULL(MAX(token), 0) FROM ChangeJournalTable WHERE path = ''";
+
+static constexpr auto RANGE_SQL = "SELECT IFNULL(MIN(token), 0), IFNULL(MAX(token), 0) FROM ChangeJournalTable";
+
+// the latest change of each path in the range of paths below a directory
+static constexpr auto CHANGES_SQL = "SELECT token, path, op, etag FROM ChangeJournalTable AS change "
+                                    "WHERE token > ?1 AND token <= ?2 AND path > ?3 AND path < ?4 "
+                                    "AND token = (SELECT MAX(token) FROM ChangeJournalTable WHERE path = change.path) "
+                                    "ORDER BY token LIMIT ?5";
+
+std::string to_sync_token(const uint64_t token)
+{
+    return std::format("{}{}", SYNC_TOKEN_PREFIX, token);
+}
+
+std::optional<uint64_t> parse_sync_token(std::string_view sync_token)
+{
+    if (!sync_token.starts_with(SYNC_TOKEN_PREFIX))
+    {
+        return std::nullopt;
+    }
+
+    sync_token.remove_prefix(SYNC_TOKEN_PREFIX.size());
+    uint64_t token = 0;
+    const auto [end, ec] = std::from_chars(sync_token.data(), sync_token.data() + sync_token.size(), token);
+    if (ec != std::errc{} || end != sync_token.data() + sync_token.size())
+    {
+        return std::nullopt;
+    }
+    return token;
+}
+
+Service& Service::GetInstance()
+{
+    static Service instance{ConfigManager::GetInstance().GetWebDavSyncJournalSize()};
+    return instance;
+}
+
+Service::Service(const size_t max_changes) : database_(utils::sqlite::Database::GetInstance()), max_changes_(max_changes)
+{
+    // AUTOINCREMENT, a token is never handed out twice even after the changes holding it were pruned
+    database_.Write([](utils::sqlite::Connection& connection) {
+        connection.Execute("CREATE TABLE IF NOT EXISTS ChangeJournalTable (token INTEGER PRIMARY KEY AUTOINCREMENT, "
+                           "path TEXT NOT NULL, op INTEGER NOT NULL, etag TEXT)");
+        connection.Execute("CREATE INDEX IF NOT EXISTS ChangeJournalPathIndex ON ChangeJournalTable (path, token)");
+    });
+
+    // whatever changed while the server was down is not in the log
+    Reset();
+}
+
+uint64_t Service::Append(const std::filesystem::path& path, const MutationService::Op op, const std::string& etag) noexcept
+{
+    const std::string key = utils::path::to_key(path);
+
+    uint64_t token = 0;
+    try
+    {
+        database_.Write([this, &key, op, &etag, &token](utils::sqlite::Connection& connection) {
+            connection.Prepare(INSERT_SQL).Bind(1, key).Bind(2, static_cast<int64_t>(op)).Bind(3, etag).Step();
+
+            auto& last = connection.Prepare(LAST_TOKEN_SQL);
+            last.Step();
+            token = static_cast<uint64_t>(last.ColumnInt(0));
+            last.Reset();
+
+            // the primary key range, nothing to scan while the log is not full yet
+            if (token > max_changes_)
+            {
+                connection.Prepare(PRUNE_SQL).Bind(1, static_cast<int64_t>(token - max_changes_)).Step();
+            }
+        });
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR_FMT("Change journal append error: {}", err.what())
+    }
+
+    return token;
+}
+
+void Service::Reset() noexcept
+{
+    try
+    {
+        // an empty path is below no directory, ChangesSince never returns the row
+        database_.Write([](utils::sqlite::Connection& connection) {
+            const auto op = static_cast<int64_t>(MutationService::Op::MODIFY);
+            connection.Prepare(INSERT_SQL).Bind(1, std::string{}).Bind(2, op).Bind(3, std::string{}).Step();
+
+            auto& last = connection.Prepare(LAST_TOKEN_SQL);
+            last.Step();
+            const auto token = last.ColumnInt(0);
+            last.Reset();
+
+            connection.Prepare(RESET_SQL).Bind(1, token).Step();
+        });
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR_FMT("Change journal reset error: {}", err.what())
+    }
+}
+
+uint64_t Service::CurrentToken()
+{
+    return database_.Read([](utils::sqlite::Connection& connection) {
+        auto& range = connection.Prepare(RANGE_SQL);
+        range.Step();
+        const auto token = static_cast<uint64_t>(range.ColumnInt(1));
+        range.Reset();
+        return token;
+    });
+}
+
+bool Service::IsValidToken(const uint64_t token)
+{
+    return database_.Read([token](utils::sqlite::Connection& connection) {
+        auto& range = connection.Prepare(RANGE_SQL);
+        range.Step();
+        const auto oldest = static_cast<uint64_t>(range.ColumnInt(0));
+        const auto latest = static_cast<uint64_t>(range.ColumnInt(1));
+        range.Reset();
+
+        auto& floor = connection.Prepare(FLOOR_SQL);
+        floor.Step();
+        const auto reset = static_cast<uint64_t>(floor.ColumnInt(0));
+        floor.Reset();
+
+        // every change after the token is still here when the one right after it is, and none was missed since
+        return token <= latest && token >= reset && (oldest == 0 || token + 1 >= oldest);
+    });
+}
+
+std::vector<Change> Service::ChangesSince(const std::filesystem::path& dir, const uint64_t since, const uint64_t upto, const size_t limit)
+{
+    // "dir/" < path < "dir0", '0' follows the separator
+    constexpr char separator = static_cast<char>(std::filesystem::path::preferred_separator);
+    const std::string key = utils::path::to_key(dir);
+    const std::string lower = key + separator;
+    const std::string upper = key + static_cast<char>(separator + 1);
+
+    return database_.Read([&lower, &upper, since, upto, limit](utils::sqlite::Connection& connection) {
+        auto& select = connection.Prepare(CHANGES_SQL);
+        select.Bind(1, static_cast<int64_t>(since))
+            .Bind(2, static_cast<int64_t>(upto))
+            .Bind(3, lower)
+            .Bind(4, upper)
+            .Bind(5, static_cast<int64_t>(limit));
+
+        std::vector<Change> changes;
+        while (select.Step())
+        {
+            changes.push_back({static_cast<uint64_t>(select.ColumnInt(0)), select.ColumnText(1),
+                               static_cast<MutationService::Op>(select.ColumnInt(2)), select.ColumnText(3)});
+        }
+        return changes;
+    });
+}
+
+} // namespace ChangeJournal
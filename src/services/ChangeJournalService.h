@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MutationService.h"
+#include "utils/sqlite.h"
+
+namespace ChangeJournal
+{
+
+struct Change
+{
+    uint64_t token = 0;
+    std::string path;
+    MutationService::Op op = MutationService::Op::MODIFY;
+
+    // the stored etag right after the change, empty for a removal or a file that was not hashed yet
+    std::string etag;
+};
+
+// sync tokens are URIs (RFC 6578), "http://davsync/ns/sync/42" for token 42
+[[nodiscard]]
+std::string to_sync_token(uint64_t token);
+
+// nullopt for a sync token this server did not hand out
+[[nodiscard]]
+std::optional<uint64_t> parse_sync_token(std::string_view sync_token);
+
+/*
+    Append-only log of every change reported to the MutationService, the feed behind the sync-collection REPORT.
+    Each change gets the next sync token, the log lives in the SQLite database so that a token is never handed out
+    twice. Only the latest [webdav.sync_journal_size] changes are kept, a client holding a token from before them has
+    to sync from scratch. So does one holding a token from before a Reset, which is recorded at startup and whenever
+    changes may have gone unreported (the watcher's queue overflowed).
+ */
+class Service
+{
+  public:
+    static Service& GetInstance();
+
+    // records the change and returns its token, 0 when it could not be stored
+    uint64_t Append(const std::filesystem::path& path, MutationService::Op op, const std::string& etag) noexcept;
+
+    // Records that changes were missed: the tokens handed out so far stop being valid, the log restarts with a row of
+    // its own (an empty path, below no directory) whose token is the next one clients get.
+    void Reset() noexcept;
+
+    // the token of the latest change, 0 before the first one
+    [[nodiscard]]
+    uint64_t CurrentToken();
+
+    // false for a token whose changes were pruned already, or one this log never handed out
+    [[nodiscard]]
+    bool IsValidToken(uint64_t token);
+
+    // The latest change of every path below dir made after since and up to upto, in token order and at most limit of
+    // them. A path changed again after upto is left out, its next sync reports it.
+    [[nodiscard]]
+    std::vector<Change> ChangesSince(const std::filesystem::path& dir, uint64_t since, uint64_t upto, size_t limit);
+
+  private:
+    explicit Service(size_t max_changes);
+
+    utils::sqlite::Database& database_;
+    size_t max_changes_;
+};
+
+} // namespace ChangeJournal
@@ -0,0 +1,143 @@
+#include "DirectoryCacheService.h"
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "ConfigManager.h"
+#include "utils/path.h"
+
+namespace DirectoryCache
+{
+
+// rough heap footprint of a listing, good enough to keep the cache within its budget
+static size_t EstimateSize(const std::string& key, const CachedDirectory& listing)
+{
+    size_t bytes = sizeof(CachedDirectory) + key.size() * 2 + 64;
+    for (const auto& entry : listing.entries)
+    {
+        bytes += sizeof(CachedEntry) + entry.name.capacity() + entry.etag.capacity();
+    }
+
+    return bytes;
+}
+
+Service& Service::GetInstance()
+{
+    static Service instance{ConfigManager::GetInstance().GetWebDavDirectoryCacheSize()};
+    return instance;
+}
+
+Service::Service(size_t budget) : budget_(budget)
+{
+}
+
+Service::Lookup Service::Get(const std::filesystem::path& dir)
+{
+    const std::string key = utils::path::to_key(dir);
+
+    std::lock_guard lock{mutex_};
+    const auto it = nodes_.find(key);
+    if (it == nodes_.end())
+    {
+        return {nullptr, epoch_};
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    return {it->second.listing, epoch_};
+}
+
+bool Service::Put(const std::filesystem::path& dir, CachedDirectoryPtrT listing, const uint64_t ticket)
+{
+    std::string key = utils::path::to_key(dir);
+    const size_t bytes = EstimateSize(key, *listing);
+    if (bytes > budget_)
+    {
+        return false;
+    }
+
+    std::lock_guard lock{mutex_};
+    if (epoch_ != ticket)
+    {
+        return false;
+    }
+
+    if (const auto it = nodes_.find(key); it != nodes_.end())
+    {
+        EraseLocked(it);
+    }
+
+    while (used_ + bytes > budget_ && !lru_.empty())
+    {
+        EraseLocked(nodes_.find(lru_.back()));
+    }
+
+    lru_.push_front(key);
+    nodes_.emplace(std::move(key), Node{std::move(listing), bytes, lru_.begin()});
+    used_ += bytes;
+    return true;
+}
+
+void Service::Invalidate(const std::filesystem::path& path)
+{
+    const std::string key = utils::path::to_key(path);
+    const std::string parent_key = utils::path::to_key(std::filesystem::path{key}.parent_path());
+
+    std::lock_guard lock{mutex_};
+    ++epoch_;
+    if (const auto it = nodes_.find(parent_key); it != nodes_.end())
+    {
+        EraseLocked(it);
+    }
+
+    // "key" itself and every "key/..." below it
+    auto it = nodes_.lower_bound(key);
+    while (it != nodes_.end() && it->first.starts_with(key))
+    {
+        const char next = it->first.size() > key.size() ? it->first[key.size()] : '/';
+        if (it->first.size() == key.size() || next == '/' || next == '\\')
+        {
+            auto erase_it = it++;
+            EraseLocked(erase_it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+void Service::InvalidateListing(const std::filesystem::path& dir)
+{
+    const std::string key = utils::path::to_key(dir);
+
+    std::lock_guard lock{mutex_};
+    ++epoch_;
+    if (const auto it = nodes_.find(key); it != nodes_.end())
+    {
+        EraseLocked(it);
+    }
+}
+
+void Service::Clear()
+{
+    std::lock_guard lock{mutex_};
+    ++epoch_;
+    nodes_.clear();
+    lru_.clear();
+    used_ = 0;
+}
+
+size_t Service::GetMemoryUsage()
+{
+    std::lock_guard lock{mutex_};
+    return used_;
+}
+
+void Service::EraseLocked(std::map<std::string, Node>::iterator it)
+{
+    used_ -= it->second.bytes;
+    lru_.erase(it->second.lru_it);
+    nodes_.erase(it);
+}
+
+} // namespace DirectoryCache
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utils/file.h"
+
+namespace DirectoryCache
+{
+
+struct CachedEntry
+{
+    std::string name;
+    bool is_directory = false;
+    uint64_t size = 0;
+    std::time_t last_modified = 0;
+    std::string etag;
+    utils::file::FileStat stat;
+};
+
+struct CachedDirectory
+{
+    std::vector<CachedEntry> entries;
+
+    // of the directory itself when it was read, together with the members' stats it lets listings of unwatched
+    // directories be validated without reading them again
+    utils::file::FileStat stat;
+};
+
+using CachedDirectoryPtrT = std::shared_ptr<const CachedDirectory>;
+
+/*
+    Listings of directories as PROPFIND last saw them, so that clients polling an unchanged tree are answered without
+    touching the disk. Entries are evicted least recently used first once the memory budget is exceeded. The cache
+    does not validate anything by itself, every change to the data directory is reported through MutationService
+    (by the handlers, and by the FileWatcher for changes made outside the server) so the affected listings are dropped.
+
+    Like the SlruCache, a lookup hands out a ticket and a listing is only filled in with it when nothing was
+    invalidated in between, a directory read before a change is not cached after the change dropped its listing.
+ */
+class Service
+{
+  public:
+    struct Lookup
+    {
+        CachedDirectoryPtrT listing;
+        uint64_t ticket = 0;
+    };
+
+    static Service& GetInstance();
+
+    [[nodiscard]]
+    Lookup Get(const std::filesystem::path& dir);
+
+    // returns false when something was invalidated since the ticket was handed out, the listing is not cached then
+    bool Put(const std::filesystem::path& dir, CachedDirectoryPtrT listing, uint64_t ticket);
+
+    // drops the listing of the parent of path and the listings of path and everything below it
+    void Invalidate(const std::filesystem::path& path);
+
+    // drops the listing of dir alone, for a member that changed in place (e.g. the etag of a sub directory)
+    void InvalidateListing(const std::filesystem::path& dir);
+
+    void Clear();
+
+    [[nodiscard]]
+    size_t GetMemoryUsage();
+
+  private:
+    struct Node
+    {
+        CachedDirectoryPtrT listing;
+        size_t bytes = 0;
+        std::list<std::string>::iterator lru_it;
+    };
+
+    explicit Service(size_t budget);
+
+    void EraseLocked(std::map<std::string, Node>::iterator it);
+
+    std::mutex mutex_;
+    size_t budget_;
+    size_t used_ = 0;
+
+    // moved on by every invalidation
+    uint64_t epoch_ = 0;
+
+    // ordered so that a whole subtree is one contiguous key range
+    std::map<std::string, Node> nodes_;
+    std::list<std::string> lru_;
+};
+
+} // namespace DirectoryCache
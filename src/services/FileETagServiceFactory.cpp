@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 
+#include "file_etag/CachedFileETagService.h"
 #include "file_etag/MemoryFileETagService.h"
 #include "file_etag/RedisFileETagService.h"
 #include "file_etag/SQLiteFileETagService.h"
@@ -10,6 +11,22 @@
 namespace FileETagService
 {
 
+static CachedFileETagService* cache_instance = nullptr;
+
+// the engines behind a database or the network get the in-process cache in front of them, unless it is disabled
+static FileETagService& with_cache(FileETagService& engine)
+{
+    const auto& conf = ConfigManager::GetInstance();
+    if (conf.GetEngineCacheSize() == 0)
+    {
+        return engine;
+    }
+
+    static CachedFileETagService instance{engine, conf.GetEngineCacheSize(), conf.GetEngineCacheMode() == "write-back"};
+    cache_instance = &instance;
+    return instance;
+}
+
 FileETagService& GetService()
 {
     const auto& conf = ConfigManager::GetInstance();
@@ -24,16 +41,31 @@ FileETagService& GetService()
     if (engine == "redis")
     {
         static RedisFileETagService instance{};
-        return instance;
+        static FileETagService& cached = with_cache(instance);
+        return cached;
     }
 
     if (engine == "sqlite")
     {
         static SQLiteFileETagService instance{};
-        return instance;
+        static FileETagService& cached = with_cache(instance);
+        return cached;
     }
 
     throw std::runtime_error("There is no matching cache engine.");
 }
 
+utils::CacheStats GetCacheStats()
+{
+    return cache_instance != nullptr ? cache_instance->GetStats() : utils::CacheStats{};
+}
+
+void ClearCache()
+{
+    if (cache_instance != nullptr)
+    {
+        cache_instance->Clear();
+    }
+}
+
 } // namespace FileETagService
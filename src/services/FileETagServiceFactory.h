@@ -1,10 +1,17 @@
 #pragma once
 
 #include "file_etag/FileETagService.h"
+#include "utils/slru_cache.h"
 
 namespace FileETagService
 {
 
 FileETagService& GetService();
 
+// counters of the cache in front of the engine, all zero without one
+utils::CacheStats GetCacheStats();
+
+// empties the cache in front of the engine, if there is one
+void ClearCache();
+
 }
@@ -1,12 +1,14 @@
 #include "FileLockService.h"
 
-#include <cassert>
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
 #include <string>
 #include <utility>
-#include <vector>
 
 #include "utils.h"
 
@@ -34,445 +36,383 @@ std::chrono::seconds EntryLock::CreationDate() const
     return std::chrono::seconds{creation_date};
 }
 
-/******************/
-/*  struct Entry  */
-/******************/
-Service::Entry::~Entry()
-{
-    if (lock != nullptr)
-    {
-        for (auto& pair : *lock)
-            delete pair.second;
-        lock->clear();
-        delete lock;
-        lock = nullptr;
-    }
-
-    if (children != nullptr)
-    {
-        for (Entry* it : *children)
-            delete it;
-        delete children;
-        children = nullptr;
-    }
-}
-
 /*******************/
 /*  class Service  */
 /*******************/
-Service& Service::GetInstance()
-{
-    static Service instance{};
-    return instance;
-}
 
-bool Service::Lock(const fs::path& path, const EntryLock& lock)
+// calls func with every component below the root, "/a/./b/../c/" -> "a", "c", false for a path leaving the root
+template <class F> static bool for_each_component(const fs::path& path, F&& func)
 {
-    std::list<std::string> cwd;
-    Entry* entry = root_;
-    std::string part_str;
-
-    for (const fs::path& part : path)
+    for (const fs::path& part : path.lexically_normal().relative_path())
     {
-        part_str = part.string();
-
-        if (part_str == "/")
+        const std::string name = part.string();
+        if (name.empty())
         {
-            entry = root_;
-            cwd.clear();
-            cwd.push_back("/");
             continue;
         }
 
-        if (part_str == ".")
+        if (name == ".." || !func(std::string_view{name}))
         {
-            continue;
-        }
-
-        if (part_str == "..")
-        {
-            if (entry->parent == nullptr)
-            {
-                throw std::runtime_error("Illegial path.");
-            }
-            entry = entry->parent;
-            cwd.pop_back();
-            continue;
+            return false;
         }
+    }
 
-        EntryListT* sub_entry = entry->children;
-        if (sub_entry == nullptr)
-        {
-            sub_entry = new EntryListT();
-            entry->children = sub_entry;
-        }
+    return true;
+}
 
-        auto it = std::find_if(sub_entry->begin(), sub_entry->end(), [&part_str](const Entry* elm) { return elm->name == part_str; });
-        if (it == sub_entry->end())
-        {
-            auto* new_entry = new Entry();
-            new_entry->name = part_str;
-            for (const std::string& str : cwd)
-            {
-                new_entry->path /= str;
-            }
-            new_entry->path /= part_str;
-            new_entry->parent = entry;
-            sub_entry->push_back(new_entry);
+Service& Service::GetInstance()
+{
+    static Service instance{};
+    return instance;
+}
 
-            entry = new_entry;
-            cwd.push_back(part_str);
-            continue;
-        }
+bool Service::Lock(const fs::path& path, const EntryLock& lock)
+{
+    return Insert(path, lock);
+}
 
-        entry = *it;
-        cwd.push_back(part_str);
-    }
+bool Service::Lock(const fs::path& path, EntryLock&& lock)
+{
+    return Insert(path, std::move(lock));
+}
 
-    if (entry->lock == nullptr)
+bool Service::Unlock(const fs::path& path, const std::string& user)
+{
+    const auto lock = WriteLock();
+    const IdT id = FindNode(path);
+    if (id == NONE)
     {
-        entry->lock = new LockListT{{std::string{lock.user}, new EntryLock(lock)}};
-        return true;
+        return false;
     }
 
-    if (entry->lock->contains(lock.user))
+    Node& node = nodes_[id];
+    if (node.locks == nullptr || node.locks->erase(user) == 0)
     {
         return false;
     }
 
-    entry->lock->insert({std::string{lock.user}, new EntryLock(lock)});
+    lock_count_.fetch_sub(1, std::memory_order_release);
+    if (node.locks->empty())
+    {
+        node.locks.reset();
+        Release(id);
+    }
     return true;
 }
 
-bool Service::Lock(const fs::path& path, EntryLock&& lock)
+std::optional<EntryLock> Service::GetLock(const fs::path& path, const std::string& user)
 {
-    std::list<std::string> cwd;
-    Entry* entry = root_;
-    std::string part_str;
+    if (!AnyLock())
+    {
+        return std::nullopt;
+    }
 
-    for (const fs::path& part : path)
+    const auto lock = ReadLock();
+    const auto [id, below] = FindLock(path);
+    if (id == NONE)
     {
-        part_str = part.string();
+        return std::nullopt;
+    }
 
-        if (part_str == "/")
-        {
-            entry = root_;
-            cwd.clear();
-            cwd.push_back("/");
-            continue;
-        }
+    const LockListT& locks = *nodes_[id].locks;
+    const auto it = locks.find(user);
+    return it != locks.end() ? std::optional<EntryLock>{it->second} : std::nullopt;
+}
 
-        if (part_str == ".")
-        {
-            continue;
-        }
+Service::LockListT Service::GetAllLock(const fs::path& path)
+{
+    if (!AnyLock())
+    {
+        return {};
+    }
+
+    const auto lock = ReadLock();
+    const auto [id, below] = FindLock(path);
+    return id != NONE ? *nodes_[id].locks : LockListT{};
+}
 
-        if (part_str == "..")
+bool Service::IsLocked(const fs::path& path, const bool by_parent)
+{
+    if (!AnyLock())
+    {
+        return false;
+    }
+
+    const auto now_sec = utils::get_timestamp<std::chrono::seconds>().count();
+    short max_depth = std::numeric_limits<short>::min();
+    bool expired = false;
+    uint32_t below = 0;
+    {
+        const auto lock = ReadLock();
+        const auto [id, distance] = FindLock(path, by_parent);
+        if (id == NONE)
         {
-            if (entry->parent == nullptr)
-            {
-                throw std::runtime_error("Illegial path.");
-            }
-            entry = entry->parent;
-            cwd.pop_back();
-            continue;
+            return false;
         }
 
-        EntryListT* sub_entry = entry->children;
-        if (sub_entry == nullptr)
+        if (distance == 0)
         {
-            sub_entry = new EntryListT();
-            entry->children = sub_entry;
+            return true;
         }
 
-        auto it = std::find_if(sub_entry->begin(), sub_entry->end(), [&part_str](const Entry* elm) { return elm->name == part_str; });
-        if (it == sub_entry->end())
+        // of the locks still valid the one reaching deepest counts
+        for (const auto& [user, entry_lock] : *nodes_[id].locks)
         {
-            auto* new_entry = new Entry();
-            new_entry->name = part_str;
-            for (const std::string& str : cwd)
+            if (entry_lock.expires_at < now_sec)
             {
-                new_entry->path /= str;
+                expired = true;
+                continue;
             }
-            new_entry->path /= part_str;
-            new_entry->parent = entry;
-            sub_entry->push_back(new_entry);
-
-            entry = new_entry;
-            cwd.push_back(part_str);
-            continue;
+            max_depth = std::max(max_depth, entry_lock.depth);
         }
-
-        entry = *it;
-        cwd.push_back(part_str);
+        below = distance;
     }
 
-    if (entry->lock == nullptr)
+    // the expired locks are cleaned up once the check is done
+    if (expired)
     {
-        entry->lock = new LockListT{{std::string{lock.user}, new EntryLock(std::forward<EntryLock&&>(lock))}};
-        return true;
+        DropExpired(path, by_parent);
     }
 
-    if (entry->lock->contains(lock.user))
-    {
-        return false;
-    }
-
-    entry->lock->insert({std::string{lock.user}, new EntryLock(std::forward<EntryLock&&>(lock))});
-    return true;
+    return static_cast<int64_t>(max_depth) >= static_cast<int64_t>(below);
 }
 
-bool Service::Unlock(const fs::path& path, const std::string& user)
+bool Service::HoldingExclusiveLock(const fs::path& path)
 {
-    Entry* entry = FindEntry(path);
-    if (entry == nullptr)
+    if (!AnyLock())
     {
         return false;
     }
 
-    if (entry->lock == nullptr) // lazy clean
-    {
-        delete entry;
-        return false;
-    }
+    const auto lock = ReadLock();
+    const auto [id, below] = FindLock(path);
+    return id != NONE &&
+           std::ranges::any_of(*nodes_[id].locks, [](const auto& item) { return item.second.scope == FileLock::LockScope::EXCLUSIVE; });
+}
 
-    if (!entry->lock->contains(user))
+bool Service::LockedByToken(const fs::path& path, const std::string& token)
+{
+    if (!AnyLock())
     {
         return false;
     }
 
-    entry->lock->erase(user);
-    if (entry->lock->empty()) // lazy clean
-        delete entry;
-    return true;
+    const auto lock = ReadLock();
+    const auto [id, below] = FindLock(path);
+    return id != NONE && std::ranges::any_of(*nodes_[id].locks, [&token](const auto& item) { return item.second.token == token; });
 }
 
-const EntryLock* Service::GetLock(const fs::path& path, const std::string& user)
+size_t Service::GetNodeCount() const noexcept
 {
-    Entry* entry = FindLock(path);
-    assert(entry->lock != nullptr);
-
-    if (entry == nullptr)
-    {
-        return nullptr;
-    }
+    const auto lock = ReadLock();
+    return nodes_.size() - free_nodes_.size();
+}
 
-    auto it = entry->lock->find(user);
-    if (it == entry->lock->end())
+std::shared_lock<std::shared_mutex> Service::ReadLock() const
+{
+    if (writer_waiting_.load(std::memory_order_acquire))
     {
-        return nullptr;
+        std::lock_guard turn{writer_mutex_};
     }
-
-    return (*it).second;
+    return std::shared_lock{mutex_};
 }
 
-const Service::LockListT* Service::GetAllLock(const fs::path& path)
+std::unique_lock<std::shared_mutex> Service::WriteLock()
 {
-    Entry* entry = FindLock(path);
-    if (entry == nullptr || entry->lock == nullptr)
-    {
-        return nullptr;
-    }
+    std::lock_guard turn{writer_mutex_};
+    writer_waiting_.store(true, std::memory_order_release);
+    std::unique_lock lock{mutex_};
+    writer_waiting_.store(false, std::memory_order_release);
+    return lock;
+}
 
-    return entry->lock;
+Service::Service()
+{
+    nodes_.emplace_back();
 }
 
-bool Service::IsLocked(const fs::path& path, bool by_parent)
+template <class L> bool Service::Insert(const fs::path& path, L&& lock)
 {
-    Entry* entry = FindLock(path, by_parent);
-    if (entry == nullptr || entry->lock->empty())
-    {
-        return false;
-    }
+    const auto guard = WriteLock();
 
-    if (entry->path == path)
+    // ".." can only lead a normalized path, nothing was created when it is found
+    IdT id = ROOT;
+    if (!for_each_component(path, [this, &id](const std::string_view name) {
+            const IdT child = Child(id, name);
+            id = child != NONE ? child : AddChild(id, name);
+            return true;
+        }))
     {
-        return true;
+        throw std::runtime_error("Illegal path.");
     }
 
-    short diff_depth = 0;
-    auto it1 = entry->path.begin();
-    auto it2 = path.begin();
-    while (it1 != entry->path.end() && it2 != path.end())
+    Node& node = nodes_[id];
+    if (node.locks == nullptr)
     {
-        ++it1;
-        ++it2;
+        node.locks = std::make_unique<LockListT>();
     }
 
-    if (it1 == entry->path.end())
-    {
-        while (it2 != path.end())
-        {
-            ++it2;
-            diff_depth += 1;
-        }
-    }
-    else
+    // false when the user holds a lock here already
+    std::string user = lock.user;
+    if (!node.locks->try_emplace(std::move(user), std::forward<L>(lock)).second)
     {
-        while (it1 != entry->path.end())
-        {
-            ++it1;
-            diff_depth += 1;
-        }
+        return false;
     }
 
-    auto now_sec = utils::get_timestamp<std::chrono::seconds>().count();
-    short max_depth = std::numeric_limits<short>::min();
+    lock_count_.fetch_add(1, std::memory_order_release);
+    return true;
+}
 
-    // list for expired lock
-    std::vector<std::string> expired_lock;
-    for (const auto& it : *(entry->lock))
-    {
-        // if the lock has expired, mark it
-        if (it.second->expires_at < now_sec)
-        {
-            expired_lock.push_back(it.first);
-            continue;
-        }
-        // considering that there will be multiple locks, we will use the lock with the highest depth value as the reference
-        max_depth = std::max(max_depth, it.second->depth);
-    }
+void Service::DropExpired(const fs::path& path, const bool by_parent)
+{
+    const auto now_sec = utils::get_timestamp<std::chrono::seconds>().count();
 
-    // clean up locks marked as expired
-    for (const auto& k : expired_lock)
+    // looked up again, the trie may have changed since the check let go of it
+    const auto lock = WriteLock();
+    const auto [id, below] = FindLock(path, by_parent);
+    if (id == NONE)
     {
-        entry->lock->erase(k);
+        return;
     }
 
-    // are all the locks expired?
-    if (entry->lock->empty())
+    Node& node = nodes_[id];
+    const size_t dropped = std::erase_if(*node.locks, [now_sec](const auto& item) { return item.second.expires_at < now_sec; });
+    lock_count_.fetch_sub(dropped, std::memory_order_release);
+    if (node.locks->empty())
     {
-        return false;
+        node.locks.reset();
+        Release(id);
     }
-
-    return max_depth >= diff_depth;
 }
 
-bool Service::HoldingExclusiveLock(const fs::path& path)
+Service::IdT Service::FindNode(const fs::path& path) const
 {
-    const auto* all_lock = GetAllLock(path);
-    if (all_lock == nullptr)
-    {
-        return false;
-    }
+    IdT id = ROOT;
+    const bool found = for_each_component(path, [this, &id](const std::string_view name) {
+        id = Child(id, name);
+        return id != NONE;
+    });
 
-    for (const auto& item : *all_lock)
-    {
-        if (item.second->scope == FileLock::LockScope::EXCLUSIVE)
+    return found ? id : NONE;
+}
+
+std::pair<Service::IdT, uint32_t> Service::FindLock(const fs::path& path, const bool by_parent) const
+{
+    IdT id = ROOT;
+    IdT locked = NONE;
+    uint32_t below = 0;
+    const bool found = for_each_component(path, [this, by_parent, &id, &locked, &below](const std::string_view name) {
+        // the rest of the path only counts how far below the lock it is
+        if (locked == NONE && by_parent && nodes_[id].locks != nullptr)
         {
+            locked = id;
+        }
+        if (locked != NONE)
+        {
+            ++below;
             return true;
         }
-    }
 
-    return false;
-}
+        id = Child(id, name);
+        return id != NONE;
+    });
 
-bool Service::LockedByToken(const fs::path& path, const std::string& token)
-{
-    const auto* all_lock = GetAllLock(path);
-    if (all_lock == nullptr)
+    if (locked != NONE)
     {
-        return false;
+        return {locked, below};
     }
 
-    for (const auto& lock : *all_lock)
+    if (!found || nodes_[id].locks == nullptr)
     {
-        if (lock.second->token == token)
-        {
-            return true;
-        }
+        return {NONE, 0};
     }
 
-    return false;
+    return {id, 0};
 }
 
-Service::Service()
+Service::IdT Service::Child(const IdT parent, const std::string_view name) const
 {
-    root_ = new Entry();
-}
-
-Service::~Service()
-{
-    if (root_ == nullptr)
+    // a name no lock path contains is no child of anything
+    const auto name_it = name_ids_.find(name);
+    if (name_it == name_ids_.end())
     {
-        return;
+        return NONE;
     }
 
-    delete root_;
-    root_ = nullptr;
+    const auto it = children_.find(EdgeKey(parent, name_it->second));
+    return it != children_.end() ? it->second : NONE;
 }
 
-Service::Entry* Service::FindEntry(const fs::path& path)
+Service::IdT Service::AddChild(const IdT parent, const std::string_view name)
 {
-    Entry* entry = root_;
-
-    std::string part_str;
-    for (const fs::path& part : path)
+    IdT name_id = NONE;
+    if (const auto it = name_ids_.find(name); it != name_ids_.end())
+    {
+        name_id = it->second;
+    }
+    else
     {
-        part_str = part.string();
-        if (part_str == "/")
+        if (free_names_.empty())
         {
-            continue;
+            name_id = static_cast<IdT>(names_.size());
+            names_.emplace_back();
         }
-
-        const std::list<Entry*>* sub_entry = entry->children;
-        if (sub_entry == nullptr)
+        else
         {
-            return nullptr;
+            name_id = free_names_.back();
+            free_names_.pop_back();
         }
 
-        auto it = std::find_if(sub_entry->begin(), sub_entry->end(), [&part_str](const Entry* elm) { return elm->name == part_str; });
-        if (it == sub_entry->end())
-        {
-            return nullptr;
-        }
+        names_[name_id].text = name;
+        name_ids_.emplace(names_[name_id].text, name_id);
+    }
+    ++names_[name_id].refs;
 
-        entry = *it;
+    IdT id = NONE;
+    if (free_nodes_.empty())
+    {
+        id = static_cast<IdT>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    else
+    {
+        id = free_nodes_.back();
+        free_nodes_.pop_back();
     }
 
-    return entry;
+    Node& node = nodes_[id];
+    node.parent = parent;
+    node.name = name_id;
+    ++nodes_[parent].children;
+    children_.emplace(EdgeKey(parent, name_id), id);
+    return id;
 }
 
-Service::Entry* Service::FindLock(const fs::path& path, bool by_parent)
+void Service::Release(IdT id)
 {
-    Entry* entry = root_;
-
-    std::string part_str;
-    for (const fs::path& part : path)
+    while (id != ROOT)
     {
-        if (by_parent && entry->lock != nullptr)
+        Node& node = nodes_[id];
+        if (node.locks != nullptr || node.children != 0)
         {
-            return entry;
+            return;
         }
 
-        part_str = part.string();
-        if (part_str == "/")
-        {
-            continue;
-        }
+        const IdT parent = node.parent;
+        children_.erase(EdgeKey(parent, node.name));
 
-        auto* sub_entry = entry->children;
-        if (sub_entry == nullptr)
+        if (Name& name = names_[node.name]; --name.refs == 0)
         {
-            return nullptr;
+            name_ids_.erase(name.text);
+            std::string{}.swap(name.text);
+            free_names_.push_back(node.name);
         }
 
-        auto it = std::find_if(sub_entry->begin(), sub_entry->end(), [&part_str](const Entry* elm) { return elm->name == part_str; });
-        if (it == sub_entry->end())
-        {
-            return nullptr;
-        }
-
-        entry = *it;
+        node = Node{};
+        free_nodes_.push_back(id);
+        --nodes_[parent].children;
+        id = parent;
     }
-
-    // entry is not nullptr forever.
-    if (entry->lock == nullptr)
-    {
-        return nullptr;
-    }
-
-    return entry;
 }
 
 } // namespace FileLock
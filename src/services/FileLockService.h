@@ -1,7 +1,20 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
 #include <limits>
-#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "utils.h"
 
@@ -46,14 +59,21 @@ struct EntryLock
     std::chrono::seconds CreationDate() const;
 };
 
+/*
+    The locks live in a trie of path components. Nodes come from an arena (a deque, reused through a free list) and are
+    referred to by index, the children of all nodes share one hash table keyed by (parent, name), and every name is
+    interned once no matter how many directories hold it. A lookup costs two hash probes per component, however many
+    siblings there are, and a node is a few integers plus its locks. Nodes that hold no locks and no children are
+    released right away, the trie only spans the paths leading to locks.
+
+    Every request checks for locks, hardly any path has one. The checks share the trie (std::shared_mutex), LOCK and
+    UNLOCK take it alone, and a count of the locks held lets a check on a lock-free tree return after one atomic load.
+    Results are copies, the locks they describe may be gone as soon as the trie is unlocked.
+ */
 class Service
 {
-  private:
-    struct Entry;
-
   public:
-    using LockListT = std::unordered_map<std::string, EntryLock*>;
-    using EntryListT = std::list<Entry*>;
+    using LockListT = std::unordered_map<std::string, EntryLock>;
 
     static Service& GetInstance();
 
@@ -63,9 +83,10 @@ class Service
 
     bool Unlock(const fs::path& path, const std::string& user);
 
-    const EntryLock* GetLock(const fs::path& path, const std::string& user);
+    std::optional<EntryLock> GetLock(const fs::path& path, const std::string& user);
 
-    const LockListT* GetAllLock(const fs::path& path);
+    // empty when nothing locks the path
+    LockListT GetAllLock(const fs::path& path);
 
     bool IsLocked(const fs::path& path, bool by_parent = true);
 
@@ -73,29 +94,83 @@ class Service
 
     bool LockedByToken(const fs::path& path, const std::string& token);
 
+    // nodes in use, the root included
+    [[nodiscard]]
+    size_t GetNodeCount() const noexcept;
+
   private:
-    struct Entry
-    {
-        std::string name = "";
-        fs::path path = "/";
+    using IdT = uint32_t;
+
+    static constexpr IdT ROOT = 0;
+    static constexpr IdT NONE = std::numeric_limits<IdT>::max();
 
-        Entry* parent = nullptr;
-        LockListT* lock = nullptr;
-        EntryListT* children = nullptr;
+    struct Node
+    {
+        IdT parent = NONE;
+        IdT name = NONE;
+        uint32_t children = 0;
+        std::unique_ptr<LockListT> locks;
+    };
 
-        Entry() = default;
-        ~Entry();
+    struct Name
+    {
+        std::string text;
+        uint32_t refs = 0;
     };
 
     Service();
 
-    ~Service();
+    ~Service() = default;
+
+    template <class L> bool Insert(const fs::path& path, L&& lock);
+
+    // drops the expired locks of the node IsLocked() found them on
+    void DropExpired(const fs::path& path, bool by_parent);
+
+    // a writer waiting for the trie goes first, a steady stream of checks could keep it out for good otherwise
+    std::shared_lock<std::shared_mutex> ReadLock() const;
+
+    std::unique_lock<std::shared_mutex> WriteLock();
+
+    // false when no lock is held anywhere, acquire pairs with the writers' release
+    bool AnyLock() const noexcept
+    {
+        return lock_count_.load(std::memory_order_acquire) != 0;
+    }
+
+    // the node of exactly this path, NONE when there is none
+    IdT FindNode(const fs::path& path) const;
+
+    // the topmost node holding locks on the way to the path (only the path's own one unless by_parent), and how many
+    // components the path lies below it
+    std::pair<IdT, uint32_t> FindLock(const fs::path& path, bool by_parent = true) const;
+
+    IdT Child(IdT parent, std::string_view name) const;
+
+    IdT AddChild(IdT parent, std::string_view name);
+
+    // frees the node and then every ancestor left without locks and children
+    void Release(IdT id);
+
+    static uint64_t EdgeKey(IdT parent, IdT name) noexcept
+    {
+        return (static_cast<uint64_t>(parent) << 32) | name;
+    }
+
+    mutable std::shared_mutex mutex_;
+    mutable std::mutex writer_mutex_;
+    std::atomic<bool> writer_waiting_{false};
+    std::atomic<size_t> lock_count_{0};
 
-    Entry* FindEntry(const fs::path& path);
+    std::deque<Node> nodes_;
+    std::vector<IdT> free_nodes_;
 
-    Entry* FindLock(const fs::path& path, bool by_parent = true);
+    // string_views into names_, a deque never moves its elements
+    std::deque<Name> names_;
+    std::vector<IdT> free_names_;
+    std::unordered_map<std::string_view, IdT> name_ids_;
 
-    Entry* root_ = nullptr;
+    std::unordered_map<uint64_t, IdT> children_;
 };
 
 } // namespace FileLock
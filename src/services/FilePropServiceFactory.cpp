@@ -1,6 +1,7 @@
 #include "FilePropServiceFactory.h"
 
 #include "ConfigManager.h"
+#include "file_prop/CachedFilePropService.h"
 #include "file_prop/MemoryFilePropService.h"
 #include "file_prop/RedisFilePropService.h"
 #include "file_prop/SQLiteFilePropService.h"
@@ -10,6 +11,22 @@
 namespace FilePropService
 {
 
+static CachedFilePropService* cache_instance = nullptr;
+
+// the engines behind a database or the network get the in-process cache in front of them, unless it is disabled
+static FilePropService& with_cache(FilePropService& engine)
+{
+    const auto& conf = ConfigManager::GetInstance();
+    if (conf.GetEngineCacheSize() == 0)
+    {
+        return engine;
+    }
+
+    static CachedFilePropService instance{engine, conf.GetEngineCacheSize()};
+    cache_instance = &instance;
+    return instance;
+}
+
 FilePropService& GetService()
 {
     const auto& conf = ConfigManager::GetInstance();
@@ -23,16 +40,31 @@ FilePropService& GetService()
     if (conf.GetPropEngine() == "redis")
     {
         static RedisFilePropService instance{};
-        return instance;
+        static FilePropService& cached = with_cache(instance);
+        return cached;
     }
 
     if (conf.GetPropEngine() == "sqlite")
     {
         static SQLiteFilePropService instance{};
-        return instance;
+        static FilePropService& cached = with_cache(instance);
+        return cached;
     }
 
     throw std::runtime_error("There is no matching cache engine.");
 }
 
+utils::CacheStats GetCacheStats()
+{
+    return cache_instance != nullptr ? cache_instance->GetStats() : utils::CacheStats{};
+}
+
+void ClearCache()
+{
+    if (cache_instance != nullptr)
+    {
+        cache_instance->Clear();
+    }
+}
+
 } // namespace FilePropService
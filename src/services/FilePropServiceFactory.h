@@ -1,8 +1,15 @@
 #include "file_prop/FilePropService.h"
+#include "utils/slru_cache.h"
 
 namespace FilePropService
 {
 
 FilePropService& GetService();
 
+// counters of the cache in front of the engine, all zero without one
+utils::CacheStats GetCacheStats();
+
+// empties the cache in front of the engine, if there is one
+void ClearCache();
+
 }
@@ -0,0 +1,290 @@
+#include "FileWatcherService.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "ChangeJournalService.h"
+#include "ConfigManager.h"
+#include "DirectoryCacheService.h"
+#include "FileETagServiceFactory.h"
+#include "FilePropServiceFactory.h"
+#include "MutationService.h"
+#include "file_etag/DirectoryETagService.h"
+#include "logger.hpp"
+#include "utils/path.h"
+
+namespace FileWatcher
+{
+
+#ifdef __linux__
+// IN_MODIFY is only used for the directory listing, everything else waits for IN_CLOSE_WRITE
+static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+                                       IN_DELETE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+// the poll timeout only bounds how long Stop() waits for the thread
+static constexpr int POLL_TIMEOUT_MS = 500;
+#endif
+
+Service& Service::GetInstance()
+{
+    static Service instance{};
+    return instance;
+}
+
+Service::~Service()
+{
+    Stop();
+}
+
+bool Service::Start()
+{
+#ifdef __linux__
+    if (thread_.joinable())
+    {
+        return true;
+    }
+
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0)
+    {
+        LOG_ERROR_FMT("Unable to watch the data directory: {}", std::strerror(errno))
+        return false;
+    }
+
+    thread_ = std::jthread{[this](std::stop_token stop_token) { Run(std::move(stop_token)); }};
+    return true;
+#else
+    LOG_WARN("Watching the data directory is not supported on this platform, cached listings are validated with a stat.")
+    return false;
+#endif
+}
+
+void Service::Stop()
+{
+    if (thread_.joinable())
+    {
+        thread_.request_stop();
+        thread_.join();
+    }
+
+#ifdef __linux__
+    if (fd_ >= 0)
+    {
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+
+    std::lock_guard lock{mutex_};
+    wd_to_dir_.clear();
+    watched_dirs_.clear();
+}
+
+bool Service::IsWatched(const std::filesystem::path& dir)
+{
+    const std::string key = utils::path::to_key(dir);
+
+    std::lock_guard lock{mutex_};
+    return watched_dirs_.contains(key);
+}
+
+Stats Service::GetStats()
+{
+    Stats stats{events_, queue_overflows_, ignored_events_, 0, unwatched_directories_};
+
+    std::lock_guard lock{mutex_};
+    stats.watched_directories = watched_dirs_.size();
+    return stats;
+}
+
+void Service::Run([[maybe_unused]] std::stop_token stop_token)
+{
+#ifdef __linux__
+    const auto& data_path = ConfigManager::GetInstance().GetWebDavAbsoluteDataPath();
+    WatchTree(data_path);
+    LOG_INFO_FMT("Watching {} directories below '{}'", GetStats().watched_directories, utils::path::to_string(data_path))
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    pollfd pfd{fd_, POLLIN, 0};
+    while (!stop_token.stop_requested())
+    {
+        const int ready = poll(&pfd, 1, POLL_TIMEOUT_MS);
+        if (ready < 0 && errno != EINTR)
+        {
+            LOG_ERROR_FMT("The file watcher stopped: {}", std::strerror(errno))
+            break;
+        }
+        if (ready <= 0)
+        {
+            continue;
+        }
+
+        const ssize_t len = read(fd_, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < len;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            HandleEvent(event->wd, event->mask, event->len > 0 ? std::string{event->name} : std::string{});
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+#endif
+}
+
+void Service::WatchTree(const std::filesystem::path& dir)
+{
+    namespace fs = std::filesystem;
+
+    AddWatch(dir);
+
+    // every directory is tried even once the limit is hit, so that the counters tell how many are unwatched
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it{dir, fs::directory_options::skip_permission_denied, ec}, end; !ec && it != end; it.increment(ec))
+    {
+        if (it->is_directory(ec) && !it->is_symlink(ec))
+        {
+            AddWatch(it->path());
+        }
+    }
+}
+
+bool Service::AddWatch([[maybe_unused]] const std::filesystem::path& dir)
+{
+#ifdef __linux__
+    std::string key = utils::path::to_key(dir);
+    const int wd = inotify_add_watch(fd_, key.c_str(), WATCH_MASK);
+    if (wd < 0)
+    {
+        if (errno == ENOSPC && unwatched_directories_++ == 0)
+        {
+            LOG_WARN("The inotify watch limit (fs.inotify.max_user_watches) is exhausted, "
+                     "directories without a watch are validated with a stat instead.")
+        }
+        return false;
+    }
+
+    std::lock_guard lock{mutex_};
+    if (auto [it, inserted] = wd_to_dir_.try_emplace(wd, key); !inserted)
+    {
+        // the same directory under a new name
+        watched_dirs_.erase(it->second);
+        it->second = key;
+    }
+    watched_dirs_.insert(std::move(key));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Service::UnwatchTree([[maybe_unused]] const std::string& dir)
+{
+#ifdef __linux__
+    std::lock_guard lock{mutex_};
+    for (auto it = wd_to_dir_.begin(); it != wd_to_dir_.end();)
+    {
+        const std::string& watched = it->second;
+        if (watched.starts_with(dir) && (watched.size() == dir.size() || watched[dir.size()] == '/'))
+        {
+            inotify_rm_watch(fd_, it->first);
+            watched_dirs_.erase(watched);
+            it = wd_to_dir_.erase(it);
+            continue;
+        }
+        ++it;
+    }
+#endif
+}
+
+void Service::HandleEvent([[maybe_unused]] const int wd, [[maybe_unused]] const uint32_t mask, [[maybe_unused]] const std::string& name)
+{
+#ifdef __linux__
+    using MutationService::Op;
+
+    ++events_;
+    if (mask & IN_Q_OVERFLOW)
+    {
+        // nothing tells which changes were lost, so nothing cached can be trusted anymore
+        ++queue_overflows_;
+        LOG_WARN("The file watcher queue overflowed, the caches have been flushed and sync tokens reset.")
+        DirectoryCache::Service::GetInstance().Clear();
+        FileETagService::ClearCache();
+        FilePropService::ClearCache();
+        FileETagService::DirectoryETags::GetInstance().RevalidateAll();
+        ChangeJournal::Service::GetInstance().Reset();
+        return;
+    }
+
+    std::string dir;
+    {
+        std::lock_guard lock{mutex_};
+        const auto it = wd_to_dir_.find(wd);
+        if (it == wd_to_dir_.end())
+        {
+            // the watch was removed by UnwatchTree and the kernel had queued more for it
+            if (!(mask & IN_IGNORED))
+            {
+                ++ignored_events_;
+            }
+            return;
+        }
+
+        dir = it->second;
+        if (mask & IN_IGNORED)
+        {
+            watched_dirs_.erase(dir);
+            wd_to_dir_.erase(it);
+            return;
+        }
+    }
+
+    // events about the watched directory itself, its parent reports the same change with a name
+    if (name.empty())
+    {
+        return;
+    }
+
+    const std::filesystem::path path = std::filesystem::path{dir} / name;
+    const bool is_dir = mask & IN_ISDIR;
+    if (mask & (IN_CREATE | IN_MOVED_TO))
+    {
+        // watched before the caches are invalidated, anything created inside in between is covered by the invalidation
+        if (is_dir)
+        {
+            WatchTree(path);
+        }
+        MutationService::Observe(path, Op::CREATE);
+    }
+    else if (mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+        if (is_dir)
+        {
+            UnwatchTree(utils::path::to_key(path));
+        }
+        MutationService::Observe(path, Op::REMOVE);
+    }
+    else if (mask & (IN_CLOSE_WRITE | IN_ATTRIB))
+    {
+        MutationService::Observe(path, Op::MODIFY);
+    }
+    else if (mask & IN_MODIFY)
+    {
+        // a file still being written, its size in the listing is already stale
+        DirectoryCache::Service::GetInstance().Invalidate(path);
+    }
+#endif
+}
+
+} // namespace FileWatcher
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace FileWatcher
+{
+
+struct Stats
+{
+    uint64_t events = 0;
+
+    // the kernel queue overflowed, an unknown number of events was lost and every cache was flushed
+    uint64_t queue_overflows = 0;
+
+    // events that arrived for a watch that was already gone
+    uint64_t ignored_events = 0;
+
+    uint64_t watched_directories = 0;
+
+    // directories no watch could be added for (watch limit), they are validated with a stat on every use
+    uint64_t unwatched_directories = 0;
+};
+
+/*
+    Watches the data directory (inotify on Linux) so that files changed by other programs invalidate the directory
+    listing, etag and property caches the same way the handlers' own changes do, through MutationService.
+    Directories that could not be watched, because the watch limit is exhausted or the platform has no watcher,
+    are reported by IsWatched() and have to be validated with a stat by whoever caches something about them.
+ */
+class Service
+{
+  public:
+    static Service& GetInstance();
+
+    // starts watching the data directory in the background, false when watching is unavailable on this platform
+    bool Start();
+
+    void Stop();
+
+    [[nodiscard]]
+    bool IsWatched(const std::filesystem::path& dir);
+
+    [[nodiscard]]
+    Stats GetStats();
+
+  private:
+    Service() = default;
+    ~Service();
+
+    void Run(std::stop_token stop_token);
+
+    // adds a watch to dir and every directory below it
+    void WatchTree(const std::filesystem::path& dir);
+
+    bool AddWatch(const std::filesystem::path& dir);
+
+    // removes the watches of dir and every directory below it (it was moved away)
+    void UnwatchTree(const std::string& dir);
+
+    void HandleEvent(int wd, uint32_t mask, const std::string& name);
+
+    int fd_ = -1;
+    std::jthread thread_;
+
+    std::mutex mutex_;
+    std::unordered_map<int, std::string> wd_to_dir_;
+    std::unordered_set<std::string> watched_dirs_;
+
+    std::atomic<uint64_t> events_ = 0;
+    std::atomic<uint64_t> queue_overflows_ = 0;
+    std::atomic<uint64_t> ignored_events_ = 0;
+    std::atomic<uint64_t> unwatched_directories_ = 0;
+};
+
+} // namespace FileWatcher
@@ -0,0 +1,216 @@
+#include "MutationService.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "ChangeJournalService.h"
+#include "DirectoryCacheService.h"
+#include "FileETagServiceFactory.h"
+#include "FilePropServiceFactory.h"
+#include "NotificationService.h"
+#include "file_etag/DirectoryETagService.h"
+#include "file_etag/HashScheduler.h"
+#include "logger.hpp"
+#include "utils/blocking.h"
+#include "utils/file.h"
+#include "utils/path.h"
+
+namespace MutationService
+{
+
+// how long a handler's commit is remembered, the watcher reports the same change well within this
+static constexpr std::chrono::seconds RECENT_COMMIT_TTL{5};
+
+/*
+    What the watcher's events are checked against. A handler holds an Intent on the path it changes, the events for the
+    path or anything below it are left to its Commit meanwhile. The events arriving after the Commit find the path with
+    the stat the Commit saw (or gone together with a path the Commit removed), those repeat it and are dropped as well.
+    Anything else the watcher reports is committed, and a handler's own Commit never is dropped.
+ */
+class Tracker
+{
+  public:
+    static Tracker& GetInstance()
+    {
+        static Tracker instance;
+        return instance;
+    }
+
+    void Begin(const std::string& key)
+    {
+        std::lock_guard lock{mutex_};
+        ++intents_[key].count;
+    }
+
+    // what the watcher saw under a handler that never committed (it failed half way), to be committed now
+    std::optional<Op> End(const std::string& key)
+    {
+        std::lock_guard lock{mutex_};
+        const auto it = intents_.find(key);
+        if (it == intents_.end() || --it->second.count > 0)
+        {
+            return std::nullopt;
+        }
+
+        const std::optional<Op> suppressed = it->second.committed ? std::nullopt : it->second.suppressed;
+        intents_.erase(it);
+        return suppressed;
+    }
+
+    void Committed(const std::string& key, const std::optional<utils::file::FileStat>& stat)
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        std::lock_guard lock{mutex_};
+        Expire(now);
+        if (const auto it = intents_.find(key); it != intents_.end())
+        {
+            it->second.committed = true;
+        }
+
+        recent_[key] = Recent{stat, now + RECENT_COMMIT_TTL};
+        expiry_.emplace_back(now + RECENT_COMMIT_TTL, key);
+    }
+
+    // false for an event that repeats a handler's Commit, or one a handler still going to commit is causing
+    bool ShouldCommit(const std::string& key, const Op op, const std::optional<utils::file::FileStat>& stat)
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        std::lock_guard lock{mutex_};
+        Expire(now);
+        for (std::filesystem::path dir{key};; dir = dir.parent_path())
+        {
+            const std::string dir_key = utils::path::to_key(dir);
+            if (const auto it = intents_.find(dir_key); it != intents_.end())
+            {
+                if (!it->second.committed)
+                {
+                    it->second.suppressed = dir_key == key ? op : Op::MODIFY;
+                }
+                return false;
+            }
+
+            if (const auto it = recent_.find(dir_key); it != recent_.end())
+            {
+                if (dir_key == key ? it->second.stat == stat : !it->second.stat.has_value() && !stat.has_value())
+                {
+                    return false;
+                }
+                if (dir_key == key)
+                {
+                    // changed again since, by somebody else
+                    recent_.erase(it);
+                }
+            }
+
+            if (!dir.has_relative_path())
+            {
+                return true;
+            }
+        }
+    }
+
+  private:
+    struct Intent
+    {
+        size_t count = 0;
+        bool committed = false;
+        std::optional<Op> suppressed;
+    };
+
+    struct Recent
+    {
+        std::optional<utils::file::FileStat> stat;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    void Expire(const std::chrono::steady_clock::time_point now)
+    {
+        for (; !expiry_.empty() && expiry_.front().first <= now; expiry_.pop_front())
+        {
+            // a key committed again since has a later entry in the queue
+            if (const auto it = recent_.find(expiry_.front().second); it != recent_.end() && it->second.expires <= now)
+            {
+                recent_.erase(it);
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Intent> intents_;
+    std::unordered_map<std::string, Recent> recent_;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> expiry_;
+};
+
+static void Apply(const std::filesystem::path& path, const Op op)
+{
+    static auto& directory_cache = DirectoryCache::Service::GetInstance();
+    static auto& etag_service = FileETagService::GetService();
+    static auto& prop_service = FilePropService::GetService();
+    static auto& hash_scheduler = FileETagService::HashScheduler::GetInstance();
+    static auto& change_journal = ChangeJournal::Service::GetInstance();
+    static auto& notification = Notification::Service::GetInstance();
+    static auto& directory_etags = FileETagService::DirectoryETags::GetInstance();
+
+    // the parent's listing changes in every case, the subtree only matters when something was replaced or removed
+    directory_cache.Invalidate(path);
+
+    // keeps an etag that still matches the file (e.g. the one PUT just stored)
+    etag_service.Invalidate(path);
+
+    // the directories above it, the request does not wait for them
+    directory_etags.Update(path);
+
+    // dead properties go away together with the resource
+    if (op == Op::REMOVE)
+    {
+        prop_service.RemoveAll(path);
+        notification.Publish(path, op, change_journal.Append(path, op, {}));
+        return;
+    }
+
+    // clients watching a collection hear about it once it is in the journal, their next sync finds it
+    notification.Publish(path, op, change_journal.Append(path, op, etag_service.Get(path)));
+
+    // a file written by another program is hashed again before it is asked for, a still valid record costs a lookup
+    hash_scheduler.Refresh(path);
+}
+
+Intent::Intent(const std::filesystem::path& path) : path_(path), key_(utils::path::to_key(path))
+{
+    Tracker::GetInstance().Begin(key_);
+}
+
+Intent::~Intent()
+{
+    // on the blocking pool, the intent may end on an I/O thread (e.g. a PUT whose connection went away)
+    if (const std::optional<Op> op = Tracker::GetInstance().End(key_); op.has_value())
+    {
+        utils::blocking::pool().Post([path = path_, op = *op]() {
+            std::error_code ec;
+            Commit(path, std::filesystem::exists(path, ec) ? op : Op::REMOVE);
+        });
+    }
+}
+
+void Commit(const std::filesystem::path& path, const Op op)
+{
+    Tracker::GetInstance().Committed(utils::path::to_key(path), utils::file::get_file_stat(path));
+    Apply(path, op);
+}
+
+void Observe(const std::filesystem::path& path, const Op op)
+{
+    if (Tracker::GetInstance().ShouldCommit(utils::path::to_key(path), op, utils::file::get_file_stat(path)))
+    {
+        Apply(path, op);
+    }
+}
+
+} // namespace MutationService
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace MutationService
+{
+
+enum class Op
+{
+    CREATE = 0,
+    MODIFY,
+    REMOVE
+};
+
+// Held by a handler while it changes path (and what is below it). The watcher's events about those are left to the
+// handler's Commit; a handler ending without one (it failed half way) commits what the watcher saw meanwhile.
+class Intent
+{
+  public:
+    explicit Intent(const std::filesystem::path& path);
+    ~Intent();
+
+    Intent(const Intent&) = delete;
+    Intent& operator=(const Intent&) = delete;
+
+  private:
+    std::filesystem::path path_;
+    std::string key_;
+};
+
+// Every handler that changes something inside the data directory reports it here once the change is done. This is
+// where the caches in front of the filesystem learn about it, a handler's report is always taken.
+void Commit(const std::filesystem::path& path, Op op);
+
+// The FileWatcher's report of a change, possibly made by another program. Dropped when it only repeats a handler's
+// Commit (or is about a path a handler holds an Intent on), taken like a Commit otherwise.
+void Observe(const std::filesystem::path& path, Op op);
+
+} // namespace MutationService
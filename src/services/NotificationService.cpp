@@ -0,0 +1,156 @@
+#include "NotificationService.h"
+
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+#include <asio/post.hpp>
+#include <cinatra/coro_http_connection.hpp>
+
+#include "ConfigManager.h"
+#include "utils/path.h"
+
+namespace Notification
+{
+
+Subscriber::Subscriber(const asio::any_io_executor& executor, const size_t max_events) : max_events_(max_events), timer_(executor)
+{
+}
+
+async_simple::coro::Lazy<Batch> Subscriber::Wait(const std::chrono::steady_clock::duration timeout)
+{
+    {
+        std::lock_guard lock{mutex_};
+        if (!events_.empty() || overflowed_)
+        {
+            co_return Take();
+        }
+        waiting_ = true;
+    }
+
+    // an event published from now on posts the cancel to this executor, where it runs after the wait below started
+    timer_.expires_after(timeout);
+    static_cast<void>(co_await coro_io::async_io<std::error_code>([this](auto&& cb) { timer_.async_wait(std::move(cb)); }, timer_));
+
+    std::lock_guard lock{mutex_};
+    waiting_ = false;
+    co_return Take();
+}
+
+Subscriber::PushResult Subscriber::Push(const Event& event)
+{
+    std::lock_guard lock{mutex_};
+    if (events_.size() >= max_events_)
+    {
+        overflowed_ = true;
+        return PushResult::DROPPED;
+    }
+
+    events_.push_back(event);
+    return std::exchange(waiting_, false) ? PushResult::WAKE : PushResult::QUEUED;
+}
+
+Batch Subscriber::Take()
+{
+    Batch batch;
+    batch.events.assign(std::make_move_iterator(events_.begin()), std::make_move_iterator(events_.end()));
+    batch.overflowed = overflowed_;
+    events_.clear();
+    overflowed_ = false;
+    return batch;
+}
+
+Subscription::Subscription(std::string key, std::shared_ptr<Subscriber> subscriber)
+    : key_(std::move(key)), subscriber_(std::move(subscriber))
+{
+}
+
+Subscription::~Subscription()
+{
+    Service::GetInstance().Unsubscribe(key_, subscriber_.get());
+}
+
+Service& Service::GetInstance()
+{
+    static Service instance{ConfigManager::GetInstance().GetWebDavWatchQueueSize()};
+    return instance;
+}
+
+Service::Service(const size_t max_events)
+    : max_events_(max_events), root_key_(utils::path::to_key(ConfigManager::GetInstance().GetWebDavAbsoluteDataPath()))
+{
+}
+
+Subscription Service::Subscribe(const std::filesystem::path& dir, const asio::any_io_executor& executor)
+{
+    std::string key = utils::path::to_key(dir);
+    auto subscriber = std::make_shared<Subscriber>(executor, max_events_);
+
+    std::lock_guard lock{mutex_};
+    subscribers_[key].push_back(subscriber);
+    ++stats_.subscribers;
+    return Subscription{std::move(key), std::move(subscriber)};
+}
+
+void Service::Publish(const std::filesystem::path& path, const MutationService::Op op, const uint64_t token)
+{
+    const Event event{path, op, token};
+
+    std::lock_guard lock{mutex_};
+    ++stats_.published;
+    if (subscribers_.empty())
+    {
+        return;
+    }
+
+    // the changed path itself (a watched collection that was removed or replaced) and every directory above it
+    std::filesystem::path dir{utils::path::to_key(path)};
+    for (std::string key = dir.string(); key.starts_with(root_key_); key = utils::path::to_key(dir))
+    {
+        if (const auto it = subscribers_.find(key); it != subscribers_.end())
+        {
+            for (const auto& subscriber : it->second)
+            {
+                const Subscriber::PushResult result = subscriber->Push(event);
+                ++(result == Subscriber::PushResult::DROPPED ? stats_.overflows : stats_.delivered);
+
+                // the subscriber lives on (in the lambda) until the cancel ran, the timer is only touched on its executor
+                if (result == Subscriber::PushResult::WAKE)
+                {
+                    asio::post(subscriber->timer_.get_executor(), [subscriber]() { subscriber->timer_.cancel(); });
+                }
+            }
+        }
+
+        if (key.size() <= root_key_.size())
+        {
+            break;
+        }
+        dir = dir.parent_path();
+    }
+}
+
+NotificationStats Service::GetStats()
+{
+    std::lock_guard lock{mutex_};
+    return stats_;
+}
+
+void Service::Unsubscribe(const std::string& key, const Subscriber* subscriber)
+{
+    std::lock_guard lock{mutex_};
+    const auto it = subscribers_.find(key);
+    if (it == subscribers_.end())
+    {
+        return;
+    }
+
+    std::erase_if(it->second, [subscriber](const auto& entry) { return entry.get() == subscriber; });
+    if (it->second.empty())
+    {
+        subscribers_.erase(it);
+    }
+    --stats_.subscribers;
+}
+
+} // namespace Notification
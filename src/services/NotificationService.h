@@ -0,0 +1,142 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <asio/any_io_executor.hpp>
+#include <asio/steady_timer.hpp>
+#include <async_simple/coro/Lazy.h>
+
+#include "MutationService.h"
+
+namespace Notification
+{
+
+struct Event
+{
+    std::filesystem::path path;
+    MutationService::Op op = MutationService::Op::MODIFY;
+
+    // the change journal's token of the change, 0 when it could not be recorded
+    uint64_t token = 0;
+};
+
+struct Batch
+{
+    std::vector<Event> events;
+
+    // events were dropped while the queue was full, the client has to find out what changed by itself
+    bool overflowed = false;
+};
+
+struct NotificationStats
+{
+    uint64_t subscribers = 0;
+    uint64_t published = 0;
+    uint64_t delivered = 0;
+    uint64_t overflows = 0;
+};
+
+class Service;
+
+/*
+    One client waiting for changes below a collection. Events are queued while nobody waits, at most
+    [webdav.watch_queue_size] of them, Wait() parks the coroutine on a timer that the next event cancels. An idle
+    subscriber costs its queue and a timer, no thread.
+ */
+class Subscriber
+{
+  public:
+    Subscriber(const asio::any_io_executor& executor, size_t max_events);
+
+    // Hands over the queued events, waiting for the first one at most timeout. Has to run on the executor the
+    // subscriber was created with, that is where an event cancels the timer.
+    async_simple::coro::Lazy<Batch> Wait(std::chrono::steady_clock::duration timeout);
+
+  private:
+    friend class Service;
+
+    enum class PushResult
+    {
+        QUEUED = 0,
+        // queued as the first one while the coroutine waits, it has to be woken
+        WAKE,
+        DROPPED
+    };
+
+    PushResult Push(const Event& event);
+
+    Batch Take();
+
+    const size_t max_events_;
+    std::mutex mutex_;
+    std::deque<Event> events_;
+    bool overflowed_ = false;
+    bool waiting_ = false;
+    asio::steady_timer timer_;
+};
+
+// unsubscribes when it goes away
+class Subscription
+{
+  public:
+    Subscription(std::string key, std::shared_ptr<Subscriber> subscriber);
+    ~Subscription();
+
+    Subscription(const Subscription&) = delete;
+    Subscription& operator=(const Subscription&) = delete;
+
+    Subscriber* operator->() const noexcept
+    {
+        return subscriber_.get();
+    }
+
+  private:
+    std::string key_;
+    std::shared_ptr<Subscriber> subscriber_;
+};
+
+/*
+    In-process publish/subscribe of the changes reported to the MutationService, the feed behind the watch requests.
+    Subscribers are kept by the collection they watch, an event is delivered to the subscribers of the changed path
+    and of each directory above it, a lookup per level rather than a pass over every subscriber. A change is published
+    once, the MutationService drops the watcher's reports of what a handler already committed.
+ */
+class Service
+{
+  public:
+    static Service& GetInstance();
+
+    // the subscriber's timer runs on executor, the one of the connection waiting for the changes
+    [[nodiscard]]
+    Subscription Subscribe(const std::filesystem::path& dir, const asio::any_io_executor& executor);
+
+    void Publish(const std::filesystem::path& path, MutationService::Op op, uint64_t token);
+
+    [[nodiscard]]
+    NotificationStats GetStats();
+
+  private:
+    friend class Subscription;
+
+    explicit Service(size_t max_events);
+
+    void Unsubscribe(const std::string& key, const Subscriber* subscriber);
+
+    const size_t max_events_;
+    const std::string root_key_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Subscriber>>> subscribers_;
+    NotificationStats stats_;
+};
+
+} // namespace Notification
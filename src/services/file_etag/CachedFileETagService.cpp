@@ -0,0 +1,382 @@
+#include "CachedFileETagService.h"
+
+#include <exception>
+#include <format>
+#include <iostream>
+#include <utility>
+
+#include "logger.hpp"
+#include "utils/blocking.h"
+#include "utils/file.h"
+#include "utils/path.h"
+
+namespace FileETagService
+{
+
+static size_t estimate_size(const std::string& key, const ETagRecord& record)
+{
+    // node, list entry and hash bucket
+    return key.capacity() + record.etag.capacity() + sizeof(ETagRecord) + 96;
+}
+
+CachedFileETagService::CachedFileETagService(FileETagService& engine, const size_t budget, const bool write_back)
+    : engine_(engine), cache_(budget, estimate_size), write_back_(write_back)
+{
+    if (write_back_)
+    {
+        flusher_ = std::jthread{[this](std::stop_token stop_token) { FlushLoop(std::move(stop_token)); }};
+    }
+}
+
+CachedFileETagService::~CachedFileETagService()
+{
+    // stores whatever is still queued before returning
+    flusher_ = {};
+}
+
+std::string CachedFileETagService::Get(const std::filesystem::path& path) noexcept
+{
+    try
+    {
+        const std::string key = utils::path::to_string(path);
+        const auto lookup = Find(key);
+        if (lookup.value.has_value())
+        {
+            return lookup.value->etag;
+        }
+
+        // without a stat tuple, the record only answers Get
+        std::string etag = engine_.Get(path);
+        cache_.Put(key, {etag, {}}, lookup.ticket);
+        return etag;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        return {""};
+    }
+}
+
+std::vector<std::string> CachedFileETagService::GetMany(const std::vector<std::filesystem::path>& paths) noexcept
+{
+    std::vector<std::string> etags(paths.size());
+    try
+    {
+        std::vector<std::string> keys(paths.size());
+        std::vector<uint64_t> tickets(paths.size());
+        std::vector<size_t> missed;
+        std::vector<std::filesystem::path> missed_paths;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            keys[i] = utils::path::to_string(paths[i]);
+            auto lookup = Find(keys[i]);
+            if (lookup.value.has_value())
+            {
+                etags[i] = std::move(lookup.value->etag);
+                continue;
+            }
+
+            tickets[i] = lookup.ticket;
+            missed.push_back(i);
+            missed_paths.push_back(paths[i]);
+        }
+
+        if (missed.empty())
+        {
+            return etags;
+        }
+
+        std::vector<std::string> fetched = engine_.GetMany(missed_paths);
+        for (size_t j = 0; j < missed.size(); ++j)
+        {
+            const size_t i = missed[j];
+            cache_.Put(keys[i], {fetched[j], {}}, tickets[i]);
+            etags[i] = std::move(fetched[j]);
+        }
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+
+    return etags;
+}
+
+std::string CachedFileETagService::Set(const std::filesystem::path& path) noexcept
+{
+    try
+    {
+        const std::string key = utils::path::to_string(path);
+        if (write_back_)
+        {
+            const auto record = ComputeETagRecord(path);
+            if (!record.has_value())
+            {
+                LOG_WARN("Unexpected file type.")
+                return {""};
+            }
+
+            Store(path, key, *record);
+            return record->etag;
+        }
+
+        // taken before the engine hashes, a file modified meanwhile fails the next validation and is hashed again
+        const auto stat = utils::file::get_file_stat(path);
+        std::string etag = engine_.Set(path);
+        if (etag.empty() || !stat.has_value())
+        {
+            cache_.Invalidate(key);
+            return etag;
+        }
+
+        Store(path, key, {etag, *stat});
+        return etag;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        return {""};
+    }
+}
+
+std::string CachedFileETagService::Set(const std::filesystem::path& path, const std::string& etag) noexcept
+{
+    try
+    {
+        const std::string key = utils::path::to_string(path);
+        const auto record = MakeETagRecord(path, etag);
+        if (!record.has_value())
+        {
+            cache_.Invalidate(key);
+            return {""};
+        }
+
+        if (!write_back_ && engine_.Set(path, etag).empty())
+        {
+            cache_.Invalidate(key);
+            return {""};
+        }
+
+        Store(path, key, *record);
+        return etag;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        return {""};
+    }
+}
+
+std::string CachedFileETagService::GetValidated(const std::filesystem::path& path) noexcept
+{
+    const auto stat = utils::file::get_file_stat(path);
+    if (!stat.has_value())
+    {
+        return {""};
+    }
+
+    try
+    {
+        const std::string key = utils::path::to_string(path);
+        const auto lookup = Find(key);
+        if (lookup.value.has_value() && !lookup.value->etag.empty() && lookup.value->stat == *stat)
+        {
+            return lookup.value->etag;
+        }
+
+        if (write_back_)
+        {
+            return Set(path);
+        }
+
+        std::string etag = engine_.GetValidated(path);
+        if (!etag.empty())
+        {
+            cache_.Put(key, {etag, *stat}, lookup.ticket);
+        }
+        return etag;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        return {""};
+    }
+}
+
+void CachedFileETagService::Invalidate(const std::filesystem::path& path) noexcept
+{
+    try
+    {
+        const std::string key = utils::path::to_string(path);
+        {
+            std::lock_guard lock{dirty_mutex_};
+            dirty_.erase(key);
+
+            // the flusher checks it right before storing, it never writes the record back after the engine dropped it
+            if (const auto it = flushing_.find(key); it != flushing_.end())
+            {
+                it->second.invalidated = true;
+            }
+        }
+        cache_.Invalidate(key);
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+
+    engine_.Invalidate(path);
+}
+
+void CachedFileETagService::Clear() noexcept
+{
+    {
+        std::lock_guard lock{dirty_mutex_};
+        dirty_.clear();
+        for (auto& [key, dirty] : flushing_)
+        {
+            dirty.invalidated = true;
+        }
+    }
+    cache_.Clear();
+}
+
+async_simple::coro::Lazy<std::string> CachedFileETagService::GetAsync(std::filesystem::path path)
+{
+    const std::string key = utils::path::to_string(path);
+    const auto lookup = Find(key);
+    if (lookup.value.has_value())
+    {
+        co_return lookup.value->etag;
+    }
+
+    std::string etag = co_await engine_.GetAsync(path);
+    cache_.Put(key, {etag, {}}, lookup.ticket);
+    co_return etag;
+}
+
+async_simple::coro::Lazy<std::string> CachedFileETagService::GetValidatedAsync(std::filesystem::path path)
+{
+    const auto stat = co_await utils::blocking::run([&path]() { return utils::file::get_file_stat(path); });
+    if (!stat.has_value())
+    {
+        co_return std::string{""};
+    }
+
+    const std::string key = utils::path::to_string(path);
+    const auto lookup = Find(key);
+    if (lookup.value.has_value() && !lookup.value->etag.empty() && lookup.value->stat == *stat)
+    {
+        co_return lookup.value->etag;
+    }
+
+    if (write_back_)
+    {
+        try
+        {
+            const auto record = co_await ComputeETagRecordAsync(path);
+            if (!record.has_value())
+            {
+                LOG_WARN("Unexpected file type.")
+                co_return std::string{""};
+            }
+
+            Store(path, key, *record);
+            co_return record->etag;
+        }
+        catch (const std::exception& err)
+        {
+            LOG_ERROR(err.what())
+            co_return std::string{""};
+        }
+    }
+
+    std::string etag = co_await engine_.GetValidatedAsync(path);
+    if (!etag.empty())
+    {
+        cache_.Put(key, {etag, *stat}, lookup.ticket);
+    }
+    co_return etag;
+}
+
+utils::CacheStats CachedFileETagService::GetStats()
+{
+    return cache_.GetStats();
+}
+
+CachedFileETagService::CacheT::Lookup CachedFileETagService::Find(const std::string& key)
+{
+    auto lookup = cache_.Get(key);
+    if (lookup.value.has_value() || !write_back_)
+    {
+        return lookup;
+    }
+
+    std::lock_guard lock{dirty_mutex_};
+    if (const auto it = dirty_.find(key); it != dirty_.end())
+    {
+        lookup.value = it->second.record;
+    }
+    else if (const auto flushing_it = flushing_.find(key); flushing_it != flushing_.end() && !flushing_it->second.invalidated)
+    {
+        lookup.value = flushing_it->second.record;
+    }
+
+    return lookup;
+}
+
+void CachedFileETagService::Store(const std::filesystem::path& path, const std::string& key, const ETagRecord& record)
+{
+    cache_.Put(key, record, cache_.Invalidate(key));
+    if (!write_back_)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock{dirty_mutex_};
+        dirty_.insert_or_assign(key, DirtyRecord{path, record});
+    }
+    dirty_cv_.notify_one();
+}
+
+void CachedFileETagService::FlushLoop(std::stop_token stop_token)
+{
+    while (true)
+    {
+        {
+            std::unique_lock lock{dirty_mutex_};
+            if (!dirty_cv_.wait(lock, stop_token, [this]() { return !dirty_.empty(); }))
+            {
+                return;
+            }
+            flushing_.swap(dirty_);
+        }
+
+        // only Invalidate() touches the entries meanwhile, and only their mark
+        for (const auto& [key, dirty] : flushing_)
+        {
+            // a file written again after it was hashed is left for the next validation to hash
+            if (utils::file::get_file_stat(dirty.path) != dirty.record.stat)
+            {
+                continue;
+            }
+
+            // held while storing, an Invalidate() coming in meanwhile drops the record from the engine after this
+            std::lock_guard lock{dirty_mutex_};
+            if (dirty.invalidated)
+            {
+                continue;
+            }
+            if (engine_.Set(dirty.path, dirty.record.etag).empty())
+            {
+                LOG_ERROR_FMT("Unable to store the etag of '{}'.", key)
+            }
+        }
+
+        std::lock_guard lock{dirty_mutex_};
+        flushing_.clear();
+    }
+}
+
+} // namespace FileETagService
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "FileETagService.h"
+#include "utils/slru_cache.h"
+
+namespace FileETagService
+{
+
+/*
+    An in-process cache in front of an engine behind a database or the network. Lookups that miss are cached as well
+    (as an empty etag), a record stored through GetValidated or Set keeps its stat tuple so that GetValidated is
+    answered from the cache as long as the file is unchanged.
+
+    Write-through hands every change to the engine before returning. Write-back hashes here, caches the record and
+    leaves storing it to a background thread, which skips records whose file changed in the meantime. A record still
+    waiting to be stored is found by lookups even when the cache evicted it. Both modes invalidate synchronously.
+ */
+class CachedFileETagService final : public FileETagService
+{
+  public:
+    CachedFileETagService(FileETagService& engine, size_t budget, bool write_back);
+    ~CachedFileETagService() override;
+
+    std::string Get(const std::filesystem::path& path) noexcept override;
+
+    std::vector<std::string> GetMany(const std::vector<std::filesystem::path>& paths) noexcept override;
+
+    std::string Set(const std::filesystem::path& path) noexcept override;
+
+    std::string Set(const std::filesystem::path& path, const std::string& etag) noexcept override;
+
+    std::string GetValidated(const std::filesystem::path& path) noexcept override;
+
+    void Invalidate(const std::filesystem::path& path) noexcept override;
+
+    async_simple::coro::Lazy<std::string> GetAsync(std::filesystem::path path) override;
+
+    async_simple::coro::Lazy<std::string> GetValidatedAsync(std::filesystem::path path) override;
+
+    // drops every cached record, and the ones not stored yet, when the files may have changed unseen
+    void Clear() noexcept;
+
+    [[nodiscard]]
+    utils::CacheStats GetStats();
+
+  private:
+    using CacheT = utils::SlruCache<std::string, ETagRecord>;
+
+    struct DirtyRecord
+    {
+        std::filesystem::path path;
+        ETagRecord record;
+
+        // invalidated while being flushed, neither stored nor found anymore
+        bool invalidated = false;
+    };
+
+    // the cached record (or the one waiting to be stored), the ticket is for filling the cache in after a miss
+    CacheT::Lookup Find(const std::string& key);
+
+    // caches a record the caller just stored (write-through) or queues it (write-back)
+    void Store(const std::filesystem::path& path, const std::string& key, const ETagRecord& record);
+
+    void FlushLoop(std::stop_token stop_token);
+
+    FileETagService& engine_;
+    CacheT cache_;
+    bool write_back_;
+
+    std::mutex dirty_mutex_;
+    std::condition_variable_any dirty_cv_;
+    std::unordered_map<std::string, DirtyRecord> dirty_;
+
+    // taken out of dirty_ by the flusher and not stored yet
+    std::unordered_map<std::string, DirtyRecord> flushing_;
+
+    std::jthread flusher_;
+};
+
+} // namespace FileETagService
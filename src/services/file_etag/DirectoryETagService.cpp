@@ -0,0 +1,249 @@
+#include "DirectoryETagService.h"
+
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <system_error>
+#include <utility>
+
+#include "ConfigManager.h"
+#include "logger.hpp"
+#include "services/DirectoryCacheService.h"
+#include "services/FileETagServiceFactory.h"
+#include "utils/blocking.h"
+#include "utils/path.h"
+
+namespace FileETagService
+{
+
+// directories whose digests are kept, past it they are all dropped and listed again as changes come by
+static constexpr size_t MAX_DIRECTORIES = 4096;
+
+static bool is_below(const std::string& key, const std::string& dir_key)
+{
+    return key.size() > dir_key.size() && key.starts_with(dir_key) && (key[dir_key.size()] == '/' || key[dir_key.size()] == '\\');
+}
+
+DirectoryETags& DirectoryETags::GetInstance()
+{
+    static DirectoryETags instance;
+    return instance;
+}
+
+void DirectoryETags::Update(const std::filesystem::path& path)
+{
+    std::lock_guard lock{mutex_};
+    queue_.push_back(path);
+    if (!draining_)
+    {
+        draining_ = true;
+        utils::blocking::pool().Post([this]() { Drain(); });
+    }
+}
+
+void DirectoryETags::RevalidateAll()
+{
+    std::lock_guard lock{mutex_};
+    revalidate_ = true;
+    if (!draining_)
+    {
+        draining_ = true;
+        utils::blocking::pool().Post([this]() { Drain(); });
+    }
+}
+
+void DirectoryETags::Drain()
+{
+    static auto& directory_cache = DirectoryCache::Service::GetInstance();
+    static const std::filesystem::path root = ConfigManager::GetInstance().GetWebDavAbsoluteDataPath();
+
+    while (true)
+    {
+        bool revalidate = false;
+        std::filesystem::path path;
+        {
+            std::lock_guard lock{mutex_};
+            std::swap(revalidate, revalidate_);
+            if (!revalidate && queue_.empty())
+            {
+                draining_ = false;
+                return;
+            }
+            if (!revalidate)
+            {
+                path = std::move(queue_.front());
+                queue_.pop_front();
+            }
+        }
+
+        try
+        {
+            if (!revalidate)
+            {
+                Apply(path);
+                continue;
+            }
+
+            // the digests kept are from before the lost events, a change queued meanwhile lists its directories again
+            directories_.clear();
+            Revalidate(root);
+            directory_cache.Clear();
+            LOG_INFO("The etags below the data directory have been revalidated.")
+        }
+        catch (const std::exception& err)
+        {
+            // gone meanwhile, its removal is queued as well
+            LOG_WARN(err.what())
+        }
+    }
+}
+
+void DirectoryETags::Apply(const std::filesystem::path& path)
+{
+    namespace fs = std::filesystem;
+
+    static auto& directory_cache = DirectoryCache::Service::GetInstance();
+    static auto& etag_service = GetService();
+    static const std::string root_key = utils::path::to_key(ConfigManager::GetInstance().GetWebDavAbsoluteDataPath());
+
+    fs::path child{utils::path::to_key(path)};
+    std::string child_key = utils::path::to_string(child);
+    if (child_key != root_key && !is_below(child_key, root_key))
+    {
+        return;
+    }
+
+    // a directory created, copied over or removed, what was known below it does not hold anymore
+    std::error_code ec;
+    const fs::file_status status = fs::status(child, ec);
+    if (directories_.contains(child_key))
+    {
+        Forget(child_key);
+    }
+
+    // the new part of the child in its parent, none once it is gone
+    std::optional<DirectoryDigest> digest;
+    if (fs::is_directory(status))
+    {
+        const std::string etag = DirectoryETag(Load(child, child_key).digest);
+        etag_service.Set(child, etag);
+        if (child_key != root_key)
+        {
+            directory_cache.InvalidateListing(child.parent_path());
+        }
+        digest = MemberDigest(child, etag);
+    }
+    else if (fs::is_regular_file(status))
+    {
+        digest = MemberDigest(child, etag_service.Get(child));
+    }
+
+    while (child_key != root_key)
+    {
+        fs::path dir = child.parent_path();
+        const std::string dir_key = utils::path::to_string(dir);
+        const std::string name = utils::path::to_string(child.filename());
+
+        // listed just now with the child as it is, nothing to patch
+        Directory* directory = nullptr;
+        if (const auto it = directories_.find(dir_key); it != directories_.end())
+        {
+            directory = &it->second;
+            if (const auto member = directory->members.find(name); member != directory->members.end())
+            {
+                directory->digest.Subtract(member->second);
+                directory->members.erase(member);
+            }
+            if (digest.has_value())
+            {
+                directory->digest.Add(*digest);
+                directory->members.emplace(name, *digest);
+            }
+        }
+        else
+        {
+            directory = &Load(dir, dir_key);
+        }
+
+        // stored before the listing showing it as a member is dropped, a PROPFIND never caches the old etag again
+        const std::string etag = DirectoryETag(directory->digest);
+        etag_service.Set(dir, etag);
+        if (dir_key != root_key)
+        {
+            directory_cache.InvalidateListing(dir.parent_path());
+        }
+
+        digest = MemberDigest(dir, etag);
+        child = std::move(dir);
+        child_key = dir_key;
+    }
+}
+
+// depth first, the digests are not kept, each directory is listed again the next time a change below it comes by
+std::string DirectoryETags::Revalidate(const std::filesystem::path& dir)
+{
+    namespace fs = std::filesystem;
+
+    static auto& etag_service = GetService();
+
+    DirectoryDigest digest;
+    for (const auto& entry : fs::directory_iterator(dir, fs::directory_options::skip_permission_denied))
+    {
+        std::string etag;
+        try
+        {
+            if (entry.is_directory())
+            {
+                etag = Revalidate(entry.path());
+            }
+            else if (entry.is_regular_file())
+            {
+                // hashed again only when its stat tuple changed
+                etag = etag_service.GetValidated(entry.path());
+            }
+            else
+            {
+                continue;
+            }
+        }
+        catch (const fs::filesystem_error& err)
+        {
+            // gone meanwhile
+            LOG_WARN(err.what())
+            continue;
+        }
+
+        if (const auto member = MemberDigest(entry.path(), etag); member.has_value())
+        {
+            digest.Add(*member);
+        }
+    }
+
+    const std::string etag = DirectoryETag(digest);
+    etag_service.Set(dir, etag);
+    return etag;
+}
+
+DirectoryETags::Directory& DirectoryETags::Load(const std::filesystem::path& dir, const std::string& key)
+{
+    if (directories_.size() >= MAX_DIRECTORIES)
+    {
+        directories_.clear();
+    }
+
+    Directory directory;
+    for (auto& [name, digest] : ListMemberDigests(dir))
+    {
+        directory.digest.Add(digest);
+        directory.members.emplace(std::move(name), digest);
+    }
+    return directories_.insert_or_assign(key, std::move(directory)).first->second;
+}
+
+// a directory known means the ones above it are as well, nothing is known below one that is not
+void DirectoryETags::Forget(const std::string& key)
+{
+    std::erase_if(directories_, [&key](const auto& entry) { return entry.first == key || is_below(entry.first, key); });
+}
+
+} // namespace FileETagService
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "FileETagService.h"
+
+namespace FileETagService
+{
+
+/*
+    Keeps the etags of the directories above every change up to date, off the request path: Update() only queues the
+    path, one task on the blocking pool works through the queue. Each directory on the way up to the data directory
+    has its DirectoryDigest and the digest of each of its members, so a change costs subtracting the member's old
+    digest and adding its new one per level instead of listing the directory again. A directory is listed once, the
+    first time a change below it comes by (or again after RevalidateAll()).
+
+    Until the task gets to a change, the directories above it keep their previous etag.
+ */
+class DirectoryETags
+{
+  public:
+    static DirectoryETags& GetInstance();
+
+    DirectoryETags(const DirectoryETags&) = delete;
+    DirectoryETags& operator=(const DirectoryETags&) = delete;
+
+    // the directories above path, and path itself when it is a directory (its members may all have changed)
+    void Update(const std::filesystem::path& path);
+
+    // Anything below the data directory may have changed unseen (the watcher lost events): every file's etag is
+    // validated and every directory's computed again, in the background like the updates.
+    void RevalidateAll();
+
+  private:
+    struct Directory
+    {
+        DirectoryDigest digest;
+        std::unordered_map<std::string, DirectoryDigest> members;
+    };
+
+    DirectoryETags() = default;
+
+    void Drain();
+
+    void Apply(const std::filesystem::path& path);
+
+    std::string Revalidate(const std::filesystem::path& dir);
+
+    Directory& Load(const std::filesystem::path& dir, const std::string& key);
+
+    void Forget(const std::string& key);
+
+    std::mutex mutex_;
+    std::deque<std::filesystem::path> queue_;
+    bool draining_ = false;
+    bool revalidate_ = false;
+
+    // only touched by the task draining the queue
+    std::unordered_map<std::string, Directory> directories_;
+};
+
+} // namespace FileETagService
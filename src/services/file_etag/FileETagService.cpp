@@ -0,0 +1,268 @@
+#include "FileETagService.h"
+
+#include <charconv>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <async_simple/coro/FutureAwaiter.h>
+
+#include "ConfigManager.h"
+#include "HashScheduler.h"
+#include "services/FileETagServiceFactory.h"
+#include "utils/blocking.h"
+#include "utils/path.h"
+#include "utils/thread_pool.h"
+
+namespace FileETagService
+{
+
+std::vector<std::string> FileETagService::GetMany(const std::vector<std::filesystem::path>& paths) noexcept
+{
+    std::vector<std::string> etags;
+    etags.reserve(paths.size());
+    for (const auto& path : paths)
+    {
+        etags.push_back(Get(path));
+    }
+
+    return etags;
+}
+
+async_simple::coro::Lazy<std::string> FileETagService::GetAsync(std::filesystem::path path)
+{
+    co_return co_await utils::blocking::run([this, &path]() { return Get(path); });
+}
+
+async_simple::coro::Lazy<std::string> FileETagService::GetValidatedAsync(std::filesystem::path path)
+{
+    co_return co_await utils::blocking::run([this, &path]() { return GetValidated(path); });
+}
+
+utils::hash::Algorithm GetETagAlgorithm()
+{
+    static const utils::hash::Algorithm algorithm =
+        utils::hash::parse_algorithm(ConfigManager::GetInstance().GetEngineETagAlgorithm()).value_or(utils::hash::Algorithm::SHA256);
+    return algorithm;
+}
+
+static std::string format_etag(const utils::hash::Algorithm algorithm, const std::string& hex)
+{
+    return std::format("{}:{}", utils::hash::to_string(algorithm), hex);
+}
+
+// blake3 subtrees of large files are hashed here, apart from the HashScheduler workers which wait for them
+static utils::WorkStealingPool& hashing_pool()
+{
+    static utils::WorkStealingPool pool{ConfigManager::GetInstance().GetEngineETagThreads()};
+    return pool;
+}
+
+std::string ComputeETag(const std::filesystem::path& path) noexcept(false)
+{
+    const utils::hash::Algorithm algorithm = GetETagAlgorithm();
+    if (std::filesystem::is_directory(path))
+    {
+        return ComputeDirectoryETag(path);
+    }
+
+    if (std::filesystem::is_regular_file(path))
+    {
+        utils::WorkStealingPool* pool = algorithm == utils::hash::Algorithm::BLAKE3 ? &hashing_pool() : nullptr;
+        return format_etag(algorithm, utils::hash::file_hex(path, algorithm, pool));
+    }
+
+    return {""};
+}
+
+void DirectoryDigest::Add(const DirectoryDigest& other) noexcept
+{
+    for (size_t i = 0; i < lanes.size(); ++i)
+    {
+        lanes[i] += other.lanes[i];
+    }
+}
+
+void DirectoryDigest::Subtract(const DirectoryDigest& other) noexcept
+{
+    for (size_t i = 0; i < lanes.size(); ++i)
+    {
+        lanes[i] -= other.lanes[i];
+    }
+}
+
+std::optional<DirectoryDigest> MemberDigest(const std::filesystem::path& member, const std::string& etag)
+{
+    // "name\0etag\0", neither can contain a NUL
+    constexpr std::string_view SEPARATOR{"\0", 1};
+    utils::hash::Hasher hasher{GetETagAlgorithm()};
+    hasher.Update(utils::path::to_string(member.filename()));
+    hasher.Update(SEPARATOR);
+    if (!etag.empty())
+    {
+        hasher.Update(etag);
+    }
+    else if (const auto stat = utils::file::get_file_stat(member); stat.has_value())
+    {
+        hasher.Update(std::format("{},{},{},{}", stat->dev, stat->ino, stat->size, stat->mtime_ns));
+    }
+    else
+    {
+        return std::nullopt;
+    }
+    hasher.Update(SEPARATOR);
+
+    // 32 hex digits (xxh3) fill the first two lanes, 64 all four
+    const std::string hex = hasher.FinalHex();
+    DirectoryDigest digest;
+    for (size_t i = 0; i < digest.lanes.size() && (i + 1) * 16 <= hex.size(); ++i)
+    {
+        std::from_chars(hex.data() + i * 16, hex.data() + (i + 1) * 16, digest.lanes[i], 16);
+    }
+    return digest;
+}
+
+std::vector<std::pair<std::string, DirectoryDigest>> ListMemberDigests(const std::filesystem::path& dir) noexcept(false)
+{
+    namespace fs = std::filesystem;
+
+    static auto& etag_service = GetService();
+
+    std::vector<fs::path> members;
+    for (const auto& entry : fs::directory_iterator(dir, fs::directory_options::skip_permission_denied))
+    {
+        if (entry.is_directory() || entry.is_regular_file())
+        {
+            members.push_back(entry.path());
+        }
+    }
+
+    const std::vector<std::string> etags = etag_service.GetMany(members);
+
+    std::vector<std::pair<std::string, DirectoryDigest>> digests;
+    digests.reserve(members.size());
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        // removed meanwhile
+        if (auto digest = MemberDigest(members[i], etags[i]); digest.has_value())
+        {
+            digests.emplace_back(utils::path::to_string(members[i].filename()), *digest);
+        }
+    }
+    return digests;
+}
+
+std::string DirectoryETag(const DirectoryDigest& digest)
+{
+    const utils::hash::Algorithm algorithm = GetETagAlgorithm();
+    const std::string lanes = std::format("{:016x}{:016x}{:016x}{:016x}", digest.lanes[0], digest.lanes[1], digest.lanes[2], digest.lanes[3]);
+    return format_etag(algorithm, utils::hash::hex(lanes, algorithm));
+}
+
+std::string ComputeDirectoryETag(const std::filesystem::path& dir) noexcept(false)
+{
+    DirectoryDigest digest;
+    for (const auto& [name, member] : ListMemberDigests(dir))
+    {
+        digest.Add(member);
+    }
+    return DirectoryETag(digest);
+}
+
+ETagHasher::ETagHasher() : algorithm_(GetETagAlgorithm()), hasher_(algorithm_)
+{
+}
+
+void ETagHasher::Update(const std::string_view data)
+{
+    hasher_.Update(data);
+}
+
+std::string ETagHasher::Final()
+{
+    return format_etag(algorithm_, hasher_.FinalHex());
+}
+
+std::optional<ETagRecord> HashETagRecord(const std::filesystem::path& path) noexcept(false)
+{
+    const auto before = utils::file::get_file_stat(path);
+    if (!before.has_value())
+    {
+        return std::nullopt;
+    }
+
+    ETagRecord record{ComputeETag(path), *before};
+    if (record.etag.empty())
+    {
+        return std::nullopt;
+    }
+
+    if (const auto after = utils::file::get_file_stat(path); !after.has_value() || *after != *before)
+    {
+        record.stat = {};
+    }
+
+    return record;
+}
+
+std::optional<ETagRecord> ComputeETagRecord(const std::filesystem::path& path) noexcept(false)
+{
+    return HashScheduler::GetInstance().Compute(path, HashPriority::INTERACTIVE);
+}
+
+async_simple::coro::Lazy<std::optional<ETagRecord>> ComputeETagRecordAsync(std::filesystem::path path)
+{
+    // resumes on the caller's executor once a worker is done with the file
+    co_return co_await HashScheduler::GetInstance().Submit(path, HashPriority::INTERACTIVE);
+}
+
+std::optional<ETagRecord> MakeETagRecord(const std::filesystem::path& path, const std::string& etag) noexcept
+{
+    const auto stat = utils::file::get_file_stat(path);
+    if (!stat.has_value() || etag.empty())
+    {
+        return std::nullopt;
+    }
+
+    return ETagRecord{etag, *stat};
+}
+
+std::string SerializeETagRecord(const ETagRecord& record)
+{
+    return std::format("{},{},{},{},{}", record.etag, record.stat.dev, record.stat.ino, record.stat.size, record.stat.mtime_ns);
+}
+
+ETagRecord ParseETagRecord(std::string_view str)
+{
+    ETagRecord record{};
+
+    size_t pos = str.find(',');
+    record.etag = str.substr(0, pos);
+    if (pos == std::string_view::npos)
+    {
+        return record;
+    }
+
+    auto next_field = [&str, &pos](auto& field) {
+        if (pos == std::string_view::npos)
+        {
+            return;
+        }
+
+        const size_t start = pos + 1;
+        pos = str.find(',', start);
+        const std::string_view field_str = str.substr(start, pos == std::string_view::npos ? std::string_view::npos : pos - start);
+        std::from_chars(field_str.data(), field_str.data() + field_str.size(), field);
+    };
+
+    next_field(record.stat.dev);
+    next_field(record.stat.ino);
+    next_field(record.stat.size);
+    next_field(record.stat.mtime_ns);
+
+    return record;
+}
+
+} // namespace FileETagService
@@ -1,15 +1,27 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <async_simple/coro/Lazy.h>
+
+#include "utils/file.h"
+#include "utils/hash.h"
 
 namespace FileETagService
 {
 
-struct FileETagTable
+// an etag together with the stat tuple of the file at the time it was hashed
+struct ETagRecord
 {
-  std::string path;
-  std::string sha;
+    std::string etag;
+    utils::file::FileStat stat;
 };
 
 class FileETagService
@@ -18,6 +30,106 @@ class FileETagService
     virtual ~FileETagService() = default;
     virtual std::string Get(const std::filesystem::path& path) noexcept = 0;
     virtual std::string Set(const std::filesystem::path& path) noexcept = 0;
+
+    // Get for several paths, the etags come back in the order of paths. Engines paying a round trip per lookup
+    // override it to fetch them all at once.
+    virtual std::vector<std::string> GetMany(const std::vector<std::filesystem::path>& paths) noexcept;
+
+    // Stores an etag the caller already computed (e.g. while a PUT body was streaming in) instead of
+    // reading the file back, the stat tuple is taken from the file as it is now.
+    virtual std::string Set(const std::filesystem::path& path, const std::string& etag) noexcept = 0;
+
+    // Returns the stored etag as long as the (dev, inode, size, mtime) tuple of the file is unchanged,
+    // only rehashes (through Set) when the file was actually modified.
+    virtual std::string GetValidated(const std::filesystem::path& path) noexcept = 0;
+
+    // Awaitable Get and GetValidated. By default they run on the blocking pool, engines with a non-blocking client
+    // override them so that no thread waits on the network.
+    virtual async_simple::coro::Lazy<std::string> GetAsync(std::filesystem::path path);
+
+    virtual async_simple::coro::Lazy<std::string> GetValidatedAsync(std::filesystem::path path);
+
+    // Drops the stored etag unless its stat tuple still matches the file, called when something outside the handlers
+    // may have touched it. A record that is still valid (e.g. one a PUT just stored) is kept.
+    virtual void Invalidate(const std::filesystem::path& path) noexcept = 0;
+};
+
+// The configured [engine.etag_algorithm]. Etags are written as "algorithm:hex" so that the ones stored before the
+// algorithm was switched stay valid (until the file changes), a bare hex etag is a sha256 one from before the prefix.
+[[nodiscard]]
+utils::hash::Algorithm GetETagAlgorithm();
+
+// directory -> ComputeDirectoryETag(), regular file -> hash of the content, anything else -> empty string
+[[nodiscard]]
+std::string ComputeETag(const std::filesystem::path& path) noexcept(false);
+
+// The members of a directory combined independently of their order: each one's hash, of its name and stored etag, is
+// added up lane by lane (wrapping), so that a changed member's old part can be subtracted again (see DirectoryETags).
+struct DirectoryDigest
+{
+    std::array<uint64_t, 4> lanes{};
+
+    void Add(const DirectoryDigest& other) noexcept;
+
+    void Subtract(const DirectoryDigest& other) noexcept;
+};
+
+// A member without an etag yet is represented by its stat tuple, nothing is hashed here. Empty for a member that is
+// neither a directory nor a regular file.
+[[nodiscard]]
+std::optional<DirectoryDigest> MemberDigest(const std::filesystem::path& member, const std::string& etag);
+
+// the directory and regular file members of dir by name, with their digests
+[[nodiscard]]
+std::vector<std::pair<std::string, DirectoryDigest>> ListMemberDigests(const std::filesystem::path& dir) noexcept(false);
+
+[[nodiscard]]
+std::string DirectoryETag(const DirectoryDigest& digest);
+
+// The sum of the members' digests, so it changes whenever anything below the directory does (DirectoryETags keeps
+// the directories above every change up to date).
+[[nodiscard]]
+std::string ComputeDirectoryETag(const std::filesystem::path& dir) noexcept(false);
+
+// the etag of content that arrives piece by piece (e.g. a PUT body), so that the file never has to be read back
+class ETagHasher
+{
+  public:
+    ETagHasher();
+
+    void Update(std::string_view data);
+
+    // finishes the computation, the hasher must not be updated afterwards
+    [[nodiscard]]
+    std::string Final();
+
+  private:
+    utils::hash::Algorithm algorithm_;
+    utils::hash::Hasher hasher_;
 };
 
+// Hashes the file and returns the record to be stored. The stat tuple is taken before hashing and checked again
+// afterwards, a file modified while being hashed gets an empty stat so that the next validation rehashes it.
+[[nodiscard]]
+std::optional<ETagRecord> HashETagRecord(const std::filesystem::path& path) noexcept(false);
+
+// HashETagRecord() on the HashScheduler, shared with everyone else asking for the same path meanwhile
+[[nodiscard]]
+std::optional<ETagRecord> ComputeETagRecord(const std::filesystem::path& path) noexcept(false);
+
+// ComputeETagRecord() for the async paths, nothing blocks while the file is queued and hashed
+[[nodiscard]]
+async_simple::coro::Lazy<std::optional<ETagRecord>> ComputeETagRecordAsync(std::filesystem::path path);
+
+// pairs a precomputed etag with the current stat tuple of the file
+[[nodiscard]]
+std::optional<ETagRecord> MakeETagRecord(const std::filesystem::path& path, const std::string& etag) noexcept;
+
+// "etag,dev,ino,size,mtime_ns" <-> ETagRecord, a bare "etag" (old format) parses with an empty stat
+[[nodiscard]]
+std::string SerializeETagRecord(const ETagRecord& record);
+
+[[nodiscard]]
+ETagRecord ParseETagRecord(std::string_view str);
+
 } // namespace FileETagService
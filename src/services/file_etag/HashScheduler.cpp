@@ -0,0 +1,307 @@
+#include "HashScheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "ConfigManager.h"
+#include "services/FileETagServiceFactory.h"
+#include "utils/path.h"
+
+namespace FileETagService
+{
+
+// set on the workers, where waiting for queued work could wait for itself
+static thread_local bool on_worker = false;
+
+static uint64_t elapsed_us(const std::chrono::steady_clock::time_point since)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+HashScheduler& HashScheduler::GetInstance()
+{
+    static HashScheduler instance{ConfigManager::GetInstance().GetEngineETagThreads()};
+    return instance;
+}
+
+HashScheduler::HashScheduler(const size_t threads)
+{
+    workers_.reserve(std::max<size_t>(threads, 1));
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+    {
+        workers_.emplace_back([this](const std::stop_token& stop_token) { WorkerLoop(stop_token); });
+    }
+}
+
+HashScheduler::~HashScheduler()
+{
+    // the running tasks are finished, whoever still waits for a queued one gets an error
+    workers_.clear();
+
+    std::vector<async_simple::Promise<ResultT>> waiters;
+    for (auto& [key, task] : hashing_)
+    {
+        std::move(task->waiters.begin(), task->waiters.end(), std::back_inserter(waiters));
+    }
+    for (auto& waiter : waiters)
+    {
+        waiter.setException(std::make_exception_ptr(std::runtime_error("etag hashing is shutting down")));
+    }
+}
+
+async_simple::Future<HashScheduler::ResultT> HashScheduler::Submit(const std::filesystem::path& path, const HashPriority priority)
+{
+    async_simple::Promise<ResultT> promise;
+    auto future = promise.getFuture();
+    {
+        std::lock_guard lock{mutex_};
+        std::string key = utils::path::to_string(path);
+        TaskPtrT& task = hashing_[key];
+        if (task != nullptr)
+        {
+            ++stats_.coalesced;
+            task->waiters.push_back(std::move(promise));
+            Promote(*task, priority);
+            return future;
+        }
+
+        task = std::make_shared<Task>(path, std::move(key));
+        task->waiters.push_back(std::move(promise));
+        Enqueue(task, priority);
+    }
+
+    cv_.notify_one();
+    return future;
+}
+
+HashScheduler::ResultT HashScheduler::Compute(const std::filesystem::path& path, const HashPriority priority)
+{
+    if (!on_worker)
+    {
+        return Submit(path, priority).get();
+    }
+
+    TaskPtrT task;
+    std::optional<async_simple::Future<ResultT>> running;
+    {
+        std::lock_guard lock{mutex_};
+        std::string key = utils::path::to_string(path);
+        TaskPtrT& slot = hashing_[key];
+        if (slot == nullptr)
+        {
+            slot = std::make_shared<Task>(path, std::move(key));
+        }
+        else
+        {
+            ++stats_.coalesced;
+        }
+
+        // the one hashing it is busy with it already, waiting for that can not wait for ourselves
+        if (slot->started)
+        {
+            async_simple::Promise<ResultT> promise;
+            running.emplace(promise.getFuture());
+            slot->waiters.push_back(std::move(promise));
+        }
+        else
+        {
+            Start(*slot);
+            task = slot;
+        }
+    }
+
+    if (running.has_value())
+    {
+        return std::move(*running).get();
+    }
+    return Run(task);
+}
+
+void HashScheduler::Refresh(const std::filesystem::path& path)
+{
+    {
+        std::lock_guard lock{mutex_};
+        std::string key = utils::path::to_string(path);
+        TaskPtrT& task = refreshing_[key];
+        if (task != nullptr)
+        {
+            return;
+        }
+
+        task = std::make_shared<Task>(path, std::move(key), true);
+        Enqueue(task, HashPriority::BACKGROUND);
+    }
+
+    cv_.notify_one();
+}
+
+HashSchedulerStats HashScheduler::GetStats()
+{
+    std::lock_guard lock{mutex_};
+    return stats_;
+}
+
+void HashScheduler::Enqueue(const TaskPtrT& task, const HashPriority priority)
+{
+    task->priority = priority;
+    task->queued = true;
+    task->queued_at = ClockT::now();
+    queues_[static_cast<size_t>(priority)].push_back(task);
+    ++(priority == HashPriority::INTERACTIVE ? stats_.interactive_queued : stats_.background_queued);
+}
+
+void HashScheduler::Promote(Task& task, const HashPriority priority)
+{
+    if (!task.queued || priority != HashPriority::INTERACTIVE || task.priority == HashPriority::INTERACTIVE)
+    {
+        return;
+    }
+
+    task.priority = HashPriority::INTERACTIVE;
+    --stats_.background_queued;
+    ++stats_.interactive_queued;
+    queues_[static_cast<size_t>(HashPriority::INTERACTIVE)].push_back(hashing_.at(task.key));
+}
+
+HashScheduler::TaskPtrT HashScheduler::Pop()
+{
+    for (size_t priority = 0; priority < std::size(queues_); ++priority)
+    {
+        auto& queue = queues_[priority];
+        while (!queue.empty())
+        {
+            TaskPtrT task = std::move(queue.front());
+            queue.pop_front();
+
+            // taken over by a worker that needed it, or moved up and found in the interactive queue already
+            if (!task->queued || static_cast<size_t>(task->priority) != priority)
+            {
+                continue;
+            }
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+void HashScheduler::Start(Task& task)
+{
+    task.started = true;
+    ++stats_.running;
+    if (!task.queued)
+    {
+        return;
+    }
+
+    task.queued = false;
+    --(task.priority == HashPriority::INTERACTIVE ? stats_.interactive_queued : stats_.background_queued);
+
+    const uint64_t wait_us = elapsed_us(task.queued_at);
+    stats_.queue_wait_us += wait_us;
+    stats_.max_queue_wait_us = std::max(stats_.max_queue_wait_us, wait_us);
+}
+
+HashScheduler::ResultT HashScheduler::Run(const TaskPtrT& task)
+{
+    const auto start = ClockT::now();
+
+    ResultT result;
+    std::exception_ptr error;
+    try
+    {
+        result = HashETagRecord(task->path);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    // once it is out of the map a new request for the path hashes again, the ones that joined until now get this result
+    std::vector<async_simple::Promise<ResultT>> waiters;
+    {
+        std::lock_guard lock{mutex_};
+        if (const auto it = hashing_.find(task->key); it != hashing_.end() && it->second == task)
+        {
+            hashing_.erase(it);
+        }
+        waiters.swap(task->waiters);
+
+        --stats_.running;
+        ++stats_.hashed;
+        stats_.hash_us += elapsed_us(start);
+    }
+
+    for (auto& waiter : waiters)
+    {
+        if (error != nullptr)
+        {
+            waiter.setException(error);
+        }
+        else
+        {
+            waiter.setValue(ResultT{result});
+        }
+    }
+
+    if (error != nullptr)
+    {
+        std::rethrow_exception(error);
+    }
+    return result;
+}
+
+void HashScheduler::RunRefresh(const TaskPtrT& task)
+{
+    static auto& etag_service = GetService();
+
+    // a change reported while revalidating queues the path again
+    {
+        std::lock_guard lock{mutex_};
+        refreshing_.erase(task->key);
+    }
+
+    // hashes (on this worker) only when the stored record no longer matches the file
+    etag_service.GetValidated(task->path);
+
+    std::lock_guard lock{mutex_};
+    --stats_.running;
+}
+
+void HashScheduler::WorkerLoop(const std::stop_token& stop_token)
+{
+    on_worker = true;
+    while (true)
+    {
+        TaskPtrT task;
+        {
+            std::unique_lock lock{mutex_};
+            // whatever is still queued at shutdown is left to the destructor
+            if (!cv_.wait(lock, stop_token, [this, &task]() { return (task = Pop()) != nullptr; }) || stop_token.stop_requested())
+            {
+                return;
+            }
+            Start(*task);
+        }
+
+        if (task->is_refresh)
+        {
+            RunRefresh(task);
+            continue;
+        }
+
+        try
+        {
+            static_cast<void>(Run(task));
+        }
+        catch (...)
+        {
+            // handed to the waiters already
+        }
+    }
+}
+
+} // namespace FileETagService
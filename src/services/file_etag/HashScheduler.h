@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <async_simple/Future.h>
+#include <async_simple/Promise.h>
+
+#include "FileETagService.h"
+
+namespace FileETagService
+{
+
+enum class HashPriority
+{
+    INTERACTIVE = 0,
+    BACKGROUND
+};
+
+struct HashSchedulerStats
+{
+    uint64_t interactive_queued = 0;
+    uint64_t background_queued = 0;
+    uint64_t running = 0;
+    uint64_t hashed = 0;
+    uint64_t coalesced = 0;
+
+    // summed over the hashed files, from being queued to a worker picking them up, and the hashing itself
+    uint64_t queue_wait_us = 0;
+    uint64_t max_queue_wait_us = 0;
+    uint64_t hash_us = 0;
+};
+
+/*
+    All etag hashing goes through a fixed number of workers, [engine.etag_threads]. A path is hashed at most once at a
+    time: whoever asks for it while it is queued or being hashed waits for that computation instead of starting another
+    one, so a burst of requests for a file that just changed costs one read of it. Interactive work (a request waiting
+    for the etag) is always picked up before background work, a background task that an interactive request joins is
+    moved up to the interactive queue.
+
+    Background work revalidates the etags of paths reported to the MutationService, so that a file changed by another
+    program is usually hashed again before the next request asks for it.
+ */
+class HashScheduler
+{
+  public:
+    using ResultT = std::optional<ETagRecord>;
+
+    static HashScheduler& GetInstance();
+
+    explicit HashScheduler(size_t threads);
+    ~HashScheduler();
+
+    HashScheduler(const HashScheduler&) = delete;
+    HashScheduler& operator=(const HashScheduler&) = delete;
+
+    // the record ComputeETagRecord() would return, an error while hashing is handed to every waiter
+    [[nodiscard]]
+    async_simple::Future<ResultT> Submit(const std::filesystem::path& path, HashPriority priority);
+
+    // Waits for Submit(). Called on one of the workers (while a background task revalidates), the path is hashed
+    // right there, a worker never waits for work that is still queued.
+    [[nodiscard]]
+    ResultT Compute(const std::filesystem::path& path, HashPriority priority);
+
+    // queues a GetValidated() of the path through the configured engine, at most once per path
+    void Refresh(const std::filesystem::path& path);
+
+    [[nodiscard]]
+    HashSchedulerStats GetStats();
+
+  private:
+    using ClockT = std::chrono::steady_clock;
+
+    struct Task
+    {
+        std::filesystem::path path;
+        std::string key;
+        bool is_refresh = false;
+        HashPriority priority = HashPriority::INTERACTIVE;
+        bool queued = false;
+        bool started = false;
+        ClockT::time_point queued_at;
+        std::vector<async_simple::Promise<ResultT>> waiters;
+    };
+
+    using TaskPtrT = std::shared_ptr<Task>;
+
+    void Enqueue(const TaskPtrT& task, HashPriority priority);
+
+    void Promote(Task& task, HashPriority priority);
+
+    TaskPtrT Pop();
+
+    void Start(Task& task);
+
+    ResultT Run(const TaskPtrT& task);
+
+    void RunRefresh(const TaskPtrT& task);
+
+    void WorkerLoop(const std::stop_token& stop_token);
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+
+    // indexed by HashPriority, a task moved up stays in the background queue and is skipped there
+    std::deque<TaskPtrT> queues_[2];
+    std::unordered_map<std::string, TaskPtrT> hashing_;
+    std::unordered_map<std::string, TaskPtrT> refreshing_;
+    HashSchedulerStats stats_;
+
+    std::vector<std::jthread> workers_;
+};
+
+} // namespace FileETagService
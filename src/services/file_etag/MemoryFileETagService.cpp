@@ -3,6 +3,7 @@
 #include <exception>
 #include <filesystem>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <string_view>
@@ -10,114 +11,269 @@
 
 #include "ConfigManager.h"
 #include "logger.hpp"
-#include "utils.h"
+#include "utils/file.h"
 #include "utils/path.h"
 
 namespace FileETagService
 {
 
+// journal records: "S" path serialized-record | "E" path, snapshot entries: path -> serialized-record
+static constexpr std::string_view OP_STORE = "S";
+static constexpr std::string_view OP_ERASE = "E";
+
+static std::string encode_store(const std::filesystem::path& path, const ETagRecord& record)
+{
+    std::string encoded;
+    utils::journal::append_field(encoded, OP_STORE);
+    utils::journal::append_field(encoded, utils::path::to_string(path));
+    utils::journal::append_field(encoded, SerializeETagRecord(record));
+    return encoded;
+}
+
+static std::string encode_erase(const std::filesystem::path& path)
+{
+    std::string encoded;
+    utils::journal::append_field(encoded, OP_ERASE);
+    utils::journal::append_field(encoded, utils::path::to_string(path));
+    return encoded;
+}
+
 MemoryFileETagService::MemoryFileETagService()
+    : journal_(ConfigManager::GetInstance().GetETagData(), ConfigManager::GetInstance().GetDataJournalCompactSize(),
+               [this](const utils::Journal::EmitT& emit) {
+                   loader_.WaitLoaded();
+                   etag_map_.ForEach([&emit](const ETagMapKeyT& path, const ETagMapValueT& record) {
+                       if (!record.etag.empty())
+                       {
+                           emit(utils::path::to_string(path), SerializeETagRecord(record));
+                       }
+                   });
+               })
 {
-    const auto& conf = ConfigManager::GetInstance();
-    const auto& data_path = conf.GetETagData();
-    const std::string data_path_str = utils::path::to_string(data_path);
+    const auto& data_path = ConfigManager::GetInstance().GetETagData();
+    const bool is_text = std::filesystem::exists(data_path) && !utils::MappedTable::IsTable(data_path) && !utils::Journal::IsJournalFile(data_path);
+    if (is_text)
+    {
+        LoadTextData(data_path);
+    }
+
+    // started before the journal is replayed, the loader never overwrites what the journal brings back
+    const uint64_t snapshot_size = loader_.Start(
+        data_path,
+        [this](const std::string_view key, const std::string_view value) { etag_map_.InsertIfAbsent(ETagMapKeyT{key}, ParseETagRecord(value)); },
+        [this]() { etag_map_.EraseIf([](const ETagMapValueT& record) { return record.etag.empty(); }); });
 
-    if (std::filesystem::exists(data_path))
+    if (!journal_.Open([this](const std::string_view record) { Apply(record); }))
     {
-        std::ifstream ifs{data_path, std::ios::in};
-        if (!ifs.is_open())
-        {
-            LOG_ERROR_FMT("Unable to open '{}', unable to recover file etags.", data_path_str)
-            return;
-        }
+        LOG_ERROR_FMT("Unable to save file etags to '{}', they are lost when the server stops.", utils::path::to_string(data_path))
+        return;
+    }
+    if (is_text)
+    {
+        journal_.RequestCompaction();
+    }
 
-        // line string like this: path@etag
-        std::string raw_line{};
-        while (std::getline(ifs, raw_line))
+    LOG_INFO_FMT("Mapped {} file etags from '{}', they are loaded in the background", snapshot_size, utils::path::to_string(data_path))
+}
+
+std::string MemoryFileETagService::Get(const std::filesystem::path& path) noexcept
+{
+    Fault(path);
+
+    std::string etag{};
+    etag_map_.Visit(path, [&etag](const ETagMapValueT& record) { etag = record.etag; });
+    return etag;
+}
+
+std::string MemoryFileETagService::Set(const std::filesystem::path& path) noexcept
+{
+    try
+    {
+        auto record = ComputeETagRecord(path);
+        if (!record.has_value())
         {
-            const std::string_view line = raw_line;
-            auto pos = line.find_last_of('@');
-            if (pos == std::string_view::npos)
-            {
-                continue;
-            }
-
-            auto path_str = line.substr(0, pos);
-            auto etag = line.substr(pos + 1);
-            if (path_str.empty() || etag.empty())
-            {
-                continue;
-            }
-
-            etag_map_.insert({ETagMapKeyT{path_str}, ETagMapValueT{etag}});
+            LOG_WARN("Unexpected file type.")
+            Erase(path, [](const ETagMapValueT&) { return true; });
+            return {""};
         }
-    }
 
-    data_.open(data_path, std::ios::out);
-    if (!data_.is_open())
+        std::string etag = record->etag;
+        Store(path, std::move(*record));
+        return etag;
+    }
+    catch (const std::exception& err)
     {
-        LOG_ERROR_FMT("Unable to save file etag to '{}', file properties are lost when the server stops.",
-                      data_path_str)
+        LOG_ERROR(err.what())
+        return {""};
     }
 }
 
-MemoryFileETagService::~MemoryFileETagService()
+std::string MemoryFileETagService::Set(const std::filesystem::path& path, const std::string& etag) noexcept
 {
-    if (!data_.is_open())
-        return;
-
-    for (const auto& [path_sha, etag] : etag_map_)
+    auto record = MakeETagRecord(path, etag);
+    if (!record.has_value())
     {
-        data_ << utils::path::to_string(path_sha) << ',' << etag << std::endl;
+        return {""};
     }
 
-    const auto& conf = ConfigManager::GetInstance();
-    LOG_INFO_FMT("The file etag have been saved to {}", utils::path::to_string(conf.GetETagData()))
+    Store(path, std::move(*record));
+    return etag;
 }
 
-std::string MemoryFileETagService::Get(const std::filesystem::path& path) noexcept
+std::string MemoryFileETagService::GetValidated(const std::filesystem::path& path) noexcept
 {
-    const auto& it = etag_map_.find(path);
-    if (it == etag_map_.end())
+    const auto stat = utils::file::get_file_stat(path);
+    if (!stat.has_value())
     {
         return {""};
     }
 
-    return {it->second};
+    Fault(path);
+
+    std::string etag{};
+    etag_map_.Visit(path, [&etag, &stat](const ETagMapValueT& record) {
+        if (record.stat == *stat)
+        {
+            etag = record.etag;
+        }
+    });
+    if (!etag.empty())
+    {
+        return etag;
+    }
+
+    return Set(path);
 }
 
-std::string MemoryFileETagService::Set(const std::filesystem::path& path) noexcept
+void MemoryFileETagService::Invalidate(const std::filesystem::path& path) noexcept
 {
-    try
-    {
-        const auto& it = etag_map_.find(path);
-        if (it != etag_map_.end())
+    // stat outside of the lock, the record is compared (and dropped) under it
+    const auto stat = utils::file::get_file_stat(path);
+    Erase(path, [&stat](const ETagMapValueT& record) { return !stat.has_value() || record.stat != *stat; });
+}
+
+void MemoryFileETagService::Store(const std::filesystem::path& path, ETagRecord record)
+{
+    std::string encoded = encode_store(path, record);
+    etag_map_.Update(path, [this, &record, &encoded](ETagMapValueT& stored) {
+        stored = std::move(record);
+        journal_.Append(encoded);
+    });
+}
+
+void MemoryFileETagService::Erase(const std::filesystem::path& path, const std::function<bool(const ETagMapValueT&)>& pred)
+{
+    const auto drop = [this, &path, &pred](const ETagMapValueT& record) {
+        if (record.etag.empty() || !pred(record))
         {
-            etag_map_.erase(it);
+            return false;
         }
 
-        ETagMapValueT sha{};
-        if (std::filesystem::is_directory(path))
+        journal_.Append(encode_erase(path));
+        return true;
+    };
+
+    if (loader_.IsLoaded())
+    {
+        etag_map_.EraseIf(path, drop);
+        return;
+    }
+
+    // a tombstone only where the snapshot has a record (faulted in first) that must not come back
+    Fault(path);
+    etag_map_.Modify(path, [&drop](ETagMapValueT& record) {
+        if (drop(record))
         {
-            sha = utils::sha256(utils::path::to_string(path));
+            record = {};
         }
-        else if (std::filesystem::is_regular_file(path))
+    });
+    DropTombstone(path);
+}
+
+void MemoryFileETagService::DropTombstone(const std::filesystem::path& path)
+{
+    // the load finished meanwhile, the tombstones may have been purged before this one was written
+    if (loader_.IsLoaded())
+    {
+        etag_map_.EraseIf(path, [](const ETagMapValueT& record) { return record.etag.empty(); });
+    }
+}
+
+void MemoryFileETagService::Fault(const std::filesystem::path& path)
+{
+    if (loader_.IsLoaded())
+    {
+        return;
+    }
+
+    if (const auto value = loader_.Find(utils::path::to_string(path)); value.has_value())
+    {
+        etag_map_.InsertIfAbsent(path, ParseETagRecord(*value));
+    }
+}
+
+void MemoryFileETagService::Apply(std::string_view record)
+{
+    const auto op = utils::journal::read_field(record);
+    const auto path = utils::journal::read_field(record);
+    if (!op.has_value() || !path.has_value())
+    {
+        return;
+    }
+
+    if (*op == OP_STORE)
+    {
+        if (const auto serialized = utils::journal::read_field(record); serialized.has_value())
         {
-            sha = utils::sha256(path);
+            etag_map_.InsertOrAssign(ETagMapKeyT{*path}, ParseETagRecord(*serialized));
         }
-        else
+    }
+    else if (*op == OP_ERASE)
+    {
+        const ETagMapKeyT key_path{*path};
+        if (loader_.IsLoaded() || !loader_.Find(*path).has_value())
         {
-            LOG_WARN("Unexpected file type.")
-            return {""};
+            etag_map_.Erase(key_path);
+            return;
         }
+        etag_map_.InsertOrAssign(key_path, ETagRecord{});
+        DropTombstone(key_path);
+    }
+}
 
-        etag_map_.insert({path, sha});
-        return sha;
+void MemoryFileETagService::LoadTextData(const std::filesystem::path& data_path)
+{
+    std::ifstream ifs{data_path, std::ios::in};
+    if (!ifs.is_open())
+    {
+        LOG_ERROR_FMT("Unable to open '{}', unable to recover file etags.", utils::path::to_string(data_path))
+        return;
     }
-    catch (const std::exception& err)
+
+    // line string like this: path@etag,dev,ino,size,mtime_ns (the stat part is missing in old files)
+    // the oldest files have path,etag lines, those etags come back without a stat and are rehashed on first use
+    std::string raw_line{};
+    while (std::getline(ifs, raw_line))
     {
-        LOG_ERROR(err.what())
-        return {""};
+        const std::string_view line = raw_line;
+        auto pos = line.find_last_of('@');
+        if (pos == std::string_view::npos)
+        {
+            pos = line.find_last_of(',');
+        }
+        if (pos == std::string_view::npos)
+        {
+            continue;
+        }
+
+        auto path_str = line.substr(0, pos);
+        auto etag = line.substr(pos + 1);
+        if (path_str.empty() || etag.empty())
+        {
+            continue;
+        }
+
+        etag_map_.InsertOrAssign(ETagMapKeyT{path_str}, ParseETagRecord(etag));
     }
 }
 
@@ -1,33 +1,70 @@
 #pragma once
 
 #include <filesystem>
-#include <fstream>
+#include <functional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 #include "FileETagService.h"
+#include "utils/journal.h"
+#include "utils/mapped_table.h"
+#include "utils/sharded_map.h"
 
 namespace FileETagService
 {
 
+/*
+    Safe to call from any number of I/O and blocking threads, the map is sharded with a reader/writer lock per shard.
+    Every change is journaled (under the shard's lock, so the journal has the same order as the map) and snapshots
+    are written in the background. Callers do not wait for the journal to be synced: a record lost in a crash only
+    costs a rehash, since every record is validated against the file's stat tuple anyway.
+
+    The snapshot is mapped at startup and loaded into the map in the background, lookups fault the entries they
+    need in before that. A record with an empty etag is a tombstone left behind by a removal during the load, they
+    are purged once it is done.
+ */
 class MemoryFileETagService : public FileETagService
 {
   public:
     using ETagMapKeyT = std::filesystem::path;
-    using ETagMapValueT = std::string;
-    using ETagMapT = std::unordered_map<ETagMapKeyT, ETagMapValueT>;
+    using ETagMapValueT = ETagRecord;
+    using ETagMapT = utils::ShardedMap<ETagMapKeyT, ETagMapValueT>;
 
     MemoryFileETagService();
 
-    ~MemoryFileETagService();
-
     std::string Get(const std::filesystem::path& path) noexcept override;
 
     std::string Set(const std::filesystem::path& path) noexcept override;
 
+    std::string Set(const std::filesystem::path& path, const std::string& etag) noexcept override;
+
+    std::string GetValidated(const std::filesystem::path& path) noexcept override;
+
+    void Invalidate(const std::filesystem::path& path) noexcept override;
+
   private:
+    void Store(const std::filesystem::path& path, ETagRecord record);
+
+    // drops the record when pred holds for it
+    void Erase(const std::filesystem::path& path, const std::function<bool(const ETagMapValueT&)>& pred);
+
+    // for a tombstone written while the load may have completed, the ones written before are purged after it
+    void DropTombstone(const std::filesystem::path& path);
+
+    // copies the record from the snapshot into the map while the snapshot is still being loaded
+    void Fault(const std::filesystem::path& path);
+
+    // applies a journal record while recovering
+    void Apply(std::string_view record);
+
+    // reads the "path@etag,dev,ino,size,mtime_ns" lines written before there was a journal
+    void LoadTextData(const std::filesystem::path& data_path);
+
     ETagMapT etag_map_;
-    std::ofstream data_;
+    utils::TableLoader loader_;
+
+    // after the map, the final snapshot is taken from it when the journal is destroyed
+    utils::Journal journal_;
 };
 
 } // namespace FileETagService
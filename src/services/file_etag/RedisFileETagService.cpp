@@ -1,78 +1,282 @@
 #include "RedisFileETagService.h"
 
-#include <cassert>
+#include <algorithm>
+#include <exception>
 #include <format>
 #include <iostream>
+#include <string_view>
 
 #include <hiredis/hiredis.h>
 
-#include "ConfigManager.h"
 #include "logger.hpp"
-#include "utils.h"
+#include "utils/file.h"
 #include "utils/path.h"
+#include "utils/blocking.h"
 #include "utils/redis.h"
+#include "utils/redis_async.h"
 
 using namespace utils::redis;
 
 namespace FileETagService
 {
 
-RedisFileETagService::RedisFileETagService() : redis_ctx_(nullptr, &redisFree)
+// lookups sent in one pipeline, bounds what sits in the socket buffers on either side
+static constexpr size_t PIPELINE_SIZE = 512;
+
+// deletes KEYS[1] only while it still holds ARGV[1], a record stored meanwhile (by a PUT, or a hash) is kept
+static constexpr std::string_view COMPARE_AND_DELETE =
+    "if redis.call('GET', KEYS[1]) == ARGV[1] then return redis.call('DEL', KEYS[1]) end return 0";
+
+static std::string etag_key(const std::filesystem::path& path)
 {
-    const auto& conf = ConfigManager::GetInstance();
+    return "etag:" + utils::path::to_string(path);
+}
 
-    redis_ctx_ = GetRedisContext(conf.GetRedisHost(), conf.GetRedisPort());
-    if (redis_ctx_->err)
+// the etag of a GET reply, empty for a nil reply
+static std::string reply_etag(const utils::resp::Reply& reply)
+{
+    // value string like this: etag,dev,ino,size,mtime_ns
+    if (reply.type != utils::resp::Reply::Type::String || reply.str.empty())
     {
-        throw std::runtime_error(redis_ctx_->errstr);
+        return {""};
     }
 
-    if (!RedisAuth(redis_ctx_.get(), conf.GetRedisUserName(), conf.GetRedisPassword()))
-    {
-        throw std::runtime_error("Auth failed.");
-    }
+    return ParseETagRecord(reply.str).etag;
+}
+
+RedisFileETagService::RedisFileETagService() : pool_(Pool::GetInstance()), async_client_(AsyncClient::GetInstance())
+{
+    // fails early on a server that cannot be reached or refuses the credentials
+    [[maybe_unused]] const Pool::Lease connection = pool_.Acquire();
 }
 
 std::string RedisFileETagService::Get(const std::filesystem::path& path) noexcept
 {
-    const std::string key = utils::path::to_string(path);
-    const std::string command = std::format("GET etag:{}", key);
+    try
+    {
+        const RedisReplyT repl = pool_.Acquire()->Execute({"GET", etag_key(path)});
 
-    RedisReplyT repl = RedisExecute(redis_ctx_.get(), command);
-    if (!repl)
+        // value string like this: etag,dev,ino,size,mtime_ns
+        const std::string_view value = reply_str(repl.get());
+        return value.empty() ? std::string{""} : ParseETagRecord(value).etag;
+    }
+    catch (const std::exception& err)
     {
+        LOG_ERROR(err.what())
         return {""};
     }
+}
+
+std::vector<std::string> RedisFileETagService::GetMany(const std::vector<std::filesystem::path>& paths) noexcept
+{
+    std::vector<std::string> etags(paths.size());
+    try
+    {
+        const Pool::Lease connection = pool_.Acquire();
+
+        std::vector<std::string> keys;
+        std::vector<CommandT> commands;
+        for (size_t begin = 0; begin < paths.size(); begin += PIPELINE_SIZE)
+        {
+            const size_t end = std::min(paths.size(), begin + PIPELINE_SIZE);
+
+            keys.clear();
+            commands.clear();
+            for (size_t i = begin; i < end; ++i)
+            {
+                keys.push_back(etag_key(paths[i]));
+            }
+            for (const auto& key : keys)
+            {
+                commands.push_back({"GET", key});
+            }
 
-    return {repl->str};
+            const auto replies = connection->Pipeline(commands);
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (const std::string_view value = reply_str(replies[i - begin].get()); !value.empty())
+                {
+                    etags[i] = ParseETagRecord(value).etag;
+                }
+            }
+        }
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+
+    return etags;
 }
 
 std::string RedisFileETagService::Set(const std::filesystem::path& path) noexcept
 {
-    const std::string path_str = utils::path::to_string(path);
-    std::string sha{};
-    if (std::filesystem::is_directory(path))
+    try
     {
-        sha = utils::sha256(path_str);
+        const auto record = ComputeETagRecord(path);
+        if (!record.has_value())
+        {
+            LOG_WARN("Unexpected file type.")
+            return {""};
+        }
+
+        return Store(etag_key(path), *record) ? record->etag : std::string{""};
     }
-    else if (std::filesystem::is_regular_file(path))
+    catch (const std::exception& err)
     {
-        sha = utils::sha256(path);
+        LOG_ERROR(err.what())
+        return {""};
     }
-    else
+}
+
+std::string RedisFileETagService::Set(const std::filesystem::path& path, const std::string& etag) noexcept
+{
+    const auto record = MakeETagRecord(path, etag);
+    if (!record.has_value())
     {
-        LOG_WARN("Unexpected file type.")
         return {""};
     }
 
-    const std::string command = std::format(R"(SET etag:{} "{}")", path_str, sha);
-    RedisReplyT repl = RedisExecute(redis_ctx_.get(), command);
-    if (!repl || repl->integer != 1)
+    return Store(etag_key(path), *record) ? etag : std::string{""};
+}
+
+std::string RedisFileETagService::GetValidated(const std::filesystem::path& path) noexcept
+{
+    const auto stat = utils::file::get_file_stat(path);
+    if (!stat.has_value())
     {
         return {""};
     }
 
-    return sha;
+    try
+    {
+        const RedisReplyT repl = pool_.Acquire()->Execute({"GET", etag_key(path)});
+        if (const std::string_view value = reply_str(repl.get()); !value.empty())
+        {
+            if (ETagRecord record = ParseETagRecord(value); record.stat == *stat)
+            {
+                return record.etag;
+            }
+        }
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+
+    return Set(path);
+}
+
+void RedisFileETagService::Invalidate(const std::filesystem::path& path) noexcept
+{
+    const std::string key = etag_key(path);
+    try
+    {
+        const Pool::Lease connection = pool_.Acquire();
+
+        const RedisReplyT repl = connection->Execute({"GET", key});
+        const std::string_view value = reply_str(repl.get());
+        if (value.empty())
+        {
+            return;
+        }
+
+        if (const auto stat = utils::file::get_file_stat(path); stat.has_value() && ParseETagRecord(value).stat == *stat)
+        {
+            return;
+        }
+
+        if (!connection->Execute({"EVAL", COMPARE_AND_DELETE, "1", key, value}))
+        {
+            LOG_ERROR_FMT("Unable to invalidate the etag of '{}'.", key)
+        }
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+}
+
+async_simple::coro::Lazy<std::string> RedisFileETagService::GetAsync(std::filesystem::path path)
+{
+    try
+    {
+        const std::string key = etag_key(path);
+        const CommandT command{"GET", key};
+        co_return reply_etag(co_await async_client_.Execute(command));
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+
+    co_return std::string{""};
+}
+
+async_simple::coro::Lazy<std::string> RedisFileETagService::GetValidatedAsync(std::filesystem::path path)
+{
+    const auto stat = co_await utils::blocking::run([&path]() { return utils::file::get_file_stat(path); });
+    if (!stat.has_value())
+    {
+        co_return std::string{""};
+    }
+
+    try
+    {
+        const std::string key = etag_key(path);
+        const CommandT command{"GET", key};
+        const utils::resp::Reply reply = co_await async_client_.Execute(command);
+        if (reply.type == utils::resp::Reply::Type::String && !reply.str.empty())
+        {
+            if (ETagRecord record = ParseETagRecord(reply.str); record.stat == *stat)
+            {
+                co_return std::move(record.etag);
+            }
+        }
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+
+    try
+    {
+        // hashing reads the whole file, meanwhile the request holds no thread
+        const auto record = co_await ComputeETagRecordAsync(path);
+        if (!record.has_value())
+        {
+            LOG_WARN("Unexpected file type.")
+            co_return std::string{""};
+        }
+
+        const CommandT command{"SET", etag_key(path), SerializeETagRecord(*record)};
+        const utils::resp::Reply reply = co_await async_client_.Execute(command);
+        if (reply.type != utils::resp::Reply::Type::Status || reply.str != "OK")
+        {
+            co_return std::string{""};
+        }
+        co_return record->etag;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+
+    co_return std::string{""};
+}
+
+bool RedisFileETagService::Store(const std::string& key, const ETagRecord& record) noexcept
+{
+    try
+    {
+        const RedisReplyT repl = pool_.Acquire()->Execute({"SET", key, SerializeETagRecord(record)});
+        return repl && repl->type == REDIS_REPLY_STATUS && reply_str(repl.get()) == "OK";
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        return false;
+    }
 }
 
 } // namespace FileETagService
@@ -3,10 +3,10 @@
 
 #include <filesystem>
 #include <string>
-
-#include <hiredis/hiredis.h>
+#include <vector>
 
 #include "utils/redis.h"
+#include "utils/redis_async.h"
 
 namespace FileETagService
 {
@@ -18,11 +18,25 @@ class RedisFileETagService : public FileETagService
 
     std::string Get(const std::filesystem::path& path) noexcept override;
 
+    std::vector<std::string> GetMany(const std::vector<std::filesystem::path>& paths) noexcept override;
+
     std::string Set(const std::filesystem::path& path) noexcept override;
 
+    std::string Set(const std::filesystem::path& path, const std::string& etag) noexcept override;
+
+    std::string GetValidated(const std::filesystem::path& path) noexcept override;
+
+    void Invalidate(const std::filesystem::path& path) noexcept override;
+
+    async_simple::coro::Lazy<std::string> GetAsync(std::filesystem::path path) override;
+
+    async_simple::coro::Lazy<std::string> GetValidatedAsync(std::filesystem::path path) override;
+
   private:
-    std::string auth_str_;
-    utils::redis::RedisContextT redis_ctx_;
+    bool Store(const std::string& key, const ETagRecord& record) noexcept;
+
+    utils::redis::Pool& pool_;
+    utils::redis::AsyncClient& async_client_;
 };
 
 } // namespace FileETagService
@@ -1,80 +1,222 @@
 #include "SQLiteFileETagService.h"
 
+#include <exception>
 #include <format>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
 
-#include "ConfigManager.h"
 #include "logger.hpp"
-#include "utils.h"
+#include "utils/blocking.h"
+#include "utils/file.h"
 #include "utils/path.h"
 
 namespace FileETagService
 {
 
-SQLiteFileETagService::SQLiteFileETagService()
+static constexpr auto SELECT_SQL = "SELECT sha, dev, ino, size, mtime_ns FROM FileETagTable WHERE path = ?1";
+
+static constexpr auto UPSERT_SQL = "INSERT INTO FileETagTable (path, sha, dev, ino, size, mtime_ns) VALUES (?1, ?2, ?3, ?4, ?5, ?6) "
+                                   "ON CONFLICT(path) DO UPDATE SET sha = excluded.sha, dev = excluded.dev, ino = excluded.ino, "
+                                   "size = excluded.size, mtime_ns = excluded.mtime_ns";
+
+static constexpr auto DELETE_SQL = "DELETE FROM FileETagTable WHERE path = ?1";
+
+static ETagRecord read_record(const utils::sqlite::Statement& statement)
+{
+    return {statement.ColumnText(0),
+            {static_cast<uint64_t>(statement.ColumnInt(1)), static_cast<uint64_t>(statement.ColumnInt(2)),
+             static_cast<uint64_t>(statement.ColumnInt(3)), statement.ColumnInt(4)}};
+}
+
+SQLiteFileETagService::SQLiteFileETagService() : database_(utils::sqlite::Database::GetInstance())
 {
-    using namespace ormpp;
+    database_.Write([](utils::sqlite::Connection& connection) {
+        connection.Execute("CREATE TABLE IF NOT EXISTS FileETagTable (path TEXT NOT NULL PRIMARY KEY, sha TEXT, dev INTEGER DEFAULT 0, "
+                           "ino INTEGER DEFAULT 0, size INTEGER DEFAULT 0, mtime_ns INTEGER DEFAULT 0)");
 
-    if (const auto& conf = ConfigManager::GetInstance(); !dbng_.connect(utils::path::to_string(conf.GetSQLiteDB()).data(), "ETag"))
+        // databases created before the stat columns existed, the statements fail harmlessly when the column is already there
+        for (const char* column : {"dev", "ino", "size", "mtime_ns"})
+        {
+            try
+            {
+                connection.Execute(std::format("ALTER TABLE FileETagTable ADD COLUMN {} INTEGER DEFAULT 0", column).c_str());
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+        }
+    });
+}
+
+std::string SQLiteFileETagService::Get(const std::filesystem::path& path) noexcept
+{
+    try
+    {
+        const auto record = Find(utils::path::to_string(path));
+        return record.has_value() ? record->etag : std::string{""};
+    }
+    catch (const std::exception& err)
     {
-        throw std::runtime_error(dbng_.get_last_error());
+        LOG_ERROR(err.what())
+        return {""};
     }
+}
+
+std::string SQLiteFileETagService::Set(const std::filesystem::path& path) noexcept
+{
+    try
+    {
+        auto record = ComputeETagRecord(path);
+        if (!record.has_value())
+        {
+            LOG_WARN("Unexpected file type.")
+            return {""};
+        }
 
-    if (!dbng_.create_datatable<FileETagTable>(ormpp_key{"path"}))
+        return Store(utils::path::to_string(path), *record) ? record->etag : std::string{""};
+    }
+    catch (const std::exception& err)
     {
-        throw std::runtime_error(dbng_.get_last_error());
+        LOG_ERROR(err.what())
+        return {""};
     }
 }
 
-std::string SQLiteFileETagService::Get(const std::filesystem::path& path) noexcept
+std::string SQLiteFileETagService::Set(const std::filesystem::path& path, const std::string& etag) noexcept
 {
-    const std::string path_str = utils::path::to_string(path);
-    const auto query_res = dbng_.query_s<FileETagTable>(std::format("path='{}'", path_str));
-    if (query_res.size() != 1)
+    const auto record = MakeETagRecord(path, etag);
+    if (!record.has_value())
     {
-        LOG_ERROR("The database may be damaged.")
         return {""};
     }
 
-    return query_res[0].sha;
+    return Store(utils::path::to_string(path), *record) ? etag : std::string{""};
 }
 
-std::string SQLiteFileETagService::Set(const std::filesystem::path& path) noexcept
+std::string SQLiteFileETagService::GetValidated(const std::filesystem::path& path) noexcept
 {
-    std::string path_str = utils::path::to_string(path);
+    const auto stat = utils::file::get_file_stat(path);
+    if (!stat.has_value())
     {
-        const std::string where = std::format("path='{}'", path_str);
-        const auto query_res = dbng_.query_s<FileETagTable>(where);
-        if (!query_res.empty())
+        return {""};
+    }
+
+    try
+    {
+        if (const auto record = Find(utils::path::to_string(path)); record.has_value() && record->stat == *stat)
         {
-            if (!dbng_.delete_records_s<FileETagTable>(where))
-            {
-                LOG_ERROR("Data deletion failed.")
-            }
+            return record->etag;
         }
     }
-
-    std::string sha{};
-    if (std::filesystem::is_directory(path))
+    catch (const std::exception& err)
     {
-        sha = utils::sha256(path_str);
+        LOG_ERROR(err.what())
     }
-    else if (std::filesystem::is_regular_file(path))
+
+    return Set(path);
+}
+
+async_simple::coro::Lazy<std::string> SQLiteFileETagService::GetValidatedAsync(std::filesystem::path path)
+{
+    const std::string path_str = utils::path::to_string(path);
+    try
     {
-        sha = utils::sha256(path);
+        const auto [stat, record] = co_await utils::blocking::run([this, &path, &path_str]() {
+            return std::pair{utils::file::get_file_stat(path), Find(path_str)};
+        });
+        if (!stat.has_value())
+        {
+            co_return std::string{""};
+        }
+        if (record.has_value() && record->stat == *stat)
+        {
+            co_return record->etag;
+        }
+
+        // only the lookup and the store take a blocking thread, not the wait for the hash
+        const auto computed = co_await ComputeETagRecordAsync(path);
+        if (!computed.has_value())
+        {
+            LOG_WARN("Unexpected file type.")
+            co_return std::string{""};
+        }
+
+        const bool stored = co_await utils::blocking::run([this, &path_str, &computed]() { return Store(path_str, *computed); });
+        co_return stored ? computed->etag : std::string{""};
     }
-    else
+    catch (const std::exception& err)
     {
-        LOG_WARN("Unexpected file type.")
-        return {""};
+        LOG_ERROR(err.what())
     }
 
-    if (dbng_.insert<FileETagTable>({std::move(path_str), sha}) != 1)
+    co_return std::string{""};
+}
+
+void SQLiteFileETagService::Invalidate(const std::filesystem::path& path) noexcept
+{
+    const auto stat = utils::file::get_file_stat(path);
+    const std::string path_str = utils::path::to_string(path);
+    try
     {
-        LOG_ERROR("Data insertion error.");
-        return {""};
+        // compared and deleted in the same transaction, so a record stored in between is not dropped by mistake
+        database_.Write([&stat, &path_str](utils::sqlite::Connection& connection) {
+            auto& select = connection.Prepare(SELECT_SQL);
+            select.Bind(1, path_str);
+            if (!select.Step())
+            {
+                return;
+            }
+
+            const bool valid = stat.has_value() && read_record(select).stat == *stat;
+            select.Reset();
+            if (!valid)
+            {
+                connection.Prepare(DELETE_SQL).Bind(1, path_str).Step();
+            }
+        });
     }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR_FMT("Data deletion failed: {}", err.what())
+    }
+}
+
+std::optional<ETagRecord> SQLiteFileETagService::Find(const std::string& path_str) noexcept(false)
+{
+    return database_.Read([&path_str](utils::sqlite::Connection& connection) -> std::optional<ETagRecord> {
+        auto& select = connection.Prepare(SELECT_SQL);
+        select.Bind(1, path_str);
+        if (!select.Step())
+        {
+            return std::nullopt;
+        }
+        return read_record(select);
+    });
+}
 
-    return sha;
+bool SQLiteFileETagService::Store(const std::string& path_str, const ETagRecord& record) noexcept
+{
+    try
+    {
+        const auto& stat = record.stat;
+        database_.Write([&path_str, &record, &stat](utils::sqlite::Connection& connection) {
+            connection.Prepare(UPSERT_SQL)
+                .Bind(1, path_str)
+                .Bind(2, record.etag)
+                .Bind(3, static_cast<int64_t>(stat.dev))
+                .Bind(4, static_cast<int64_t>(stat.ino))
+                .Bind(5, static_cast<int64_t>(stat.size))
+                .Bind(6, static_cast<int64_t>(stat.mtime_ns))
+                .Step();
+        });
+        return true;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR_FMT("Data insertion error: {}", err.what())
+        return false;
+    }
 }
 
 } // namespace FileETagService
@@ -1,12 +1,17 @@
 #pragma once
 #include "FileETagService.h"
 
-#include <ormpp/dbng.hpp>
-#include <ormpp/sqlite.hpp>
+#include <optional>
+
+#include "utils/sqlite.h"
 
 namespace FileETagService
 {
 
+/*
+    Lookups run on the database's read connections and never wait for the writer, stores are batched with the other
+    writes into the writer's next transaction.
+ */
 class SQLiteFileETagService final : public FileETagService
 {
   public:
@@ -16,8 +21,20 @@ class SQLiteFileETagService final : public FileETagService
 
     std::string Set(const std::filesystem::path& path)  noexcept override;
 
+    std::string Set(const std::filesystem::path& path, const std::string& etag) noexcept override;
+
+    std::string GetValidated(const std::filesystem::path& path) noexcept override;
+
+    async_simple::coro::Lazy<std::string> GetValidatedAsync(std::filesystem::path path) override;
+
+    void Invalidate(const std::filesystem::path& path) noexcept override;
+
   private:
-    ormpp::dbng<ormpp::sqlite> dbng_;
+    std::optional<ETagRecord> Find(const std::string& path_str) noexcept(false);
+
+    bool Store(const std::string& path_str, const ETagRecord& record) noexcept;
+
+    utils::sqlite::Database& database_;
 };
 
 } // namespace FileETagService
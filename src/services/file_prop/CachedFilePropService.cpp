@@ -0,0 +1,114 @@
+#include "CachedFilePropService.h"
+
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <utility>
+
+#include "logger.hpp"
+#include "utils/path.h"
+
+namespace FilePropService
+{
+
+static size_t estimate_size(const std::string& path, const std::vector<PropT>& props)
+{
+    // node, list entry and hash bucket
+    size_t bytes = path.capacity() + sizeof(std::vector<PropT>) + 96;
+    for (const auto& [key, value] : props)
+    {
+        bytes += sizeof(PropT) + key.capacity() + value.capacity();
+    }
+
+    return bytes;
+}
+
+static std::string find_value(const std::vector<PropT>& props, const std::string& key)
+{
+    const auto it = std::ranges::find(props, key, &PropT::first);
+    return it != props.end() ? it->second : std::string{""};
+}
+
+CachedFilePropService::CachedFilePropService(FilePropService& engine, const size_t budget) : engine_(engine), cache_(budget, estimate_size)
+{
+}
+
+bool CachedFilePropService::Set(const std::filesystem::path& path, const PropT& prop) noexcept
+{
+    const bool res = engine_.Set(path, prop);
+    cache_.Invalidate(utils::path::to_string(path));
+    return res;
+}
+
+std::string CachedFilePropService::Get(const std::filesystem::path& path, const std::string& key) noexcept
+{
+    return find_value(GetAll(path), key);
+}
+
+std::vector<PropT> CachedFilePropService::GetAll(const std::filesystem::path& path) noexcept
+{
+    try
+    {
+        const std::string path_str = utils::path::to_string(path);
+        auto lookup = cache_.Get(path_str);
+        if (lookup.value.has_value())
+        {
+            return std::move(*lookup.value);
+        }
+
+        std::vector<PropT> props = engine_.GetAll(path);
+        cache_.Put(path_str, props, lookup.ticket);
+        return props;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        return {};
+    }
+}
+
+bool CachedFilePropService::Remove(const std::filesystem::path& path, const std::string& key) noexcept
+{
+    const bool res = engine_.Remove(path, key);
+    cache_.Invalidate(utils::path::to_string(path));
+    return res;
+}
+
+bool CachedFilePropService::RemoveAll(const std::filesystem::path& path) noexcept
+{
+    const bool res = engine_.RemoveAll(path);
+    cache_.Invalidate(utils::path::to_string(path));
+    return res;
+}
+
+async_simple::coro::Lazy<std::string> CachedFilePropService::GetAsync(std::filesystem::path path, std::string key)
+{
+    co_return find_value(co_await GetAllAsync(std::move(path)), key);
+}
+
+async_simple::coro::Lazy<std::vector<PropT>> CachedFilePropService::GetAllAsync(std::filesystem::path path)
+{
+    const std::string path_str = utils::path::to_string(path);
+    auto lookup = cache_.Get(path_str);
+    if (lookup.value.has_value())
+    {
+        co_return std::move(*lookup.value);
+    }
+
+    std::vector<PropT> props = co_await engine_.GetAllAsync(path);
+    cache_.Put(path_str, props, lookup.ticket);
+    co_return props;
+}
+
+void CachedFilePropService::Clear() noexcept
+{
+    cache_.Clear();
+}
+
+utils::CacheStats CachedFilePropService::GetStats()
+{
+    return cache_.GetStats();
+}
+
+} // namespace FilePropService
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "FilePropService.h"
+#include "utils/slru_cache.h"
+
+namespace FilePropService
+{
+
+/*
+    An in-process cache of whole property lists in front of an engine behind a database or the network, a path
+    without properties is cached as an empty list. Properties are user data, so changes always go through to the
+    engine first and then drop the cached list, which is fetched again on the next lookup.
+ */
+class CachedFilePropService final : public FilePropService
+{
+  public:
+    CachedFilePropService(FilePropService& engine, size_t budget);
+
+    bool Set(const std::filesystem::path& path, const PropT& prop) noexcept override;
+
+    std::string Get(const std::filesystem::path& path, const std::string& key) noexcept override;
+
+    std::vector<PropT> GetAll(const std::filesystem::path& path) noexcept override;
+
+    bool Remove(const std::filesystem::path& path, const std::string& key) noexcept override;
+
+    bool RemoveAll(const std::filesystem::path& path) noexcept override;
+
+    async_simple::coro::Lazy<std::string> GetAsync(std::filesystem::path path, std::string key) override;
+
+    async_simple::coro::Lazy<std::vector<PropT>> GetAllAsync(std::filesystem::path path) override;
+
+    // drops every cached list, when the files may have changed unseen
+    void Clear() noexcept;
+
+    [[nodiscard]]
+    utils::CacheStats GetStats();
+
+  private:
+    FilePropService& engine_;
+    utils::SlruCache<std::string, std::vector<PropT>> cache_;
+};
+
+} // namespace FilePropService
@@ -0,0 +1,18 @@
+#include "FilePropService.h"
+
+#include "utils/blocking.h"
+
+namespace FilePropService
+{
+
+async_simple::coro::Lazy<std::string> FilePropService::GetAsync(std::filesystem::path path, std::string key)
+{
+    co_return co_await utils::blocking::run([this, &path, &key]() { return Get(path, key); });
+}
+
+async_simple::coro::Lazy<std::vector<PropT>> FilePropService::GetAllAsync(std::filesystem::path path)
+{
+    co_return co_await utils::blocking::run([this, &path]() { return GetAll(path); });
+}
+
+} // namespace FilePropService
@@ -4,16 +4,10 @@
 #include <string>
 #include <vector>
 
-namespace FilePropService
-{
+#include <async_simple/coro/Lazy.h>
 
-struct FilePropTable
+namespace FilePropService
 {
-    std::string path;
-    std::string key;
-    std::string value;
-    size_t id;
-};
 
 using PropT = std::pair<std::string, std::string>;
 
@@ -29,6 +23,12 @@ class FilePropService
     virtual bool Remove(const std::filesystem::path& path, const std::string& key) noexcept = 0;
 
     virtual bool RemoveAll(const std::filesystem::path& path) noexcept = 0;
+
+    // Awaitable Get and GetAll. By default they run on the blocking pool, engines with a non-blocking client override
+    // them so that no thread waits on the network.
+    virtual async_simple::coro::Lazy<std::string> GetAsync(std::filesystem::path path, std::string key);
+
+    virtual async_simple::coro::Lazy<std::vector<PropT>> GetAllAsync(std::filesystem::path path);
 };
 
 } // namespace FilePropService
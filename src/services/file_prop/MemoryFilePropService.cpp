@@ -1,6 +1,7 @@
 #include "MemoryFilePropService.h"
 
 #include <cstddef>
+#include <exception>
 #include <filesystem>
 #include <format>
 #include <fstream>
@@ -17,183 +18,330 @@
 namespace FilePropService
 {
 
-MemoryFilePropService::MemoryFilePropService() noexcept(false)
+// journal records: "S" path key value | "R" path key | "A" path, snapshot entries: path -> key value key value ...
+static constexpr std::string_view OP_SET = "S";
+static constexpr std::string_view OP_REMOVE = "R";
+static constexpr std::string_view OP_REMOVE_ALL = "A";
+
+static std::string encode(std::string_view op, const std::filesystem::path& path, std::string_view key = {}, std::string_view value = {})
 {
-    const auto& conf = ConfigManager::GetInstance();
-    const auto& data_path = conf.GetPropData();
-    const std::string data_path_str = utils::path::to_string(data_path);
+    std::string encoded;
+    utils::journal::append_field(encoded, op);
+    utils::journal::append_field(encoded, utils::path::to_string(path));
+    if (op != OP_REMOVE_ALL)
+    {
+        utils::journal::append_field(encoded, key);
+    }
+    if (op == OP_SET)
+    {
+        utils::journal::append_field(encoded, value);
+    }
+    return encoded;
+}
 
-    if (std::filesystem::exists(data_path))
+static MemoryFilePropService::ETagMapValueT decode_props(std::string_view encoded)
+{
+    MemoryFilePropService::ETagMapValueT props{};
+    while (true)
     {
-        std::ifstream ifs{data_path, std::ios::in};
-        if (!ifs.is_open())
+        const auto key = utils::journal::read_field(encoded);
+        const auto value = utils::journal::read_field(encoded);
+        if (!key.has_value() || !value.has_value())
         {
-            LOG_ERROR_FMT("Unable to open '{}', unable to recover file properties.", data_path_str);
-            return;
+            return props;
         }
+        props.insert_or_assign(std::string{*key}, std::string{*value});
+    }
+}
 
-        // line string like this: path@mark1=value1,mark2=value2
-        std::string raw_line{};
-        while (std::getline(ifs, raw_line))
-        {
-            const std::string_view line = raw_line;
+MemoryFilePropService::MemoryFilePropService() noexcept(false)
+    : journal_(ConfigManager::GetInstance().GetPropData(), ConfigManager::GetInstance().GetDataJournalCompactSize(),
+               [this](const utils::Journal::EmitT& emit) {
+                   loader_.WaitLoaded();
+                   prop_map_.ForEach([&emit](const ETagMapKeyT& path, const ETagMapValueT& props) {
+                       std::string encoded;
+                       for (const auto& [key, value] : props)
+                       {
+                           utils::journal::append_field(encoded, key);
+                           utils::journal::append_field(encoded, value);
+                       }
+                       if (!encoded.empty())
+                       {
+                           emit(utils::path::to_string(path), encoded);
+                       }
+                   });
+               })
+{
+    const auto& data_path = ConfigManager::GetInstance().GetPropData();
+    const bool is_text = std::filesystem::exists(data_path) && !utils::MappedTable::IsTable(data_path) && !utils::Journal::IsJournalFile(data_path);
+    if (is_text)
+    {
+        LoadTextData(data_path);
+    }
 
-            size_t pos = line.find_last_of('@');
-            if (pos == std::string_view::npos)
-            {
-                continue;
-            }
+    // started before the journal is replayed, the loader never overwrites what the journal brings back
+    loader_.Start(
+        data_path,
+        [this](const std::string_view key, const std::string_view value) { prop_map_.InsertIfAbsent(ETagMapKeyT{key}, decode_props(value)); },
+        [this]() { prop_map_.EraseIf([](const ETagMapValueT& props) { return props.empty(); }); });
 
-            auto path = line.substr(0, pos);
-            if (path.empty())
-            {
-                continue;
-            }
+    if (!journal_.Open([this](const std::string_view record) { Apply(record); }))
+    {
+        LOG_ERROR_FMT("Unable to save file properties to '{}', file properties are lost when the server stops.",
+                      utils::path::to_string(data_path))
+        return;
+    }
+    if (is_text)
+    {
+        journal_.RequestCompaction();
+    }
+}
 
-            auto prop_list_str = line.substr(pos + 1);
-            if (prop_list_str.empty())
-            {
-                prop_map_.insert({ETagMapKeyT{path}, {}});
-                continue;
-            }
+bool MemoryFilePropService::Set(const std::filesystem::path& path, const PropT& prop) noexcept
+{
+    try
+    {
+        const std::string encoded = encode(OP_SET, path, prop.first, prop.second);
+        Fault(path);
+
+        uint64_t seq = 0;
+        prop_map_.Update(path, [this, &prop, &encoded, &seq](ETagMapValueT& props) {
+            props.insert_or_assign(prop.first, prop.second);
+            seq = journal_.Append(encoded);
+        });
+        journal_.WaitDurable(seq);
+        return true;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        return false;
+    }
+}
 
-            ETagMapValueT props{};
-            size_t start = 0, end = 0;
-            while (start < prop_list_str.length())
-            {
-                end = prop_list_str.find_first_of(',');
-                if (end == std::string_view::npos)
-                {
-                    auto pair = utils::string::split2pair(prop_list_str, '=');
-                    if (!pair.first.empty())
-                    {
-                        props.insert(std::move(pair));
-                    }
+std::string MemoryFilePropService::Get(const std::filesystem::path& path, const std::string& key) noexcept
+{
+    Fault(path);
 
-                    break;
-                }
+    std::string value{};
+    prop_map_.Visit(path, [&key, &value](const ETagMapValueT& props) {
+        if (const auto it = props.find(key); it != props.end())
+        {
+            value = it->second;
+        }
+    });
 
-                auto prop_str = prop_list_str.substr(start, end);
-                auto pair = utils::string::split2pair(prop_str, '=');
-                if (!pair.first.empty())
-                {
-                    props.insert(std::move(pair));
-                }
+    return value;
+}
 
-                start = end + 1;
-            }
+std::vector<PropT> MemoryFilePropService::GetAll(const std::filesystem::path& path) noexcept
+{
+    Fault(path);
 
-            prop_map_.insert({ETagMapKeyT{path}, std::move(props)});
-        }
-    }
+    std::vector<PropT> props{};
+    prop_map_.Visit(path, [&props](const ETagMapValueT& stored) { props.assign(stored.begin(), stored.end()); });
 
-    data_.open(data_path, std::ios::out);
-    if (!data_.is_open())
-    {
-        LOG_ERROR_FMT("Unable to save file properties to '{}', file properties are lost when the server stops.", data_path_str);
-    }
+    return props;
 }
 
-MemoryFilePropService::~MemoryFilePropService() noexcept
+bool MemoryFilePropService::Remove(const std::filesystem::path& path, const std::string& key) noexcept
 {
+    try
+    {
+        Fault(path);
+
+        uint64_t seq = 0;
+        prop_map_.Modify(path, [this, &path, &key, &seq](ETagMapValueT& props) {
+            if (props.erase(key) == 1)
+            {
+                seq = journal_.Append(encode(OP_REMOVE, path, key));
+            }
+        });
+        if (seq == 0)
+        {
+            return false;
+        }
 
-    if (!data_.is_open())
+        // an empty list is kept as the tombstone while the snapshot is being loaded
+        DropTombstone(path);
+        journal_.WaitDurable(seq);
+        return true;
+    }
+    catch (const std::exception& err)
     {
-        return;
+        LOG_ERROR(err.what())
+        return false;
     }
+}
 
-    for (const auto& [path, props] : prop_map_)
+bool MemoryFilePropService::RemoveAll(const std::filesystem::path& path) noexcept
+{
+    try
     {
-        data_ << path << '@';
+        uint64_t seq = 0;
+        const auto drop = [this, &path, &seq](const ETagMapValueT& props) {
+            if (props.empty())
+            {
+                return false;
+            }
 
-        for (const auto& [key, value] : props)
+            seq = journal_.Append(encode(OP_REMOVE_ALL, path));
+            return true;
+        };
+
+        if (loader_.IsLoaded())
         {
-            data_ << key << '=' << value << ',';
+            prop_map_.EraseIf(path, drop);
         }
-
-        if (!props.empty())
+        else
         {
-            data_.seekp(-1, std::ios::cur);
+            // the tombstone (an empty list) is left where the snapshot has properties (faulted in first) for the path
+            Fault(path);
+            prop_map_.Modify(path, [&drop](ETagMapValueT& props) {
+                if (drop(props))
+                {
+                    props.clear();
+                }
+            });
+            DropTombstone(path);
         }
 
-        data_ << std::endl;
+        journal_.WaitDurable(seq);
+        return seq != 0;
     }
-
-    const auto& conf = ConfigManager::GetInstance();
-    LOG_ERROR_FMT("The file attributes have been saved to {}", utils::path::to_string(conf.GetPropData()));
-}
-
-bool MemoryFilePropService::Set(const std::filesystem::path& path, const PropT& prop) noexcept
-{
-    const auto& it = prop_map_.find(path);
-    if (it == prop_map_.end())
+    catch (const std::exception& err)
     {
+        LOG_ERROR(err.what())
         return false;
     }
-
-    it->second.insert({prop.first, prop.second});
-    return true;
 }
 
-std::string MemoryFilePropService::Get(const std::filesystem::path& path, const std::string& key) noexcept
+void MemoryFilePropService::Apply(std::string_view record)
 {
-    const auto& it = prop_map_.find(path);
-    if (it == prop_map_.end())
+    const auto op = utils::journal::read_field(record);
+    const auto path = utils::journal::read_field(record);
+    if (!op.has_value() || !path.has_value())
     {
-        return {""};
+        return;
     }
 
-    const auto& props = it->second;
-    if (!props.contains(key))
+    const ETagMapKeyT key_path{*path};
+    if (*op == OP_REMOVE_ALL)
     {
-        return {""};
+        if (loader_.IsLoaded() || !loader_.Find(*path).has_value())
+        {
+            prop_map_.Erase(key_path);
+            return;
+        }
+        prop_map_.InsertOrAssign(key_path, {});
+        DropTombstone(key_path);
+        return;
     }
 
-    return {props.at(key)};
-}
-
-std::vector<PropT> MemoryFilePropService::GetAll(const std::filesystem::path& path) noexcept
-{
-    const auto& it = prop_map_.find(path);
-    if (it == prop_map_.end())
+    const auto key = utils::journal::read_field(record);
+    if (!key.has_value())
     {
-        return {};
+        return;
     }
 
-    std::vector<PropT> props{};
-    for (const auto& pair : it->second)
+    // a property list the snapshot has for the path is completed by these, not replaced
+    if (const auto value = loader_.Find(*path); value.has_value())
     {
-        props.push_back(pair);
+        prop_map_.InsertIfAbsent(key_path, decode_props(*value));
     }
 
-    return props;
+    if (*op == OP_SET)
+    {
+        if (const auto value = utils::journal::read_field(record); value.has_value())
+        {
+            prop_map_.Update(key_path, [&key, &value](ETagMapValueT& props) { props.insert_or_assign(std::string{*key}, std::string{*value}); });
+        }
+    }
+    else if (*op == OP_REMOVE)
+    {
+        prop_map_.Modify(key_path, [&key](ETagMapValueT& props) { props.erase(std::string{*key}); });
+        DropTombstone(key_path);
+    }
 }
 
-bool MemoryFilePropService::Remove(const std::filesystem::path& path, const std::string& key) noexcept
+void MemoryFilePropService::Fault(const std::filesystem::path& path)
 {
-    const auto& it = prop_map_.find(path);
-    if (it == prop_map_.end())
+    if (loader_.IsLoaded())
     {
-        return false;
+        return;
     }
 
-    auto& props = it->second;
-    if (!props.contains(key))
+    if (const auto value = loader_.Find(utils::path::to_string(path)); value.has_value())
     {
-        return false;
+        prop_map_.InsertIfAbsent(path, decode_props(*value));
     }
+}
 
-    return static_cast<size_t>(props.erase(key)) == 1;
+void MemoryFilePropService::DropTombstone(const std::filesystem::path& path)
+{
+    // the load finished meanwhile, the tombstones may have been purged before this one was written
+    if (loader_.IsLoaded())
+    {
+        prop_map_.EraseIf(path, [](const ETagMapValueT& props) { return props.empty(); });
+    }
 }
 
-bool MemoryFilePropService::RemoveAll(const std::filesystem::path& path) noexcept
+void MemoryFilePropService::LoadTextData(const std::filesystem::path& data_path)
 {
-    if (prop_map_.contains(path))
+    std::ifstream ifs{data_path, std::ios::in};
+    if (!ifs.is_open())
     {
-        return false;
+        LOG_ERROR_FMT("Unable to open '{}', unable to recover file properties.", utils::path::to_string(data_path))
+        return;
     }
 
-    return static_cast<size_t>(prop_map_.erase(path)) == 1;
+    // line string like this: path@mark1=value1,mark2=value2
+    std::string raw_line{};
+    while (std::getline(ifs, raw_line))
+    {
+        const std::string_view line = raw_line;
+
+        const size_t pos = line.find_last_of('@');
+        if (pos == std::string_view::npos)
+        {
+            continue;
+        }
+
+        // the paths used to be written quoted
+        auto path = line.substr(0, pos);
+        if (path.size() >= 2 && path.front() == '"' && path.back() == '"')
+        {
+            path = path.substr(1, path.size() - 2);
+        }
+        if (path.empty())
+        {
+            continue;
+        }
+
+        ETagMapValueT props{};
+        const auto prop_list_str = line.substr(pos + 1);
+        for (size_t start = 0; start < prop_list_str.size();)
+        {
+            size_t end = prop_list_str.find(',', start);
+            if (end == std::string_view::npos)
+            {
+                end = prop_list_str.size();
+            }
+
+            auto pair = utils::string::split2pair(prop_list_str.substr(start, end - start), '=');
+            if (!pair.first.empty())
+            {
+                props.insert(std::move(pair));
+            }
+
+            start = end + 1;
+        }
+
+        if (!props.empty())
+        {
+            prop_map_.InsertOrAssign(ETagMapKeyT{path}, std::move(props));
+        }
+    }
 }
 
 } // namespace FilePropService
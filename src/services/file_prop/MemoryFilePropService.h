@@ -1,24 +1,34 @@
 #pragma once
 
 #include <filesystem>
-#include <fstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "FilePropService.h"
+#include "utils/journal.h"
+#include "utils/mapped_table.h"
+#include "utils/sharded_map.h"
 
 namespace FilePropService
 {
 
+/*
+    Properties are user data, so unlike the etags a change only returns once its journal record has been synced.
+    Writers arriving while a sync is in progress share the next one.
+
+    The snapshot is mapped at startup and loaded into the map in the background, lookups fault the entries they
+    need in before that. An empty property list is a tombstone left behind by a removal during the load, they are
+    purged once it is done.
+ */
 class MemoryFilePropService : public FilePropService
 {
   public:
     using ETagMapKeyT = std::filesystem::path;
     using ETagMapValueT = std::unordered_map<std::string, std::string>;
-    using ETagMapT = std::unordered_map<ETagMapKeyT, ETagMapValueT>;
+    using ETagMapT = utils::ShardedMap<ETagMapKeyT, ETagMapValueT>;
 
     MemoryFilePropService() noexcept(false);
-    ~MemoryFilePropService() noexcept;
 
     bool Set(const std::filesystem::path& path, const PropT& prop) noexcept override;
 
@@ -31,8 +41,23 @@ class MemoryFilePropService : public FilePropService
     bool RemoveAll(const std::filesystem::path& path) noexcept override;
 
   private:
+    // copies the properties from the snapshot into the map while the snapshot is still being loaded
+    void Fault(const std::filesystem::path& path);
+
+    // for a tombstone written while the load may have completed, the ones written before are purged after it
+    void DropTombstone(const std::filesystem::path& path);
+
+    // applies a journal record while recovering
+    void Apply(std::string_view record);
+
+    // reads the "path@mark1=value1,mark2=value2" lines written before there was a journal
+    void LoadTextData(const std::filesystem::path& data_path);
+
     ETagMapT prop_map_;
-    std::ofstream data_;
+    utils::TableLoader loader_;
+
+    // after the map, the final snapshot is taken from it when the journal is destroyed
+    utils::Journal journal_;
 };
 
 } // namespace FilePropService
@@ -1,115 +1,154 @@
 #include "RedisFilePropService.h"
 
-#include <cassert>
 #include <cstddef>
+#include <exception>
 #include <filesystem>
 #include <format>
-#include <memory>
-#include <stdexcept>
+#include <iostream>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <hiredis/hiredis.h>
 
-#include "ConfigManager.h"
+#include "logger.hpp"
 #include "utils/path.h"
+#include "utils/redis_async.h"
 
 using namespace utils::redis;
 
 namespace FilePropService
 {
 
-RedisFilePropService::RedisFilePropService() noexcept(false) : redis_ctx_(nullptr, &redisFree)
+static std::string prop_key(const std::filesystem::path& path)
 {
-    const auto& conf = ConfigManager::GetInstance();
-
-    redis_ctx_ = GetRedisContext(conf.GetRedisHost(), conf.GetRedisPort());
-    if (redis_ctx_->err)
-    {
-        throw std::runtime_error(redis_ctx_->errstr);
-    }
-
-    if (!RedisAuth(redis_ctx_.get(), conf.GetRedisUserName(), conf.GetRedisPassword()))
-    {
-        throw std::runtime_error("Auth failed.");
-    }
+    return "prop:" + utils::path::to_string(path);
 }
 
-bool RedisFilePropService::Set(const std::filesystem::path& path, const std::pair<std::string, std::string>& prop) noexcept
+RedisFilePropService::RedisFilePropService() noexcept(false) : pool_(Pool::GetInstance()), async_client_(AsyncClient::GetInstance())
 {
-    const std::string path_str = utils::path::to_string(path);
-    const std::string command = std::format(R"(HSET prop:{} {} "{}")", path_str, prop.first, prop.second);
+    // fails early on a server that cannot be reached or refuses the credentials
+    [[maybe_unused]] const Pool::Lease connection = pool_.Acquire();
+}
 
-    RedisReplyT repl = RedisExecute(redis_ctx_.get(), command);
-    if (!repl)
+bool RedisFilePropService::Set(const std::filesystem::path& path, const PropT& prop) noexcept
+{
+    try
     {
+        // HSET answers the number of fields added, 0 when an existing one was overwritten
+        const RedisReplyT repl = pool_.Acquire()->Execute({"HSET", prop_key(path), prop.first, prop.second});
+        return repl && repl->type == REDIS_REPLY_INTEGER;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
         return false;
     }
-
-    return repl->integer == 1;
 }
 
 std::string RedisFilePropService::Get(const std::filesystem::path& path, const std::string& key) noexcept
 {
-    const std::string path_str = utils::path::to_string(path);
-    const std::string command = std::format("HGET prop:{} {}", path_str, key);
-
-    RedisReplyT repl = RedisExecute(redis_ctx_.get(), command);
-    if (!repl)
+    try
+    {
+        const RedisReplyT repl = pool_.Acquire()->Execute({"HGET", prop_key(path), key});
+        return std::string{reply_str(repl.get())};
+    }
+    catch (const std::exception& err)
     {
+        LOG_ERROR(err.what())
         return {""};
     }
-
-    return {repl->str};
 }
 
 std::vector<PropT> RedisFilePropService::GetAll(const std::filesystem::path& path) noexcept
 {
-    const std::string path_str = utils::path::to_string(path);
-    const std::string command = std::format("HGETALL prop:{}", path_str);
-
-    RedisReplyT repl = RedisExecute(redis_ctx_.get(), command);
-    if (!repl)
+    try
     {
-        return {};
+        const RedisReplyT repl = pool_.Acquire()->Execute({"HGETALL", prop_key(path)});
+        if (!repl)
+        {
+            return {};
+        }
+
+        std::vector<PropT> prop_list{};
+        for (size_t i = 0; i + 1 < repl->elements; i += 2)
+        {
+            prop_list.emplace_back(reply_str(repl->element[i]), reply_str(repl->element[i + 1]));
+        }
+
+        return prop_list;
     }
-
-    std::vector<PropT> prop_list{};
-    for (size_t i = 0; i < repl->elements; i += 2)
+    catch (const std::exception& err)
     {
-        prop_list.push_back({(repl.get())[i].str, (repl.get())[i + 1].str});
+        LOG_ERROR(err.what())
+        return {};
     }
-
-    return prop_list;
 }
 
 bool RedisFilePropService::Remove(const std::filesystem::path& path, const std::string& key) noexcept
 {
-    const std::string path_str = utils::path::to_string(path);
-    const std::string command = std::format("HDEL prop:{} {}", path_str, key);
-
-    RedisReplyT repl = RedisExecute(redis_ctx_.get(), command);
-    if (!repl)
+    try
     {
+        const RedisReplyT repl = pool_.Acquire()->Execute({"HDEL", prop_key(path), key});
+        return repl && repl->integer == 1;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
         return false;
     }
-
-    return repl->integer == 1;
 }
 
 bool RedisFilePropService::RemoveAll(const std::filesystem::path& path) noexcept
 {
-    const std::string path_str = utils::path::to_string(path);
-    const std::string command = std::format("DEL prop:{}", path_str);
-
-    RedisReplyT repl = RedisExecute(redis_ctx_.get(), command);
-    if (!repl)
+    try
+    {
+        const RedisReplyT repl = pool_.Acquire()->Execute({"DEL", prop_key(path)});
+        return repl && repl->integer == 1;
+    }
+    catch (const std::exception& err)
     {
+        LOG_ERROR(err.what())
         return false;
     }
+}
+
+async_simple::coro::Lazy<std::string> RedisFilePropService::GetAsync(std::filesystem::path path, std::string key)
+{
+    try
+    {
+        const std::string hash_key = prop_key(path);
+        const CommandT command{"HGET", hash_key, key};
+        const utils::resp::Reply reply = co_await async_client_.Execute(command);
+        co_return reply.type == utils::resp::Reply::Type::String ? reply.str : std::string{""};
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
+
+    co_return std::string{""};
+}
+
+async_simple::coro::Lazy<std::vector<PropT>> RedisFilePropService::GetAllAsync(std::filesystem::path path)
+{
+    std::vector<PropT> prop_list{};
+    try
+    {
+        const std::string hash_key = prop_key(path);
+        const CommandT command{"HGETALL", hash_key};
+        const utils::resp::Reply reply = co_await async_client_.Execute(command);
+        for (size_t i = 0; i + 1 < reply.elements.size(); i += 2)
+        {
+            prop_list.emplace_back(reply.elements[i].str, reply.elements[i + 1].str);
+        }
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+    }
 
-    return repl->integer == 1;
+    co_return prop_list;
 }
 
 } // namespace FilePropService
@@ -3,9 +3,8 @@
 
 #include <filesystem>
 
-#include <hiredis/hiredis.h>
-
 #include "utils/redis.h"
+#include "utils/redis_async.h"
 
 namespace FilePropService
 {
@@ -25,9 +24,13 @@ class RedisFilePropService : public FilePropService
 
     bool RemoveAll(const std::filesystem::path& path) noexcept override;
 
+    async_simple::coro::Lazy<std::string> GetAsync(std::filesystem::path path, std::string key) override;
+
+    async_simple::coro::Lazy<std::vector<PropT>> GetAllAsync(std::filesystem::path path) override;
+
   private:
-    std::string auth_str_;
-    utils::redis::RedisContextT redis_ctx_;
+    utils::redis::Pool& pool_;
+    utils::redis::AsyncClient& async_client_;
 };
 
 } // namespace FilePropService
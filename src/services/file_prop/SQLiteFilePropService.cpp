@@ -1,79 +1,132 @@
 #include "SQLiteFilePropService.h"
 
-#include <entity.hpp>
+#include <exception>
 #include <filesystem>
 #include <format>
-
+#include <iostream>
 #include <vector>
 
-#include "ConfigManager.h"
-#include "FilePropService.h"
 #include "logger.hpp"
 #include "utils/path.h"
 
-
 namespace FilePropService
 {
 
-REGISTER_AUTO_KEY(FilePropTable, id)
-
-SQLiteFilePropService::SQLiteFilePropService() noexcept(false)
+SQLiteFilePropService::SQLiteFilePropService() noexcept(false) : database_(utils::sqlite::Database::GetInstance())
 {
-    using namespace ormpp;
-
-    if (const auto& conf = ConfigManager::GetInstance(); !dbng_.connect(utils::path::to_string(conf.GetSQLiteDB()).data(), "FileProp"))
-    {
-        throw std::runtime_error(dbng_.get_last_error());
-    }
-
-    if (!dbng_.create_datatable<FilePropTable>(ormpp_auto_key{"id"}, ormpp_unique{{"path"}}))
-    {
-        throw std::runtime_error(dbng_.get_last_error());
-    }
+    database_.Write([](utils::sqlite::Connection& connection) {
+        connection.Execute("CREATE TABLE IF NOT EXISTS FileProps (path TEXT NOT NULL, key TEXT NOT NULL, value TEXT, PRIMARY KEY (path, key))");
+
+        // FilePropTable was unique on the path alone and only ever held one property per path, its rows are moved over once
+        auto& legacy = connection.Prepare("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'FilePropTable'");
+        const bool has_legacy = legacy.Step() && legacy.ColumnInt(0) > 0;
+        legacy.Reset();
+        if (has_legacy)
+        {
+            connection.Execute("INSERT OR IGNORE INTO FileProps (path, key, value) SELECT path, key, value FROM FilePropTable");
+            connection.Execute("DROP TABLE FilePropTable");
+        }
+    });
 }
 
 bool SQLiteFilePropService::Set(const std::filesystem::path& path, const PropT& prop) noexcept
 {
     const std::string path_str = utils::path::to_string(path);
-    return dbng_.insert<FilePropTable>({path_str, prop.first, prop.second}) == 1;
+    try
+    {
+        database_.Write([&path_str, &prop](utils::sqlite::Connection& connection) {
+            connection.Prepare("INSERT INTO FileProps (path, key, value) VALUES (?1, ?2, ?3) ON CONFLICT(path, key) DO UPDATE SET value = excluded.value")
+                .Bind(1, path_str)
+                .Bind(2, prop.first)
+                .Bind(3, prop.second)
+                .Step();
+        });
+        return true;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR_FMT("Data insertion error: {}", err.what())
+        return false;
+    }
 }
 
 std::string SQLiteFilePropService::Get(const std::filesystem::path& path, const std::string& key) noexcept
 {
     const std::string path_str = utils::path::to_string(path);
-    const auto query_res = dbng_.query_s<FilePropTable>(std::format("path='{}' and key='{}'", path_str, key));
-    if (query_res.size() != 1)
+    try
+    {
+        return database_.Read([&path_str, &key](utils::sqlite::Connection& connection) {
+            auto& select = connection.Prepare("SELECT value FROM FileProps WHERE path = ?1 AND key = ?2");
+            select.Bind(1, path_str).Bind(2, key);
+            return select.Step() ? select.ColumnText(0) : std::string{""};
+        });
+    }
+    catch (const std::exception& err)
     {
-        LOG_ERROR("The database may be damaged.");
+        LOG_ERROR(err.what())
         return {""};
     }
-
-    return query_res[0].value;
 }
 
 std::vector<PropT> SQLiteFilePropService::GetAll(const std::filesystem::path& path) noexcept
 {
     const std::string path_str = utils::path::to_string(path);
-    std::vector<PropT> props;
-
-    for (const auto query_res = dbng_.query_s<FilePropTable>(std::format("path='{}'", path_str)); const auto& prop : query_res)
+    try
     {
-        props.emplace_back(prop.key, prop.value);
+        return database_.Read([&path_str](utils::sqlite::Connection& connection) {
+            std::vector<PropT> props;
+
+            auto& select = connection.Prepare("SELECT key, value FROM FileProps WHERE path = ?1");
+            select.Bind(1, path_str);
+            while (select.Step())
+            {
+                props.emplace_back(select.ColumnText(0), select.ColumnText(1));
+            }
+
+            return props;
+        });
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR(err.what())
+        return {};
     }
-
-    return props;
 }
 
 bool SQLiteFilePropService::Remove(const std::filesystem::path& path, const std::string& key) noexcept
 {
     const std::string path_str = utils::path::to_string(path);
-    return dbng_.delete_records_s<FilePropTable>(std::format("path='{}' and key='{}'", path_str, key));
+    try
+    {
+        bool removed = false;
+        database_.Write([&path_str, &key, &removed](utils::sqlite::Connection& connection) {
+            connection.Prepare("DELETE FROM FileProps WHERE path = ?1 AND key = ?2").Bind(1, path_str).Bind(2, key).Step();
+            removed = connection.Changes() == 1;
+        });
+        return removed;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR_FMT("Data deletion failed: {}", err.what())
+        return false;
+    }
 }
 
 bool SQLiteFilePropService::RemoveAll(const std::filesystem::path& path) noexcept
 {
     const std::string path_str = utils::path::to_string(path);
-    return dbng_.delete_records_s<FilePropTable>(std::format("path='{}'", path_str));
+    try
+    {
+        database_.Write([&path_str](utils::sqlite::Connection& connection) {
+            connection.Prepare("DELETE FROM FileProps WHERE path = ?1").Bind(1, path_str).Step();
+        });
+        return true;
+    }
+    catch (const std::exception& err)
+    {
+        LOG_ERROR_FMT("Data deletion failed: {}", err.what())
+        return false;
+    }
 }
 
 } // namespace FilePropService
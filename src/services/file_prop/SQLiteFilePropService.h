@@ -4,12 +4,15 @@
 #include <filesystem>
 #include <string>
 
-#include <ormpp/dbng.hpp>
-#include <ormpp/sqlite.hpp>
+#include "utils/sqlite.h"
 
 namespace FilePropService
 {
 
+/*
+    One row per (path, key) in FileProps. Lookups run on the database's read connections, changes are batched with the
+    other writes into the writer's next transaction and return once it has committed.
+ */
 class SQLiteFilePropService : public FilePropService
 {
   public:
@@ -26,7 +29,7 @@ class SQLiteFilePropService : public FilePropService
     bool RemoveAll(const std::filesystem::path& path) noexcept override;
 
   private:
-    ormpp::dbng<ormpp::sqlite> dbng_;
+    utils::sqlite::Database& database_;
 };
 
 } // namespace FilePropService
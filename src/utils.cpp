@@ -1,12 +1,13 @@
 #include <chrono>
 #include <cstdint>
+#include <fstream>
+#include <memory>
 #include <random>
 #include <string>
 #include <vector>
 
-#include <PicoSHA2/picosha2.h>
-
 #include "utils.h"
+#include "utils/sha256.h"
 
 constexpr auto MAP = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                             "abcdefghijklmnopqrstuvwxyz"
@@ -46,19 +47,10 @@ std::string generate_unique_key()
 
 std::string sha256(const std::string& text)
 {
-    std::string sha{};
-    picosha2::hash256_hex_string(text, sha);
-
-    return sha;
-}
-
-std::string sha256(const std::filesystem::path& file)
-{
-    std::ifstream f(file, std::ios::binary);
-    std::vector<unsigned char> s(picosha2::k_digest_size);
-    picosha2::hash256(f, s.begin(), s.end());
+    Sha256 hasher{};
+    hasher.Update(text);
 
-    return picosha2::bytes_to_hex_string(s.begin(), s.end());
+    return hasher.FinalHex();
 }
 
 std::string base64_decode(const std::string& src, bool url_encoded)
@@ -2,7 +2,9 @@
 
 #include <chrono>
 #include <filesystem>
+#include <memory>
 #include <string>
+#include <string_view>
 
 namespace utils
 {
@@ -11,8 +13,6 @@ std::string generate_unique_key();
 
 std::string sha256(const std::string& text);
 
-std::string sha256(const std::filesystem::path& file);
-
 std::string base64_decode(const std::string &src, bool url_encoded = false);
 
 template <class T>
@@ -0,0 +1,268 @@
+#include "blake3.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace utils
+{
+
+static constexpr Blake3::CvT IV = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+static constexpr uint32_t CHUNK_START = 1 << 0;
+static constexpr uint32_t CHUNK_END = 1 << 1;
+static constexpr uint32_t PARENT = 1 << 2;
+static constexpr uint32_t ROOT = 1 << 3;
+
+// the message words each round reads, the permutation applied round after round
+static constexpr uint8_t MSG_SCHEDULE[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}, {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1}, {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4}, {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+using BlockWordsT = std::array<uint32_t, 16>;
+
+static inline void g(uint32_t* s, const size_t a, const size_t b, const size_t c, const size_t d, const uint32_t mx, const uint32_t my) noexcept
+{
+    s[a] = s[a] + s[b] + mx;
+    s[d] = std::rotr(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = std::rotr(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + my;
+    s[d] = std::rotr(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = std::rotr(s[b] ^ s[c], 7);
+}
+
+static BlockWordsT compress(const Blake3::CvT& cv, const BlockWordsT& m, const uint64_t counter, const uint32_t block_size,
+                            const uint32_t flags) noexcept
+{
+    uint32_t s[16] = {cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7], IV[0], IV[1], IV[2], IV[3],
+                      static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), block_size, flags};
+
+    for (const auto& w : MSG_SCHEDULE)
+    {
+        g(s, 0, 4, 8, 12, m[w[0]], m[w[1]]);
+        g(s, 1, 5, 9, 13, m[w[2]], m[w[3]]);
+        g(s, 2, 6, 10, 14, m[w[4]], m[w[5]]);
+        g(s, 3, 7, 11, 15, m[w[6]], m[w[7]]);
+        g(s, 0, 5, 10, 15, m[w[8]], m[w[9]]);
+        g(s, 1, 6, 11, 12, m[w[10]], m[w[11]]);
+        g(s, 2, 7, 8, 13, m[w[12]], m[w[13]]);
+        g(s, 3, 4, 9, 14, m[w[14]], m[w[15]]);
+    }
+
+    BlockWordsT out;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        out[i] = s[i] ^ s[i + 8];
+        out[i + 8] = s[i + 8] ^ cv[i];
+    }
+    return out;
+}
+
+static BlockWordsT load_block(const uint8_t* block, const size_t size) noexcept
+{
+    uint8_t padded[Blake3::BLOCK_SIZE]{};
+    std::memcpy(padded, block, size);
+
+    BlockWordsT words;
+    for (size_t i = 0; i < 16; ++i)
+    {
+        const uint8_t* p = padded + i * 4;
+        words[i] = uint32_t{p[0]} | (uint32_t{p[1]} << 8) | (uint32_t{p[2]} << 16) | (uint32_t{p[3]} << 24);
+    }
+    return words;
+}
+
+static Blake3::CvT first_half(const BlockWordsT& words) noexcept
+{
+    Blake3::CvT cv;
+    std::copy_n(words.begin(), cv.size(), cv.begin());
+    return cv;
+}
+
+// the inputs of the last compression of a node, which is either a chaining value or (with ROOT) the hash
+struct Output
+{
+    Blake3::CvT cv;
+    BlockWordsT block;
+    uint64_t counter;
+    uint32_t block_size;
+    uint32_t flags;
+
+    [[nodiscard]]
+    Blake3::CvT ChainingValue() const noexcept
+    {
+        return first_half(compress(cv, block, counter, block_size, flags));
+    }
+
+    [[nodiscard]]
+    Blake3::DigestT Root() const noexcept
+    {
+        const BlockWordsT words = compress(cv, block, 0, block_size, flags | ROOT);
+
+        Blake3::DigestT digest;
+        for (size_t i = 0; i < 8; ++i)
+        {
+            for (size_t byte = 0; byte < 4; ++byte)
+            {
+                digest[i * 4 + byte] = static_cast<uint8_t>(words[i] >> (byte * 8));
+            }
+        }
+        return digest;
+    }
+};
+
+static Output parent_output(const Blake3::CvT& left, const Blake3::CvT& right) noexcept
+{
+    BlockWordsT block;
+    std::copy(left.begin(), left.end(), block.begin());
+    std::copy(right.begin(), right.end(), block.begin() + 8);
+    return {IV, block, 0, Blake3::BLOCK_SIZE, PARENT};
+}
+
+// hashes the whole chunk at data, chunk is its index in the input
+static Blake3::CvT chunk_cv(const uint8_t* data, const uint64_t chunk) noexcept
+{
+    Blake3::CvT cv = IV;
+    for (size_t block = 0; block + 1 < Blake3::CHUNK_SIZE / Blake3::BLOCK_SIZE; ++block)
+    {
+        cv = first_half(compress(cv, load_block(data + block * Blake3::BLOCK_SIZE, Blake3::BLOCK_SIZE), chunk, Blake3::BLOCK_SIZE,
+                                 block == 0 ? CHUNK_START : 0));
+    }
+
+    const uint8_t* last = data + Blake3::CHUNK_SIZE - Blake3::BLOCK_SIZE;
+    return Output{cv, load_block(last, Blake3::BLOCK_SIZE), chunk, Blake3::BLOCK_SIZE, CHUNK_END}.ChainingValue();
+}
+
+static Blake3::CvT subtree_cv(const uint8_t* data, const size_t chunks, const uint64_t first_chunk) noexcept
+{
+    if (chunks == 1)
+    {
+        return chunk_cv(data, first_chunk);
+    }
+
+    const size_t half = chunks / 2;
+    return parent_output(subtree_cv(data, half, first_chunk), subtree_cv(data + half * Blake3::CHUNK_SIZE, half, first_chunk + half))
+        .ChainingValue();
+}
+
+static Output chunk_output(const auto& chunk) noexcept
+{
+    const uint32_t start = chunk.blocks_compressed == 0 ? CHUNK_START : 0;
+    return {chunk.cv, load_block(chunk.block.data(), chunk.block_size), chunk.counter, static_cast<uint32_t>(chunk.block_size),
+            start | CHUNK_END};
+}
+
+Blake3::Blake3() noexcept : chunk_{IV, 0}
+{
+}
+
+void Blake3::Update(std::string_view data) noexcept
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    size_t size = data.size();
+    while (size > 0)
+    {
+        // a full chunk is only closed once more input arrives, the last one has to be finished by Final()
+        if (chunk_.Size() == CHUNK_SIZE)
+        {
+            PushCv(chunk_output(chunk_).ChainingValue(), chunk_.counter);
+            chunk_ = ChunkState{IV, chunk_.counter + 1};
+        }
+
+        size_t take = std::min(size, CHUNK_SIZE - chunk_.Size());
+        size -= take;
+        while (take > 0)
+        {
+            if (chunk_.block_size == BLOCK_SIZE)
+            {
+                const uint32_t start = chunk_.blocks_compressed == 0 ? CHUNK_START : 0;
+                chunk_.cv = first_half(compress(chunk_.cv, load_block(chunk_.block.data(), BLOCK_SIZE), chunk_.counter, BLOCK_SIZE, start));
+                ++chunk_.blocks_compressed;
+                chunk_.block_size = 0;
+            }
+
+            const size_t fill = std::min(take, BLOCK_SIZE - chunk_.block_size);
+            std::memcpy(chunk_.block.data() + chunk_.block_size, bytes, fill);
+            chunk_.block_size += fill;
+            bytes += fill;
+            take -= fill;
+        }
+    }
+
+    // whatever is on the stack can no longer be the root now that the chunk has input, so it may be merged down
+    if (chunk_.Size() > 0)
+    {
+        MergeCvStack(chunk_.counter);
+    }
+}
+
+Blake3::CvT Blake3::HashSubtree(const uint8_t* data, const uint64_t index) noexcept
+{
+    return subtree_cv(data, SUBTREE_CHUNKS, index * SUBTREE_CHUNKS);
+}
+
+void Blake3::UpdateSubtree(const CvT& cv) noexcept
+{
+    if (chunk_.Size() == CHUNK_SIZE)
+    {
+        PushCv(chunk_output(chunk_).ChainingValue(), chunk_.counter);
+        chunk_ = ChunkState{IV, chunk_.counter + 1};
+    }
+
+    PushCv(cv, chunk_.counter);
+    chunk_ = ChunkState{IV, chunk_.counter + SUBTREE_CHUNKS};
+}
+
+Blake3::DigestT Blake3::Final() noexcept
+{
+    if (cv_stack_.empty())
+    {
+        return chunk_output(chunk_).Root();
+    }
+
+    // the stack is merged lazily, so whatever is left joins the right edge of the tree here
+    size_t remaining = cv_stack_.size();
+    Output output{};
+    if (chunk_.Size() > 0)
+    {
+        output = chunk_output(chunk_);
+    }
+    else
+    {
+        output = parent_output(cv_stack_[remaining - 2], cv_stack_[remaining - 1]);
+        remaining -= 2;
+    }
+
+    for (; remaining > 0; --remaining)
+    {
+        output = parent_output(cv_stack_[remaining - 1], output.ChainingValue());
+    }
+
+    return output.Root();
+}
+
+void Blake3::PushCv(const CvT& cv, const uint64_t chunks_before) noexcept
+{
+    MergeCvStack(chunks_before);
+    cv_stack_.push_back(cv);
+}
+
+void Blake3::MergeCvStack(const uint64_t chunks) noexcept
+{
+    // the complete subtrees of the first chunks are merged into their parents, leaving one entry per set bit
+    while (cv_stack_.size() > static_cast<size_t>(std::popcount(chunks)))
+    {
+        const CvT right = cv_stack_.back();
+        cv_stack_.pop_back();
+        const CvT left = cv_stack_.back();
+        cv_stack_.pop_back();
+        cv_stack_.push_back(parent_output(left, right).ChainingValue());
+    }
+}
+
+} // namespace utils
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace utils
+{
+
+/*
+    Streaming BLAKE3 (unkeyed, 32-byte output). Input is hashed in 1 KiB chunks whose chaining values are merged
+    into a binary tree, so a subtree of SUBTREE_SIZE aligned bytes can be hashed on any thread with HashSubtree()
+    and fed back in order with UpdateSubtree(). The last bytes of the input must go through Update(), the root is
+    always finished here.
+ */
+class Blake3
+{
+  public:
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t CHUNK_SIZE = 1024;
+    static constexpr size_t SUBTREE_CHUNKS = 1024;
+    static constexpr size_t SUBTREE_SIZE = SUBTREE_CHUNKS * CHUNK_SIZE;
+    static constexpr size_t DIGEST_SIZE = 32;
+
+    using CvT = std::array<uint32_t, 8>;
+    using DigestT = std::array<uint8_t, DIGEST_SIZE>;
+
+    Blake3() noexcept;
+
+    void Update(std::string_view data) noexcept;
+
+    // chaining value of the SUBTREE_SIZE bytes starting at data, which are subtree number index of the input
+    [[nodiscard]]
+    static CvT HashSubtree(const uint8_t* data, uint64_t index) noexcept;
+
+    // Appends a subtree computed by HashSubtree(). Only valid while the input so far is a whole number of subtrees,
+    // and there has to be more input after it.
+    void UpdateSubtree(const CvT& cv) noexcept;
+
+    // finishes the computation, the hasher must not be updated afterwards
+    [[nodiscard]]
+    DigestT Final() noexcept;
+
+  private:
+    struct ChunkState
+    {
+        CvT cv;
+        uint64_t counter = 0;
+        std::array<uint8_t, BLOCK_SIZE> block{};
+        size_t block_size = 0;
+        size_t blocks_compressed = 0;
+
+        [[nodiscard]]
+        size_t Size() const noexcept
+        {
+            return blocks_compressed * BLOCK_SIZE + block_size;
+        }
+    };
+
+    void PushCv(const CvT& cv, uint64_t chunks_before) noexcept;
+
+    void MergeCvStack(uint64_t chunks) noexcept;
+
+    ChunkState chunk_;
+    std::vector<CvT> cv_stack_;
+};
+
+} // namespace utils
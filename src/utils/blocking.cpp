@@ -0,0 +1,14 @@
+#include "blocking.h"
+
+#include "ConfigManager.h"
+
+namespace utils::blocking
+{
+
+WorkStealingPool& pool()
+{
+    static WorkStealingPool instance{ConfigManager::GetInstance().GetHttpBlockingThreads()};
+    return instance;
+}
+
+} // namespace utils::blocking
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <coroutine>
+#include <type_traits>
+#include <utility>
+
+#include <async_simple/Executor.h>
+#include <async_simple/Try.h>
+#include <async_simple/coro/Lazy.h>
+
+#include "thread_pool.h"
+
+namespace utils::blocking
+{
+
+// where everything that may block (stat, directory walks, hashing, copies, database calls) runs, sized by [http.blocking_threads]
+WorkStealingPool& pool();
+
+/*
+    Runs func on a pool and resumes the awaiting coroutine on the executor (I/O thread) it was suspended on.
+    Lazy hands its executor to coAwait(), so the hop back does not depend on who finished the work.
+ */
+template <class F> class PoolAwaiter
+{
+  public:
+    using ResultT = std::invoke_result_t<F>;
+
+    PoolAwaiter(WorkStealingPool& pool, F func) : pool_(pool), func_(std::move(func))
+    {
+    }
+
+    PoolAwaiter coAwait(async_simple::Executor* executor) &&
+    {
+        executor_ = executor;
+        return std::move(*this);
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        async_simple::Executor::Context context = executor_ != nullptr ? executor_->checkout() : async_simple::Executor::NULLCTX;
+        pool_.Post([this, handle, context]() {
+            result_ = async_simple::makeTryCall(func_);
+            if (executor_ == nullptr)
+            {
+                handle.resume();
+                return;
+            }
+            executor_->checkin([handle]() { handle.resume(); }, context);
+        });
+    }
+
+    async_simple::Try<ResultT> await_resume()
+    {
+        return std::move(result_);
+    }
+
+  private:
+    WorkStealingPool& pool_;
+    F func_;
+    async_simple::Executor* executor_ = nullptr;
+    async_simple::Try<ResultT> result_;
+};
+
+// exceptions thrown by func are rethrown in the awaiting coroutine
+template <class F> async_simple::coro::Lazy<std::invoke_result_t<F>> run_on(WorkStealingPool& pool, F func)
+{
+    async_simple::Try<std::invoke_result_t<F>> result = co_await PoolAwaiter<F>{pool, std::move(func)};
+    co_return std::move(result).value();
+}
+
+template <class F> async_simple::coro::Lazy<std::invoke_result_t<F>> run(F func)
+{
+    return run_on(pool(), std::move(func));
+}
+
+} // namespace utils::blocking
@@ -0,0 +1,133 @@
+#include "buffer_pool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "ConfigManager.h"
+
+namespace utils
+{
+
+// what a connection gets before anything is known about it
+constexpr size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+
+// a buffer should hold about this much of the connection's throughput (1 / 50 s = 20ms)
+constexpr uint64_t BUFFERED_FRACTION_OF_SECOND = 50;
+
+BufferPool::Buffer::Buffer(BufferPool* pool, std::unique_ptr<char[]> data, size_t size) noexcept
+    : pool_(pool), data_(std::move(data)), size_(size)
+{
+}
+
+BufferPool::Buffer::~Buffer()
+{
+    if (pool_ != nullptr && data_ != nullptr)
+    {
+        pool_->Release(std::move(data_), size_);
+    }
+}
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr)), data_(std::move(other.data_)), size_(std::exchange(other.size_, 0))
+{
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (pool_ != nullptr && data_ != nullptr)
+        {
+            pool_->Release(std::move(data_), size_);
+        }
+        pool_ = std::exchange(other.pool_, nullptr);
+        data_ = std::move(other.data_);
+        size_ = std::exchange(other.size_, 0);
+    }
+
+    return *this;
+}
+
+BufferPool& BufferPool::GetInstance()
+{
+    static BufferPool instance{ConfigManager::GetInstance().GetHttpBufferPoolSize()};
+    return instance;
+}
+
+BufferPool::BufferPool(size_t retain_budget) : class_budget_(retain_budget / CLASS_COUNT)
+{
+}
+
+BufferPool::Buffer BufferPool::Acquire(size_t size)
+{
+    const size_t index = ClassIndexOf(size);
+    const size_t class_size = MIN_BUFFER_SIZE << index;
+
+    ++acquires_;
+    in_use_bytes_ += class_size;
+
+    SizeClass& size_class = classes_[index];
+    {
+        std::lock_guard lock{size_class.mutex};
+        if (!size_class.free.empty())
+        {
+            std::unique_ptr<char[]> data = std::move(size_class.free.back());
+            size_class.free.pop_back();
+            retained_bytes_ -= class_size;
+            ++hits_;
+            return Buffer{this, std::move(data), class_size};
+        }
+    }
+
+    // not value-initialized, the contents are always overwritten before they are sent
+    return Buffer{this, std::unique_ptr<char[]>(new char[class_size]), class_size};
+}
+
+void BufferPool::Release(std::unique_ptr<char[]> data, size_t size) noexcept
+{
+    in_use_bytes_ -= size;
+
+    SizeClass& size_class = classes_[ClassIndexOf(size)];
+    {
+        std::lock_guard lock{size_class.mutex};
+        if ((size_class.free.size() + 1) * size <= class_budget_)
+        {
+            size_class.free.push_back(std::move(data));
+            retained_bytes_ += size;
+            return;
+        }
+    }
+
+    ++discards_;
+}
+
+BufferPoolStats BufferPool::GetStats() const noexcept
+{
+    return {acquires_, hits_, discards_, retained_bytes_, in_use_bytes_};
+}
+
+size_t BufferPool::SizeClassOf(size_t size) noexcept
+{
+    return MIN_BUFFER_SIZE << ClassIndexOf(size);
+}
+
+size_t BufferPool::ClassIndexOf(size_t size) noexcept
+{
+    const size_t rounded = std::bit_ceil(std::clamp(size, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE));
+    return static_cast<size_t>(std::countr_zero(rounded / MIN_BUFFER_SIZE));
+}
+
+size_t pick_buffer_size(uint64_t remaining, uint64_t throughput, size_t floor) noexcept
+{
+    const uint64_t wanted = throughput == 0 ? INITIAL_BUFFER_SIZE : throughput / BUFFERED_FRACTION_OF_SECOND;
+    const uint64_t size = std::max<uint64_t>(std::min(wanted, remaining), floor);
+
+    return BufferPool::SizeClassOf(static_cast<size_t>(std::min<uint64_t>(size, BufferPool::MAX_BUFFER_SIZE)));
+}
+
+} // namespace utils
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace utils
+{
+
+struct BufferPoolStats
+{
+    uint64_t acquires = 0;
+
+    // acquires served from a free list, the rest had to allocate
+    uint64_t hits = 0;
+
+    // buffers freed on release because their size class already held its share of the budget
+    uint64_t discards = 0;
+
+    uint64_t retained_bytes = 0;
+    uint64_t in_use_bytes = 0;
+};
+
+/*
+    Send buffers shared by all connections. Sizes are rounded up to a power of two size class between MIN_BUFFER_SIZE
+    and MAX_BUFFER_SIZE, released buffers go back to the free list of their class as long as the class stays within
+    its share of the retention budget. A buffer is leased through Buffer, which hands it back when destroyed.
+ */
+class BufferPool
+{
+  public:
+    static constexpr size_t MIN_BUFFER_SIZE = 16 * 1024;
+    static constexpr size_t MAX_BUFFER_SIZE = 1024 * 1024;
+    static constexpr size_t CLASS_COUNT = 7; // 16 KiB, 32 KiB ... 1 MiB
+
+    class Buffer
+    {
+      public:
+        Buffer() = default;
+        ~Buffer();
+
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        [[nodiscard]]
+        char* data() const noexcept
+        {
+            return data_.get();
+        }
+
+        [[nodiscard]]
+        size_t size() const noexcept
+        {
+            return size_;
+        }
+
+      private:
+        friend class BufferPool;
+
+        Buffer(BufferPool* pool, std::unique_ptr<char[]> data, size_t size) noexcept;
+
+        BufferPool* pool_ = nullptr;
+        std::unique_ptr<char[]> data_;
+        size_t size_ = 0;
+    };
+
+    static BufferPool& GetInstance();
+
+    // retain_budget is the number of bytes kept in the free lists, split evenly over the size classes
+    explicit BufferPool(size_t retain_budget);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // at least size bytes (capped at MAX_BUFFER_SIZE), the actual size is the size class
+    [[nodiscard]]
+    Buffer Acquire(size_t size);
+
+    [[nodiscard]]
+    BufferPoolStats GetStats() const noexcept;
+
+    // the size class a request for size bytes is served from
+    [[nodiscard]]
+    static size_t SizeClassOf(size_t size) noexcept;
+
+  private:
+    struct SizeClass
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<char[]>> free;
+    };
+
+    void Release(std::unique_ptr<char[]> data, size_t size) noexcept;
+
+    static size_t ClassIndexOf(size_t size) noexcept;
+
+    std::array<SizeClass, CLASS_COUNT> classes_;
+    size_t class_budget_;
+
+    std::atomic<uint64_t> acquires_ = 0;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> discards_ = 0;
+    std::atomic<uint64_t> retained_bytes_ = 0;
+    std::atomic<uint64_t> in_use_bytes_ = 0;
+};
+
+/*
+    How big the next send buffer should be: enough for roughly 20ms of what the connection has been taking so far
+    (throughput in bytes per second, 0 when nothing has been measured yet), never more than what is left to send,
+    and never less than floor.
+ */
+[[nodiscard]]
+size_t pick_buffer_size(uint64_t remaining, uint64_t throughput, size_t floor = BufferPool::MIN_BUFFER_SIZE) noexcept;
+
+} // namespace utils
@@ -2,10 +2,99 @@
 
 #include <chrono>
 #include <filesystem>
+#include <system_error>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace utils::file
 {
 
+#ifdef _WIN32
+RandomAccessFile::RandomAccessFile(const std::filesystem::path& path) : ifs_(path, std::ios::binary)
+{
+}
+
+RandomAccessFile::~RandomAccessFile() = default;
+
+bool RandomAccessFile::is_open() const noexcept
+{
+    return ifs_.is_open();
+}
+
+int64_t RandomAccessFile::read_at(char* buffer, size_t size, uint64_t offset) noexcept
+{
+    ifs_.clear();
+    if (!ifs_.seekg(static_cast<std::streamoff>(offset)))
+    {
+        return -1;
+    }
+
+    ifs_.read(buffer, static_cast<std::streamsize>(size));
+    if (ifs_.bad())
+    {
+        return -1;
+    }
+
+    return static_cast<int64_t>(ifs_.gcount());
+}
+
+int RandomAccessFile::native_handle() const noexcept
+{
+    return -1;
+}
+#else
+RandomAccessFile::RandomAccessFile(const std::filesystem::path& path) : fd_(::open(path.c_str(), O_RDONLY | O_CLOEXEC))
+{
+}
+
+RandomAccessFile::~RandomAccessFile()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+bool RandomAccessFile::is_open() const noexcept
+{
+    return fd_ >= 0;
+}
+
+int64_t RandomAccessFile::read_at(char* buffer, size_t size, uint64_t offset) noexcept
+{
+    size_t total = 0;
+    while (total < size)
+    {
+        const ssize_t n = ::pread(fd_, buffer + total, size - total, static_cast<off_t>(offset + total));
+        if (n == 0)
+        {
+            break;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        total += static_cast<size_t>(n);
+    }
+
+    return static_cast<int64_t>(total);
+}
+
+int RandomAccessFile::native_handle() const noexcept
+{
+    return fd_;
+}
+#endif
+
 std::tm* get_last_modified(const std::filesystem::path& path)
 {
     namespace fs = std::filesystem;
@@ -16,4 +105,56 @@ std::tm* get_last_modified(const std::filesystem::path& path)
     return std::localtime(&file_time_t);
 }
 
+std::optional<FileStat> get_file_stat(const std::filesystem::path& path) noexcept
+{
+#ifdef _WIN32
+    namespace fs = std::filesystem;
+
+    // there is no cheap inode on windows, size + mtime is the best we can do
+    std::error_code ec;
+    const auto status = fs::status(path, ec);
+    if (ec || !fs::exists(status))
+    {
+        return std::nullopt;
+    }
+
+    FileStat stat{};
+    if (fs::is_regular_file(status))
+    {
+        stat.size = fs::file_size(path, ec);
+        if (ec)
+        {
+            return std::nullopt;
+        }
+    }
+
+    const auto mtime = fs::last_write_time(path, ec);
+    if (ec)
+    {
+        return std::nullopt;
+    }
+    stat.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+
+    return stat;
+#else
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0)
+    {
+        return std::nullopt;
+    }
+
+    FileStat stat{};
+    stat.dev = static_cast<uint64_t>(st.st_dev);
+    stat.ino = static_cast<uint64_t>(st.st_ino);
+    stat.size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+    stat.mtime_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1'000'000'000 + st.st_mtimespec.tv_nsec;
+#else
+    stat.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+#endif
+
+    return stat;
+#endif
+}
+
 } // namespace file
@@ -1,9 +1,56 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <optional>
 
 namespace utils::file {
 
+// identity of a file's content as seen by the filesystem, two equal tuples mean the content has not been touched
+struct FileStat
+{
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+
+    bool operator==(const FileStat&) const = default;
+};
+
+// read-only file with positional reads, exposes the descriptor where the platform has one (for sendfile)
+class RandomAccessFile
+{
+  public:
+    explicit RandomAccessFile(const std::filesystem::path& path);
+    ~RandomAccessFile();
+
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+    [[nodiscard]]
+    bool is_open() const noexcept;
+
+    // returns the number of bytes read, 0 at end of file, -1 on error
+    [[nodiscard]]
+    int64_t read_at(char* buffer, size_t size, uint64_t offset) noexcept;
+
+    // -1 when the platform has no file descriptors
+    [[nodiscard]]
+    int native_handle() const noexcept;
+
+  private:
+#ifdef _WIN32
+    std::ifstream ifs_;
+#else
+    int fd_ = -1;
+#endif
+};
+
 std::tm* get_last_modified(const std::filesystem::path& path);
 
+[[nodiscard]]
+std::optional<FileStat> get_file_stat(const std::filesystem::path& path) noexcept;
+
 }
@@ -0,0 +1,240 @@
+#include "hash.h"
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <new>
+#include <variant>
+#include <vector>
+
+#include <xxhash.h>
+
+#include "blake3.h"
+#include "sha256.h"
+
+namespace utils::hash
+{
+
+// how much of a file is read at a time when it is not split into subtrees
+static constexpr size_t READ_SIZE = 64 * 1024;
+
+static std::string to_hex(const uint8_t* bytes, const size_t size)
+{
+    constexpr std::string_view DIGITS = "0123456789abcdef";
+
+    std::string hex(size * 2, '\0');
+    for (size_t i = 0; i < size; ++i)
+    {
+        hex[i * 2] = DIGITS[bytes[i] >> 4];
+        hex[i * 2 + 1] = DIGITS[bytes[i] & 0x0F];
+    }
+    return hex;
+}
+
+std::optional<Algorithm> parse_algorithm(const std::string_view name) noexcept
+{
+    if (name == "sha256")
+    {
+        return Algorithm::SHA256;
+    }
+    if (name == "blake3")
+    {
+        return Algorithm::BLAKE3;
+    }
+    if (name == "xxh3")
+    {
+        return Algorithm::XXH3;
+    }
+    return std::nullopt;
+}
+
+std::string_view to_string(const Algorithm algorithm) noexcept
+{
+    switch (algorithm)
+    {
+    case Algorithm::BLAKE3:
+        return "blake3";
+    case Algorithm::XXH3:
+        return "xxh3";
+    default:
+        return "sha256";
+    }
+}
+
+struct XXH3StateDeleter
+{
+    void operator()(XXH3_state_t* state) const noexcept
+    {
+        XXH3_freeState(state);
+    }
+};
+
+struct Hasher::Impl
+{
+    std::variant<Sha256, Blake3, std::unique_ptr<XXH3_state_t, XXH3StateDeleter>> state;
+};
+
+Hasher::Hasher(const Algorithm algorithm) : impl_(std::make_unique<Impl>())
+{
+    switch (algorithm)
+    {
+    case Algorithm::BLAKE3:
+        impl_->state.emplace<Blake3>();
+        break;
+    case Algorithm::XXH3: {
+        std::unique_ptr<XXH3_state_t, XXH3StateDeleter> state{XXH3_createState()};
+        if (state == nullptr || XXH3_128bits_reset(state.get()) != XXH_OK)
+        {
+            throw std::bad_alloc{};
+        }
+        impl_->state = std::move(state);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+Hasher::~Hasher() = default;
+
+void Hasher::Update(const std::string_view data)
+{
+    if (auto* sha = std::get_if<Sha256>(&impl_->state))
+    {
+        sha->Update(data);
+    }
+    else if (auto* blake = std::get_if<Blake3>(&impl_->state))
+    {
+        blake->Update(data);
+    }
+    else
+    {
+        XXH3_128bits_update(std::get<2>(impl_->state).get(), data.data(), data.size());
+    }
+}
+
+std::string Hasher::FinalHex()
+{
+    if (auto* sha = std::get_if<Sha256>(&impl_->state))
+    {
+        return sha->FinalHex();
+    }
+    if (auto* blake = std::get_if<Blake3>(&impl_->state))
+    {
+        const Blake3::DigestT digest = blake->Final();
+        return to_hex(digest.data(), digest.size());
+    }
+
+    XXH128_canonical_t canonical;
+    XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(std::get<2>(impl_->state).get()));
+    return to_hex(canonical.digest, sizeof(canonical.digest));
+}
+
+std::string hex(const std::string_view text, const Algorithm algorithm)
+{
+    Hasher hasher{algorithm};
+    hasher.Update(text);
+    return hasher.FinalHex();
+}
+
+static size_t read_into(std::ifstream& f, std::vector<char>& buffer)
+{
+    f.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<size_t>(f.gcount());
+}
+
+// Subtrees are hashed on the pool as soon as they are read, a subtree is only handed out once the next read shows
+// that it is not the end of the file (the root has to be finished by the hasher itself).
+static std::string blake3_file_hex(std::ifstream& f, WorkStealingPool& pool)
+{
+    struct InFlight
+    {
+        std::vector<char> data;
+        std::future<Blake3::CvT> cv;
+    };
+
+    Blake3 hasher{};
+    std::deque<InFlight> in_flight;
+    std::vector<std::vector<char>> spare;
+    const size_t max_in_flight = pool.Size() * 2;
+
+    const auto take_buffer = [&spare]() {
+        if (spare.empty())
+        {
+            return std::vector<char>(Blake3::SUBTREE_SIZE);
+        }
+        std::vector<char> buffer = std::move(spare.back());
+        spare.pop_back();
+        return buffer;
+    };
+    const auto finish_front = [&hasher, &in_flight, &spare]() {
+        hasher.UpdateSubtree(in_flight.front().cv.get());
+        spare.push_back(std::move(in_flight.front().data));
+        in_flight.pop_front();
+    };
+
+    std::vector<char> pending = take_buffer();
+    size_t pending_size = read_into(f, pending);
+    try
+    {
+        for (uint64_t index = 0; pending_size == Blake3::SUBTREE_SIZE; ++index)
+        {
+            std::vector<char> next = take_buffer();
+            const size_t next_size = read_into(f, next);
+            if (next_size == 0)
+            {
+                break;
+            }
+
+            const auto* data = reinterpret_cast<const uint8_t*>(pending.data());
+            std::future<Blake3::CvT> cv = pool.Submit([data, index]() { return Blake3::HashSubtree(data, index); });
+            in_flight.push_back({std::move(pending), std::move(cv)});
+            if (in_flight.size() > max_in_flight)
+            {
+                finish_front();
+            }
+
+            pending = std::move(next);
+            pending_size = next_size;
+        }
+
+        while (!in_flight.empty())
+        {
+            finish_front();
+        }
+    }
+    catch (...)
+    {
+        // the subtrees still being hashed read from the buffers held here
+        for (InFlight& subtree : in_flight)
+        {
+            subtree.cv.wait();
+        }
+        throw;
+    }
+
+    hasher.Update({pending.data(), pending_size});
+    const Blake3::DigestT digest = hasher.Final();
+    return to_hex(digest.data(), digest.size());
+}
+
+std::string file_hex(const std::filesystem::path& path, const Algorithm algorithm, WorkStealingPool* pool)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (algorithm == Algorithm::BLAKE3 && pool != nullptr && f.is_open())
+    {
+        return blake3_file_hex(f, *pool);
+    }
+
+    Hasher hasher{algorithm};
+    std::vector<char> buffer(READ_SIZE);
+    while (const size_t size = read_into(f, buffer))
+    {
+        hasher.Update({buffer.data(), size});
+    }
+
+    return hasher.FinalHex();
+}
+
+} // namespace utils::hash
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "thread_pool.h"
+
+namespace utils::hash
+{
+
+enum class Algorithm
+{
+    SHA256,
+    BLAKE3,
+    XXH3,
+};
+
+// "sha256" | "blake3" | "xxh3"
+[[nodiscard]]
+std::optional<Algorithm> parse_algorithm(std::string_view name) noexcept;
+
+[[nodiscard]]
+std::string_view to_string(Algorithm algorithm) noexcept;
+
+// streaming hash in one of the algorithms, xxh3 is the 128-bit variant
+class Hasher
+{
+  public:
+    explicit Hasher(Algorithm algorithm);
+    ~Hasher();
+
+    Hasher(const Hasher&) = delete;
+    Hasher& operator=(const Hasher&) = delete;
+
+    void Update(std::string_view data);
+
+    // finishes the computation, the hasher must not be updated afterwards
+    [[nodiscard]]
+    std::string FinalHex();
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+[[nodiscard]]
+std::string hex(std::string_view text, Algorithm algorithm);
+
+// A file that cannot be opened hashes like an empty one. With a pool, large files hashed with BLAKE3 are split
+// into subtrees hashed concurrently on it, which must not be the pool the caller is running on.
+[[nodiscard]]
+std::string file_hex(const std::filesystem::path& path, Algorithm algorithm, WorkStealingPool* pool = nullptr);
+
+} // namespace utils::hash
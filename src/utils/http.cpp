@@ -0,0 +1,200 @@
+#include "http.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <format>
+#include <string>
+#include <system_error>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/sendfile.h>
+#endif
+
+#include "ConfigManager.h"
+#include "blocking.h"
+#include "buffer_pool.h"
+
+namespace utils::http
+{
+
+// sendfile(2) transfers at most 0x7ffff000 bytes per call
+constexpr uint64_t MAX_SENDFILE_CHUNK = 0x7ffff000;
+
+static std::string_view status_text(int status)
+{
+    switch (status)
+    {
+    case 200:
+        return "OK";
+    case 206:
+        return "Partial Content";
+    case 207:
+        return "Multi-Status";
+    case 304:
+        return "Not Modified";
+    case 412:
+        return "Precondition Failed";
+    case 416:
+        return "Range Not Satisfiable";
+    default:
+        return "";
+    }
+}
+
+std::string build_response_head(int status, const HeaderListT& headers)
+{
+    std::string head = std::format("HTTP/1.1 {} {}\r\n", status, status_text(status));
+    for (const auto& [k, v] : headers)
+    {
+        head += k;
+        head += ": ";
+        head += v;
+        head += "\r\n";
+    }
+    head += "\r\n";
+
+    return head;
+}
+
+std::string format_http_date(std::time_t time)
+{
+    char buffer[64];
+    std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", std::gmtime(&time));
+    return {buffer};
+}
+
+async_simple::coro::Lazy<bool> write_chunk(cinatra::coro_http_connection* conn, std::string_view data)
+{
+    if (data.empty())
+    {
+        co_return true;
+    }
+
+    const std::string size_line = std::format("{:x}\r\n", data.size());
+    if (!(co_await conn->write_data(size_line)) || !(co_await conn->write_data(data)))
+    {
+        co_return false;
+    }
+
+    co_return co_await conn->write_data("\r\n");
+}
+
+async_simple::coro::Lazy<bool> end_chunks(cinatra::coro_http_connection* conn)
+{
+    co_return co_await conn->write_data("0\r\n\r\n");
+}
+
+static async_simple::coro::Lazy<bool> copy_file_range_to(cinatra::coro_http_connection* conn, utils::file::RandomAccessFile& file,
+                                                         uint64_t offset, uint64_t length)
+{
+    static const size_t floor = ConfigManager::GetInstance().GetHttpBufferSize();
+    auto& pool = utils::BufferPool::GetInstance();
+
+    // bytes per second the client has been taking, smoothed, 0 until the first write finished
+    uint64_t throughput = 0;
+    utils::BufferPool::Buffer buffer = pool.Acquire(utils::pick_buffer_size(length, throughput, floor));
+
+    while (length > 0)
+    {
+        // a cold page cache or a network filesystem must not stall every connection of the I/O thread
+        const size_t chunk = std::min<uint64_t>(buffer.size(), length);
+        const int64_t readed =
+            co_await utils::blocking::run([&file, &buffer, chunk, offset]() { return file.read_at(buffer.data(), chunk, offset); });
+        if (readed <= 0)
+        {
+            co_return false;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (!(co_await conn->write_data({buffer.data(), static_cast<size_t>(readed)})))
+        {
+            co_return false;
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        offset += static_cast<uint64_t>(readed);
+        length -= static_cast<uint64_t>(readed);
+
+        const uint64_t sample = static_cast<uint64_t>(readed) * 1'000'000 / static_cast<uint64_t>(std::max<int64_t>(elapsed, 1));
+        throughput = throughput == 0 ? sample : (throughput * 3 + sample) / 4;
+
+        // a slow client ties up less memory, a fast one needs fewer round trips through the event loop
+        if (const size_t wanted = utils::pick_buffer_size(length, throughput, floor); length > 0 && wanted != buffer.size())
+        {
+            buffer = pool.Acquire(wanted);
+        }
+    }
+
+    co_return true;
+}
+
+#ifdef __linux__
+static async_simple::coro::Lazy<bool> sendfile_range_to(cinatra::coro_http_connection* conn, int file_fd, uint64_t offset, uint64_t length)
+{
+    auto& socket = conn->socket();
+
+    std::error_code ec;
+    socket.native_non_blocking(true, ec);
+    if (ec)
+    {
+        co_return false;
+    }
+
+    auto file_offset = static_cast<off_t>(offset);
+    while (length > 0)
+    {
+        const ssize_t sent = ::sendfile(socket.native_handle(), file_fd, &file_offset, std::min(length, MAX_SENDFILE_CHUNK));
+        if (sent > 0)
+        {
+            length -= static_cast<uint64_t>(sent);
+            continue;
+        }
+
+        // the file got shorter than the Content-Length we announced
+        if (sent == 0)
+        {
+            co_return false;
+        }
+
+        if (errno == EINTR)
+        {
+            continue;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            co_return false;
+        }
+
+        // socket buffer is full, park the coroutine until the socket is writable again
+        ec = co_await coro_io::async_io<std::error_code>(
+            [&socket](auto&& cb) { socket.async_wait(asio::ip::tcp::socket::wait_write, std::move(cb)); }, socket);
+        if (ec)
+        {
+            co_return false;
+        }
+    }
+
+    co_return true;
+}
+#endif
+
+async_simple::coro::Lazy<bool> send_file_range(cinatra::coro_http_connection* conn, utils::file::RandomAccessFile& file, uint64_t offset,
+                                               uint64_t length)
+{
+#ifdef __linux__
+    // sendfile would bypass the TLS layer
+    static const bool zero_copy = !ConfigManager::GetInstance().GetHttpsEnabled();
+    if (zero_copy && file.native_handle() >= 0)
+    {
+        co_return co_await sendfile_range_to(conn, file.native_handle(), offset, length);
+    }
+#endif
+
+    co_return co_await copy_file_range_to(conn, file, offset, length);
+}
+
+} // namespace utils::http
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <async_simple/coro/Lazy.h>
+#include <cinatra/coro_http_connection.hpp>
+
+#include "utils/file.h"
+
+namespace utils::http
+{
+
+using HeaderListT = std::vector<std::pair<std::string, std::string>>;
+
+/*
+    build_response_head(200, {{"Content-Length", "3"}}) ->
+    "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\n"
+ */
+[[nodiscard]]
+std::string build_response_head(int status, const HeaderListT& headers);
+
+// formats a time point the way HTTP headers want it: "Sun, 06 Nov 1994 08:49:37 GMT"
+[[nodiscard]]
+std::string format_http_date(std::time_t time);
+
+// frames data as one chunk of a chunked body, empty data is skipped since it would end the body
+async_simple::coro::Lazy<bool> write_chunk(cinatra::coro_http_connection* conn, std::string_view data);
+
+// writes the terminating zero-length chunk
+async_simple::coro::Lazy<bool> end_chunks(cinatra::coro_http_connection* conn);
+
+/*
+    Writes [offset, offset + length) of the file to the connection, the response head must already be written.
+    Plain HTTP connections on linux go through sendfile(2) so the data never enters user space, TLS connections
+    (and other platforms) fall back to positional reads into a buffer. Returns false when the client went away
+    or the file shrank underneath us, in both cases the connection can not be reused.
+ */
+async_simple::coro::Lazy<bool> send_file_range(cinatra::coro_http_connection* conn, utils::file::RandomAccessFile& file, uint64_t offset,
+                                               uint64_t length);
+
+} // namespace utils::http
@@ -0,0 +1,461 @@
+#include "journal.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+#include "utils/mapped_table.h"
+#include "utils/path.h"
+
+namespace utils
+{
+
+static constexpr std::string_view MAGIC = "DAVJRNL1";
+static constexpr std::string_view SEGMENT_INFIX = ".journal.";
+static constexpr std::string_view SNAPSHOT_SUFFIX = ".tmp";
+
+// u32 length + u32 crc32
+static constexpr size_t FRAME_HEADER_SIZE = 8;
+
+static void put_u32(std::string& out, const uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static uint32_t get_u32(const char* data) noexcept
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (i * 8);
+    }
+    return value;
+}
+
+static void append_frame(std::string& out, const std::string_view record)
+{
+    put_u32(out, static_cast<uint32_t>(record.size()));
+    put_u32(out, journal::crc32(record));
+    out.append(record);
+}
+
+static bool sync_file(std::FILE* file) noexcept
+{
+    if (std::fflush(file) != 0)
+    {
+        return false;
+    }
+
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#elif defined(__APPLE__)
+    return fsync(fileno(file)) == 0;
+#else
+    return fdatasync(fileno(file)) == 0;
+#endif
+}
+
+// makes a rename durable, the directory entry lives in the parent directory
+static void sync_directory([[maybe_unused]] const std::filesystem::path& dir) noexcept
+{
+#ifndef _WIN32
+    const int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+#endif
+}
+
+static bool has_magic(std::istream& is)
+{
+    char magic[MAGIC.size()];
+    return is.read(magic, sizeof(magic)) && std::string_view{magic, sizeof(magic)} == MAGIC;
+}
+
+// calls handler for every intact frame and returns how many there were
+static size_t read_frames(const std::filesystem::path& path, const Journal::RecordHandlerT& handler)
+{
+    std::ifstream ifs{path, std::ios::in | std::ios::binary};
+    if (!has_magic(ifs))
+    {
+        return 0;
+    }
+
+    size_t records = 0;
+    std::string payload;
+    char header[FRAME_HEADER_SIZE];
+    while (ifs.read(header, sizeof(header)))
+    {
+        const uint32_t size = get_u32(header);
+        const uint32_t crc = get_u32(header + 4);
+
+        payload.resize(size);
+        if (!ifs.read(payload.data(), size) || journal::crc32(payload) != crc)
+        {
+            LOG_WARN_FMT("'{}' ends with an incomplete record, it was dropped.", path::to_string(path))
+            break;
+        }
+
+        handler(payload);
+        ++records;
+    }
+
+    return records;
+}
+
+Journal::Journal(std::filesystem::path base, const uint64_t compact_size, SnapshotT snapshot)
+    : base_(std::move(base)), compact_size_(compact_size), snapshot_(std::move(snapshot))
+{
+}
+
+Journal::~Journal()
+{
+    if (!open_)
+    {
+        return;
+    }
+
+    compactor_ = {};
+    writer_ = {};
+    Compact(false);
+    open_ = false;
+}
+
+bool Journal::IsJournalFile(const std::filesystem::path& path) noexcept
+{
+    std::ifstream ifs{path, std::ios::in | std::ios::binary};
+    return has_magic(ifs);
+}
+
+bool Journal::Open(const RecordHandlerT& replay)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    const fs::path dir = base_.has_parent_path() ? base_.parent_path() : fs::path{"."};
+    fs::create_directories(dir, ec);
+
+    // a snapshot in the format before tables is replayed like a segment
+    size_t replayed = IsJournalFile(base_) ? read_frames(base_, replay) : 0;
+
+    // segments are replayed in the order they were written, whatever the directory listing order is
+    const std::string prefix = base_.filename().string() + std::string{SEGMENT_INFIX};
+    std::vector<uint64_t> segments;
+    for (fs::directory_iterator it{dir, ec}, end; !ec && it != end; it.increment(ec))
+    {
+        const std::string name = it->path().filename().string();
+        uint64_t number = 0;
+        if (name.starts_with(prefix) &&
+            std::from_chars(name.data() + prefix.size(), name.data() + name.size(), number).ptr == name.data() + name.size())
+        {
+            segments.push_back(number);
+        }
+    }
+    std::ranges::sort(segments);
+
+    for (const uint64_t number : segments)
+    {
+        replayed += read_frames(SegmentPath(number), replay);
+    }
+
+    if (!OpenSegment(segments.empty() ? 1 : segments.back() + 1))
+    {
+        return false;
+    }
+
+    // fold what was replayed into a snapshot right away, so the next start reads only that
+    compact_requested_ = compact_requested_ || replayed > 0;
+    open_ = true;
+
+    writer_ = std::jthread{[this](std::stop_token stop_token) { WriterLoop(std::move(stop_token)); }};
+    compactor_ = std::jthread{[this](std::stop_token stop_token) { CompactorLoop(std::move(stop_token)); }};
+    return true;
+}
+
+void Journal::RequestCompaction()
+{
+    {
+        std::lock_guard lock{mutex_};
+        compact_requested_ = true;
+    }
+    compact_cv_.notify_one();
+}
+
+bool Journal::IsOpen() const noexcept
+{
+    return open_;
+}
+
+uint64_t Journal::Append(const std::string_view record)
+{
+    if (!open_)
+    {
+        return 0;
+    }
+
+    bool compact = false;
+    uint64_t seq = 0;
+    {
+        std::lock_guard lock{mutex_};
+        append_frame(pending_, record);
+        seq = ++appended_;
+
+        segment_bytes_ += FRAME_HEADER_SIZE + record.size();
+        if (segment_bytes_ >= compact_size_ && !compact_requested_)
+        {
+            compact = compact_requested_ = true;
+        }
+    }
+
+    pending_cv_.notify_one();
+    if (compact)
+    {
+        compact_cv_.notify_one();
+    }
+
+    return seq;
+}
+
+void Journal::WaitDurable(const uint64_t seq)
+{
+    std::unique_lock lock{mutex_};
+    durable_cv_.wait(lock, [this, seq]() { return durable_ >= seq; });
+}
+
+void Journal::WriterLoop(std::stop_token stop_token)
+{
+    while (true)
+    {
+        {
+            // whatever piled up while the last batch was being synced goes out together
+            std::unique_lock lock{mutex_};
+            if (!pending_cv_.wait(lock, stop_token, [this]() { return !pending_.empty(); }))
+            {
+                return;
+            }
+        }
+
+        std::lock_guard io_lock{io_mutex_};
+        Flush();
+    }
+}
+
+void Journal::CompactorLoop(std::stop_token stop_token)
+{
+    std::unique_lock lock{mutex_};
+    while (compact_cv_.wait(lock, stop_token, [this]() { return compact_requested_; }))
+    {
+        lock.unlock();
+        Compact(true);
+        lock.lock();
+        compact_requested_ = false;
+    }
+}
+
+void Journal::Flush()
+{
+    std::string frames;
+    uint64_t last = 0;
+    {
+        std::lock_guard lock{mutex_};
+        frames = std::exchange(pending_, {});
+        last = appended_;
+    }
+
+    WriteAndSync(frames);
+
+    {
+        std::lock_guard lock{mutex_};
+        durable_ = std::max(durable_, last);
+    }
+    durable_cv_.notify_all();
+}
+
+uint64_t Journal::Rotate(const bool reopen)
+{
+    std::lock_guard io_lock{io_mutex_};
+    Flush();
+
+    const uint64_t old = segment_number_;
+    if (segment_ != nullptr)
+    {
+        std::fclose(segment_);
+        segment_ = nullptr;
+    }
+
+    {
+        std::lock_guard lock{mutex_};
+        segment_bytes_ = 0;
+    }
+    if (reopen)
+    {
+        OpenSegment(old + 1);
+    }
+
+    return old;
+}
+
+void Journal::Compact(const bool reopen)
+{
+    // every change in the segments up to the old one was applied before the snapshot starts, so it covers them
+    const uint64_t old = Rotate(reopen);
+    if (!WriteSnapshot())
+    {
+        return;
+    }
+
+    std::error_code ec;
+    for (uint64_t number = old; number > 0 && std::filesystem::remove(SegmentPath(number), ec); --number)
+    {
+    }
+}
+
+bool Journal::WriteSnapshot()
+{
+    std::filesystem::path tmp = base_;
+    tmp += SNAPSHOT_SUFFIX;
+
+    std::FILE* file = std::fopen(path::to_string(tmp).c_str(), "wb");
+    if (file == nullptr)
+    {
+        LOG_ERROR_FMT("Unable to write a snapshot to '{}': {}", path::to_string(tmp), std::strerror(errno))
+        return false;
+    }
+
+    std::vector<MappedTable::EntryT> entries;
+    snapshot_([&entries](const std::string_view key, const std::string_view value) { entries.emplace_back(key, value); });
+
+    bool ok = MappedTable::Write(file, entries);
+    ok = sync_file(file) && ok;
+    std::fclose(file);
+
+    std::error_code ec;
+    if (ok)
+    {
+        std::filesystem::rename(tmp, base_, ec);
+    }
+    if (!ok || ec)
+    {
+        LOG_ERROR_FMT("Unable to write a snapshot to '{}', the journal is kept instead.", path::to_string(base_))
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    sync_directory(base_.has_parent_path() ? base_.parent_path() : std::filesystem::path{"."});
+    return true;
+}
+
+bool Journal::OpenSegment(const uint64_t number)
+{
+    const std::filesystem::path path = SegmentPath(number);
+    segment_ = std::fopen(path::to_string(path).c_str(), "wb");
+    if (segment_ == nullptr)
+    {
+        LOG_ERROR_FMT("Unable to open the journal '{}': {}", path::to_string(path), std::strerror(errno))
+        return false;
+    }
+
+    segment_number_ = number;
+    if (std::fwrite(MAGIC.data(), 1, MAGIC.size(), segment_) != MAGIC.size() || !sync_file(segment_))
+    {
+        LOG_ERROR_FMT("Unable to write to the journal '{}'", path::to_string(path))
+    }
+
+    return true;
+}
+
+void Journal::WriteAndSync(const std::string& frames)
+{
+    if (frames.empty() || segment_ == nullptr)
+    {
+        return;
+    }
+
+    if (std::fwrite(frames.data(), 1, frames.size(), segment_) != frames.size() || !sync_file(segment_))
+    {
+        LOG_ERROR_FMT("Unable to write to the journal '{}': {}", path::to_string(SegmentPath(segment_number_)), std::strerror(errno))
+    }
+}
+
+std::filesystem::path Journal::SegmentPath(const uint64_t number) const
+{
+    std::filesystem::path path = base_;
+    path += std::string{SEGMENT_INFIX} + std::to_string(number);
+    return path;
+}
+
+namespace journal
+{
+
+void append_field(std::string& record, const std::string_view field)
+{
+    put_u32(record, static_cast<uint32_t>(field.size()));
+    record.append(field);
+}
+
+std::optional<std::string_view> read_field(std::string_view& record) noexcept
+{
+    if (record.size() < 4)
+    {
+        return std::nullopt;
+    }
+
+    const uint32_t size = get_u32(record.data());
+    if (record.size() - 4 < size)
+    {
+        return std::nullopt;
+    }
+
+    const std::string_view field = record.substr(4, size);
+    record.remove_prefix(4 + size);
+    return field;
+}
+
+static constexpr std::array<uint32_t, 256> CRC32_TABLE = []() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+uint32_t crc32(const std::string_view data, uint32_t crc) noexcept
+{
+    crc ^= 0xFFFFFFFFu;
+    for (const char c : data)
+    {
+        crc = CRC32_TABLE[(crc ^ static_cast<unsigned char>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+} // namespace journal
+
+} // namespace utils
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace utils
+{
+
+/*
+    Write-ahead journal with snapshots for the in-memory engines. Every change is appended as a record to the
+    current segment (<base>.journal.<n>), a writer thread collects whatever was appended while it was busy and
+    commits it with a single write and fdatasync (group commit). Once the segment grows past compact_size a new
+    segment is started and a background thread writes a snapshot of the whole state to <base> (a MappedTable),
+    after which the older segments are deleted. The owner loads the snapshot itself (see TableLoader), the
+    journal only replays the segments that are newer than it.
+
+    Records are opaque to the journal and must be idempotent (assignments and removals of whole entries): a
+    snapshot may already contain changes that are also in the segments replayed after it.
+
+    Segments are a magic header followed by frames of [u32 length][u32 crc32][payload], a frame cut short by a
+    crash ends the replay of its file.
+ */
+class Journal
+{
+  public:
+    using RecordHandlerT = std::function<void(std::string_view record)>;
+    using EmitT = std::function<void(std::string_view key, std::string_view value)>;
+
+    // called from the compaction thread, emits every entry of the current state
+    using SnapshotT = std::function<void(const EmitT& emit)>;
+
+    Journal(std::filesystem::path base, uint64_t compact_size, SnapshotT snapshot);
+
+    // flushes the journal and writes a final snapshot
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // true for a file of journal records (a segment, or a snapshot written before snapshots were tables)
+    [[nodiscard]]
+    static bool IsJournalFile(const std::filesystem::path& path) noexcept;
+
+    // replays the segments after the snapshot, then starts the writer; false when nothing can be persisted
+    bool Open(const RecordHandlerT& replay);
+
+    // writes a new snapshot in the background, e.g. once a file in an older format has been read
+    void RequestCompaction();
+
+    [[nodiscard]]
+    bool IsOpen() const noexcept;
+
+    // queues the record for the next group commit and returns its sequence number, never waits for the disk
+    uint64_t Append(std::string_view record);
+
+    // blocks until every record up to seq has been synced (returns right away for the 0 of a closed journal)
+    void WaitDurable(uint64_t seq);
+
+  private:
+    void WriterLoop(std::stop_token stop_token);
+
+    void CompactorLoop(std::stop_token stop_token);
+
+    // writes and syncs everything appended so far, io_mutex_ must be held
+    void Flush();
+
+    // moves appends to a new segment (or none when reopen is false) and returns the number of the old one
+    uint64_t Rotate(bool reopen);
+
+    void Compact(bool reopen);
+
+    bool WriteSnapshot();
+
+    bool OpenSegment(uint64_t number);
+
+    void WriteAndSync(const std::string& frames);
+
+    [[nodiscard]]
+    std::filesystem::path SegmentPath(uint64_t number) const;
+
+    std::filesystem::path base_;
+    uint64_t compact_size_;
+    SnapshotT snapshot_;
+
+    std::atomic<bool> open_ = false;
+
+    // the segment appends go to, guarded by io_mutex_ (held while a batch is written and synced)
+    std::mutex io_mutex_;
+    std::FILE* segment_ = nullptr;
+    uint64_t segment_number_ = 0;
+
+    // appended but not yet written and the compaction trigger, guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable_any pending_cv_;
+    std::condition_variable durable_cv_;
+    std::string pending_;
+    uint64_t appended_ = 0;
+    uint64_t durable_ = 0;
+    uint64_t segment_bytes_ = 0;
+    bool compact_requested_ = false;
+    std::condition_variable_any compact_cv_;
+
+    std::jthread writer_;
+    std::jthread compactor_;
+};
+
+namespace journal
+{
+
+// appends a length-prefixed field to a record
+void append_field(std::string& record, std::string_view field);
+
+// takes the next field off the front of a record, std::nullopt when the record is truncated
+[[nodiscard]]
+std::optional<std::string_view> read_field(std::string_view& record) noexcept;
+
+// crc32(b, crc32(a)) == crc32(a + b)
+[[nodiscard]]
+uint32_t crc32(std::string_view data, uint32_t crc = 0) noexcept;
+
+} // namespace journal
+
+} // namespace utils
@@ -0,0 +1,333 @@
+#include "mapped_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+#include "utils/journal.h"
+#include "utils/path.h"
+
+namespace utils
+{
+
+static constexpr std::string_view MAGIC = "DAVTBL01";
+static constexpr uint32_t VERSION = 1;
+
+static constexpr size_t HEADER_SIZE = 56;
+static constexpr size_t HEADER_CRC_OFFSET = 12;
+static constexpr size_t INDEX_ENTRY_SIZE = 16;
+
+template <class T> static void put(std::string& out, const T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (i * 8)) & 0xFF));
+    }
+}
+
+template <class T> static T get(const char* data) noexcept
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (i * 8);
+    }
+    return static_cast<T>(value);
+}
+
+// the header's crc covers the header with the crc field itself zeroed
+static uint32_t header_crc(std::string_view header)
+{
+    std::string copy{header.substr(0, HEADER_SIZE)};
+    std::memset(copy.data() + HEADER_CRC_OFFSET, 0, sizeof(uint32_t));
+    return journal::crc32(copy);
+}
+
+MappedTable::~MappedTable()
+{
+#ifndef _WIN32
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+std::unique_ptr<MappedTable> MappedTable::Open(const std::filesystem::path& path)
+{
+    std::unique_ptr<MappedTable> table{new MappedTable{}};
+
+#ifdef _WIN32
+    // no mmap here, the file is read in one go which is still far cheaper than parsing it
+    std::ifstream ifs{path, std::ios::in | std::ios::binary};
+    if (!ifs.is_open())
+    {
+        return nullptr;
+    }
+    table->buffer_.assign(std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{});
+    table->data_ = table->buffer_.data();
+    table->size_ = table->buffer_.size();
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_SIZE)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    table->data_ = static_cast<const char*>(data);
+    table->size_ = static_cast<size_t>(st.st_size);
+#endif
+
+    if (table->size_ < HEADER_SIZE)
+    {
+        return nullptr;
+    }
+
+    const std::string_view header{table->data_, HEADER_SIZE};
+    if (!header.starts_with(MAGIC))
+    {
+        return nullptr;
+    }
+    if (get<uint32_t>(table->data_ + 8) != VERSION || get<uint32_t>(table->data_ + HEADER_CRC_OFFSET) != header_crc(header))
+    {
+        LOG_ERROR_FMT("'{}' is no snapshot of this version or its header is damaged.", path::to_string(path))
+        return nullptr;
+    }
+
+    table->count_ = get<uint64_t>(table->data_ + 16);
+    const uint64_t index_offset = get<uint64_t>(table->data_ + 24);
+    const uint64_t arena_offset = get<uint64_t>(table->data_ + 32);
+    table->arena_size_ = get<uint64_t>(table->data_ + 40);
+    table->body_crc_ = get<uint32_t>(table->data_ + 48);
+
+    if (index_offset != HEADER_SIZE || table->count_ > (table->size_ - HEADER_SIZE) / INDEX_ENTRY_SIZE ||
+        arena_offset != HEADER_SIZE + table->count_ * INDEX_ENTRY_SIZE || arena_offset + table->arena_size_ != table->size_)
+    {
+        LOG_ERROR_FMT("The snapshot '{}' is truncated.", path::to_string(path))
+        return nullptr;
+    }
+
+    table->index_ = table->data_ + index_offset;
+    table->arena_ = table->data_ + arena_offset;
+    return table;
+}
+
+bool MappedTable::IsTable(const std::filesystem::path& path) noexcept
+{
+    std::ifstream ifs{path, std::ios::in | std::ios::binary};
+    char magic[MAGIC.size()];
+    return ifs.read(magic, sizeof(magic)) && std::string_view{magic, sizeof(magic)} == MAGIC;
+}
+
+bool MappedTable::Write(std::FILE* file, std::vector<EntryT>& entries)
+{
+    std::ranges::sort(entries, {}, &EntryT::first);
+
+    std::string index;
+    index.reserve(entries.size() * INDEX_ENTRY_SIZE);
+    uint64_t arena_size = 0;
+    for (const auto& [key, value] : entries)
+    {
+        put<uint64_t>(index, arena_size);
+        put<uint32_t>(index, static_cast<uint32_t>(key.size()));
+        put<uint32_t>(index, static_cast<uint32_t>(value.size()));
+        arena_size += key.size() + value.size();
+    }
+
+    std::string arena;
+    arena.reserve(arena_size);
+    for (const auto& [key, value] : entries)
+    {
+        arena.append(key).append(value);
+    }
+
+    std::string header{MAGIC};
+    put<uint32_t>(header, VERSION);
+    put<uint32_t>(header, 0);
+    put<uint64_t>(header, entries.size());
+    put<uint64_t>(header, HEADER_SIZE);
+    put<uint64_t>(header, HEADER_SIZE + index.size());
+    put<uint64_t>(header, arena_size);
+    put<uint32_t>(header, journal::crc32(arena, journal::crc32(index)));
+    put<uint32_t>(header, 0);
+
+    const uint32_t crc = header_crc(header);
+    for (size_t i = 0; i < sizeof(uint32_t); ++i)
+    {
+        header[HEADER_CRC_OFFSET + i] = static_cast<char>((crc >> (i * 8)) & 0xFF);
+    }
+
+    return std::fwrite(header.data(), 1, header.size(), file) == header.size() &&
+           std::fwrite(index.data(), 1, index.size(), file) == index.size() &&
+           std::fwrite(arena.data(), 1, arena.size(), file) == arena.size();
+}
+
+std::optional<std::string_view> MappedTable::Find(const std::string_view key) const noexcept
+{
+    uint64_t low = 0;
+    uint64_t high = count_;
+    while (low < high)
+    {
+        const uint64_t mid = low + (high - low) / 2;
+        const auto entry = Entry(mid);
+        if (!entry.has_value())
+        {
+            return std::nullopt;
+        }
+
+        if (const int cmp = entry->first.compare(key); cmp == 0)
+        {
+            return entry->second;
+        }
+        else if (cmp < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return std::nullopt;
+}
+
+bool MappedTable::VerifyBody() const noexcept
+{
+    return journal::crc32({index_, static_cast<size_t>(size_ - (index_ - data_))}) == body_crc_;
+}
+
+std::optional<std::pair<std::string_view, std::string_view>> MappedTable::Entry(const uint64_t index) const noexcept
+{
+    const char* entry = index_ + index * INDEX_ENTRY_SIZE;
+    const uint64_t offset = get<uint64_t>(entry);
+    const uint64_t key_size = get<uint32_t>(entry + 8);
+    const uint64_t value_size = get<uint32_t>(entry + 12);
+    if (offset > arena_size_ || key_size + value_size > arena_size_ - offset)
+    {
+        return std::nullopt;
+    }
+
+    return std::pair{std::string_view{arena_ + offset, key_size}, std::string_view{arena_ + offset + key_size, value_size}};
+}
+
+TableLoader::~TableLoader()
+{
+    thread_ = {};
+}
+
+uint64_t TableLoader::Start(const std::filesystem::path& path, LoadT load, LoadedT loaded)
+{
+    std::shared_ptr<const MappedTable> table = MappedTable::Open(path);
+    if (table == nullptr)
+    {
+        return 0;
+    }
+
+    const uint64_t size = table->Size();
+    {
+        std::lock_guard lock{table_mutex_};
+        table_ = std::move(table);
+    }
+    loaded_ = false;
+    thread_ = std::jthread{[this, load = std::move(load), loaded = std::move(loaded), path](std::stop_token stop_token) {
+        Load(std::move(stop_token), load);
+        loaded();
+        LOG_INFO_FMT("Loaded the snapshot '{}'", path::to_string(path))
+    }};
+
+    return size;
+}
+
+bool TableLoader::IsLoaded() const noexcept
+{
+    return loaded_;
+}
+
+void TableLoader::WaitLoaded()
+{
+    std::unique_lock lock{mutex_};
+    loaded_cv_.wait(lock, [this]() { return loaded_.load(); });
+}
+
+std::optional<std::string> TableLoader::Find(const std::string_view key) const
+{
+    const std::shared_ptr<const MappedTable> table = Table();
+    if (table == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    if (const auto value = table->Find(key); value.has_value())
+    {
+        return std::string{*value};
+    }
+
+    return std::nullopt;
+}
+
+void TableLoader::Load(std::stop_token stop_token, const LoadT& load)
+{
+    const std::shared_ptr<const MappedTable> table = Table();
+    if (!table->VerifyBody())
+    {
+        LOG_ERROR("The snapshot is damaged, only the journal has been recovered.")
+        Finish();
+        return;
+    }
+
+    table->ForEach([&stop_token, &load](const std::string_view key, const std::string_view value) {
+        load(key, value);
+        return !stop_token.stop_requested();
+    });
+    Finish();
+}
+
+void TableLoader::Finish()
+{
+    // unmapped once the last lookup using it is done
+    {
+        std::lock_guard lock{table_mutex_};
+        table_.reset();
+    }
+
+    {
+        std::lock_guard lock{mutex_};
+        loaded_ = true;
+    }
+    loaded_cv_.notify_all();
+}
+
+std::shared_ptr<const MappedTable> TableLoader::Table() const
+{
+    std::shared_lock lock{table_mutex_};
+    return table_;
+}
+
+} // namespace utils
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace utils
+{
+
+/*
+    Read-only key/value table queried in place. The file is a header, an index of (key offset, key size, value size)
+    sorted by key and a string arena holding every key followed by its value:
+
+        magic "DAVTBL01" | u32 version | u32 header crc32 | u64 count | u64 index offset | u64 arena offset |
+        u64 arena size | u32 body crc32 (index + arena) | u32 reserved | index | arena
+
+    Opening only checks the header, it is mapped (read into memory where there is no mmap) and not parsed, so the
+    cost does not grow with the number of entries. Every entry is bounds-checked on access, the body checksum is
+    verified by whoever reads the table as a whole (VerifyBody).
+ */
+class MappedTable
+{
+  public:
+    using EntryT = std::pair<std::string, std::string>;
+
+    ~MappedTable();
+
+    MappedTable(const MappedTable&) = delete;
+    MappedTable& operator=(const MappedTable&) = delete;
+
+    // nullptr when the file is missing, is no table or has a damaged header
+    [[nodiscard]]
+    static std::unique_ptr<MappedTable> Open(const std::filesystem::path& path);
+
+    [[nodiscard]]
+    static bool IsTable(const std::filesystem::path& path) noexcept;
+
+    // sorts entries by key and writes the table to file (not synced, the caller decides how durable it has to be)
+    static bool Write(std::FILE* file, std::vector<EntryT>& entries);
+
+    [[nodiscard]]
+    std::optional<std::string_view> Find(std::string_view key) const noexcept;
+
+    // calls func(key, value) in key order, stops early when func returns false
+    template <class F> void ForEach(F&& func) const
+    {
+        for (uint64_t i = 0; i < count_; ++i)
+        {
+            if (const auto entry = Entry(i); entry.has_value() && !func(entry->first, entry->second))
+            {
+                return;
+            }
+        }
+    }
+
+    [[nodiscard]]
+    bool VerifyBody() const noexcept;
+
+    [[nodiscard]]
+    uint64_t Size() const noexcept
+    {
+        return count_;
+    }
+
+  private:
+    MappedTable() = default;
+
+    [[nodiscard]]
+    std::optional<std::pair<std::string_view, std::string_view>> Entry(uint64_t index) const noexcept;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    std::string buffer_;
+#endif
+
+    uint64_t count_ = 0;
+    const char* index_ = nullptr;
+    const char* arena_ = nullptr;
+    uint64_t arena_size_ = 0;
+    uint32_t body_crc_ = 0;
+};
+
+/*
+    Brings a snapshot table into an engine's map without delaying the start: a thread calls load(key, value) for
+    every entry while lookups that miss the map fault single entries in through Find. Once everything is loaded the
+    table is unmapped, an engine has to keep whatever it removes in the meantime as a tombstone so that the thread
+    does not bring it back, and drops the tombstones once loaded() is called.
+ */
+class TableLoader
+{
+  public:
+    using LoadT = std::function<void(std::string_view key, std::string_view value)>;
+    using LoadedT = std::function<void()>;
+
+    ~TableLoader();
+
+    // opens path and starts loading it, a missing file counts as loaded; returns the number of entries to load.
+    // loaded() runs on the loading thread once IsLoaded() is true, a damaged table is loaded as far as it goes.
+    uint64_t Start(const std::filesystem::path& path, LoadT load, LoadedT loaded);
+
+    [[nodiscard]]
+    bool IsLoaded() const noexcept;
+
+    void WaitLoaded();
+
+    // the value of key while the table is still being loaded, a copy since the table goes away afterwards
+    [[nodiscard]]
+    std::optional<std::string> Find(std::string_view key) const;
+
+  private:
+    void Load(std::stop_token stop_token, const LoadT& load);
+
+    void Finish();
+
+    [[nodiscard]]
+    std::shared_ptr<const MappedTable> Table() const;
+
+    mutable std::shared_mutex table_mutex_;
+    std::shared_ptr<const MappedTable> table_;
+    std::atomic<bool> loaded_ = true;
+    std::mutex mutex_;
+    std::condition_variable loaded_cv_;
+    std::jthread thread_;
+};
+
+} // namespace utils
@@ -0,0 +1,187 @@
+#include "multistatus.h"
+
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+
+namespace utils::webdav
+{
+
+void xml_escape(std::string& out, std::string_view str)
+{
+    for (const char c : str)
+    {
+        switch (c)
+        {
+        case '&':
+            out += "&amp;";
+            break;
+        case '<':
+            out += "&lt;";
+            break;
+        case '>':
+            out += "&gt;";
+            break;
+        case '"':
+            out += "&quot;";
+            break;
+        case '\'':
+            out += "&apos;";
+            break;
+        default:
+            out += c;
+        }
+    }
+}
+
+MultistatusWriter::MultistatusWriter(cinatra::coro_http_connection* conn, size_t buffer_size)
+    : conn_(conn), buffer_(utils::BufferPool::GetInstance().Acquire(buffer_size))
+{
+}
+
+async_simple::coro::Lazy<bool> MultistatusWriter::Begin(const utils::http::HeaderListT& headers)
+{
+    utils::http::HeaderListT all_headers{
+        {"Content-Type", "application/xml; charset=utf-8"},
+        {"Transfer-Encoding", "chunked"},
+    };
+    all_headers.insert(all_headers.end(), headers.begin(), headers.end());
+
+    if (!(co_await conn_->write_data(utils::http::build_response_head(207, all_headers))))
+    {
+        failed_ = true;
+        co_return false;
+    }
+
+    co_return co_await Append(R"(<?xml version="1.0" encoding="utf-8"?><D:multistatus xmlns:D="DAV:" xmlns:CS="http://calendarserver.org/ns/">)");
+}
+
+async_simple::coro::Lazy<bool> MultistatusWriter::Write(const ResourceInfo& info)
+{
+    if (failed_)
+    {
+        co_return false;
+    }
+
+    response_.clear();
+    response_ += "<D:response><D:href>";
+    xml_escape(response_, info.href);
+    response_ += "</D:href><D:propstat><D:prop>";
+
+    if (info.is_directory)
+    {
+        response_ += "<D:resourcetype><D:collection/></D:resourcetype>";
+    }
+    else
+    {
+        response_ += "<D:resourcetype/>";
+        response_ += std::format("<D:getcontentlength>{}</D:getcontentlength>", info.size);
+    }
+    response_ += std::format("<D:getlastmodified>{}</D:getlastmodified>", utils::http::format_http_date(info.last_modified));
+    if (!info.etag.empty())
+    {
+        response_ += "<D:getetag>";
+        xml_escape(response_, info.etag);
+        response_ += "</D:getetag>";
+
+        // the collection tag sync clients poll, it changes with anything below the collection just like the etag
+        if (info.is_directory)
+        {
+            response_ += "<CS:getctag>";
+            xml_escape(response_, info.etag);
+            response_ += "</CS:getctag>";
+        }
+    }
+
+    response_ += "</D:prop><D:status>HTTP/1.1 200 OK</D:status></D:propstat></D:response>";
+
+    co_return co_await Append(response_);
+}
+
+async_simple::coro::Lazy<bool> MultistatusWriter::WriteStatus(std::string_view href, std::string_view status)
+{
+    if (failed_)
+    {
+        co_return false;
+    }
+
+    response_.clear();
+    response_ += "<D:response><D:href>";
+    xml_escape(response_, href);
+    response_ += std::format("</D:href><D:status>HTTP/1.1 {}</D:status></D:response>", status);
+
+    co_return co_await Append(response_);
+}
+
+async_simple::coro::Lazy<bool> MultistatusWriter::End(std::string_view sync_token)
+{
+    if (failed_)
+    {
+        co_return false;
+    }
+
+    if (!sync_token.empty())
+    {
+        response_.clear();
+        response_ += "<D:sync-token>";
+        xml_escape(response_, sync_token);
+        response_ += "</D:sync-token>";
+        if (!(co_await Append(response_)))
+        {
+            co_return false;
+        }
+    }
+
+    if (!(co_await Append("</D:multistatus>")) || !(co_await Flush()))
+    {
+        co_return false;
+    }
+
+    co_return co_await utils::http::end_chunks(conn_);
+}
+
+bool MultistatusWriter::Failed() const noexcept
+{
+    return failed_;
+}
+
+async_simple::coro::Lazy<bool> MultistatusWriter::Append(std::string_view data)
+{
+    if (used_ + data.size() > buffer_.size())
+    {
+        if (!(co_await Flush()))
+        {
+            co_return false;
+        }
+
+        // larger than the whole buffer (a very long href), goes out as a chunk of its own
+        if (data.size() > buffer_.size())
+        {
+            if (!(co_await utils::http::write_chunk(conn_, data)))
+            {
+                failed_ = true;
+                co_return false;
+            }
+            co_return true;
+        }
+    }
+
+    std::memcpy(buffer_.data() + used_, data.data(), data.size());
+    used_ += data.size();
+    co_return true;
+}
+
+async_simple::coro::Lazy<bool> MultistatusWriter::Flush()
+{
+    if (!(co_await utils::http::write_chunk(conn_, {buffer_.data(), used_})))
+    {
+        failed_ = true;
+        co_return false;
+    }
+
+    used_ = 0;
+    co_return true;
+}
+
+} // namespace utils::webdav
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#include <async_simple/coro/Lazy.h>
+#include <cinatra/coro_http_connection.hpp>
+
+#include "utils/buffer_pool.h"
+#include "utils/http.h"
+
+namespace utils::webdav
+{
+
+// what a <D:response> element says about one resource
+struct ResourceInfo
+{
+    std::string href;
+    bool is_directory = false;
+    uint64_t size = 0;
+    std::time_t last_modified = 0;
+    std::string etag;
+};
+
+// capacity of the buffer a multistatus response is serialized into before it goes out as one chunk
+constexpr size_t MULTISTATUS_BUFFER_SIZE = 64 * 1024;
+
+/*
+    Streams a 207 multistatus document with chunked transfer encoding. Responses are serialized into a pooled buffer
+    of fixed capacity which is flushed as one chunk whenever the next response does not fit anymore, so memory use
+    does not depend on how many resources are listed.
+
+    MultistatusWriter writer{conn, MULTISTATUS_BUFFER_SIZE};
+    co_await writer.Begin({{"Allow", "..."}});
+    co_await writer.Write(info);
+    co_await writer.End();
+ */
+class MultistatusWriter
+{
+  public:
+    MultistatusWriter(cinatra::coro_http_connection* conn, size_t buffer_size);
+
+    // writes the response head and the opening <D:multistatus> element
+    async_simple::coro::Lazy<bool> Begin(const utils::http::HeaderListT& headers = {});
+
+    async_simple::coro::Lazy<bool> Write(const ResourceInfo& info);
+
+    // a <D:response> with a status instead of properties, e.g. "404 Not Found" for a member that was removed
+    async_simple::coro::Lazy<bool> WriteStatus(std::string_view href, std::string_view status);
+
+    // closes the document (after the <D:sync-token> of a sync-collection report, when there is one) and the chunked body
+    async_simple::coro::Lazy<bool> End(std::string_view sync_token = {});
+
+    [[nodiscard]]
+    bool Failed() const noexcept;
+
+  private:
+    // copies data into the buffer, flushing first when it does not fit
+    async_simple::coro::Lazy<bool> Append(std::string_view data);
+
+    async_simple::coro::Lazy<bool> Flush();
+
+    cinatra::coro_http_connection* conn_;
+    utils::BufferPool::Buffer buffer_;
+    size_t used_ = 0;
+
+    // one <D:response> element, kept to reuse its capacity
+    std::string response_;
+    bool failed_ = false;
+};
+
+// appends str to out with &, <, >, " and ' replaced by entities
+void xml_escape(std::string& out, std::string_view str);
+
+} // namespace utils::webdav
@@ -12,6 +12,17 @@ std::string to_string(const std::filesystem::path& path) noexcept
     return std::string{u8str.begin(), u8str.end()};
 }
 
+std::string to_key(const std::filesystem::path& path) noexcept
+{
+    std::string key = to_string(path.lexically_normal());
+    while (key.size() > 1 && (key.back() == '/' || key.back() == '\\'))
+    {
+        key.pop_back();
+    }
+
+    return key;
+}
+
 std::string with_separator(const std::filesystem::path& path, const bool is_dir, const char separator, uint16_t skip) noexcept
 {
 
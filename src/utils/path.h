@@ -11,6 +11,10 @@ namespace utils::path
 [[nodiscard, maybe_unused]]
 std::string to_string(const std::filesystem::path& path) noexcept;
 
+// lexically normalized and without a trailing separator, the same directory always gives the same key
+[[nodiscard, maybe_unused]]
+std::string to_key(const std::filesystem::path& path) noexcept;
+
 /*
     with_separator("\\a\\b\\c", true, '/') -> "a/b/c/"
     with_separator("\\a\\b\\c", false, '/') -> "a/b/c"
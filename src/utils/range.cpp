@@ -0,0 +1,195 @@
+#include "range.h"
+
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils::range
+{
+
+static std::string_view trim_view(std::string_view str)
+{
+    const size_t start = str.find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+    {
+        return {};
+    }
+    const size_t end = str.find_last_not_of(" \t");
+    return str.substr(start, end - start + 1);
+}
+
+static std::optional<uint64_t> parse_number(std::string_view str)
+{
+    if (str.empty())
+    {
+        return std::nullopt;
+    }
+
+    uint64_t value = 0;
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc{} || ptr != str.data() + str.size())
+    {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+std::optional<std::vector<ByteRange>> parse_range(std::string_view header, const uint64_t file_size)
+{
+    header = trim_view(header);
+    if (!header.starts_with("bytes="))
+    {
+        return std::nullopt;
+    }
+    header.remove_prefix(6);
+
+    std::vector<ByteRange> ranges;
+    size_t spec_count = 0;
+    while (!header.empty())
+    {
+        const size_t comma = header.find(',');
+        const std::string_view spec = trim_view(header.substr(0, comma));
+        header = comma == std::string_view::npos ? std::string_view{} : header.substr(comma + 1);
+        if (spec.empty())
+        {
+            continue;
+        }
+
+        if (++spec_count > MAX_RANGES)
+        {
+            return std::nullopt;
+        }
+
+        const size_t dash = spec.find('-');
+        if (dash == std::string_view::npos)
+        {
+            return std::nullopt;
+        }
+
+        const std::string_view first_str = trim_view(spec.substr(0, dash));
+        const std::string_view last_str = trim_view(spec.substr(dash + 1));
+
+        // suffix range: bytes=-N
+        if (first_str.empty())
+        {
+            const auto suffix = parse_number(last_str);
+            if (!suffix.has_value())
+            {
+                return std::nullopt;
+            }
+            if (*suffix == 0 || file_size == 0)
+            {
+                continue;
+            }
+            ranges.push_back({file_size - std::min(*suffix, file_size), file_size - 1});
+            continue;
+        }
+
+        const auto first = parse_number(first_str);
+        if (!first.has_value())
+        {
+            return std::nullopt;
+        }
+
+        uint64_t last = file_size == 0 ? 0 : file_size - 1;
+        if (!last_str.empty())
+        {
+            const auto parsed_last = parse_number(last_str);
+            if (!parsed_last.has_value() || *parsed_last < *first)
+            {
+                return std::nullopt;
+            }
+            last = std::min(last, *parsed_last);
+        }
+
+        // unsatisfiable, but the others may still be
+        if (*first >= file_size)
+        {
+            continue;
+        }
+
+        ranges.push_back({*first, last});
+    }
+
+    if (spec_count == 0)
+    {
+        return std::nullopt;
+    }
+
+    // merge overlapping and adjacent ranges, a client asking for the same bytes twice gets them once
+    if (ranges.size() > 1)
+    {
+        std::sort(ranges.begin(), ranges.end(), [](const ByteRange& a, const ByteRange& b) { return a.first < b.first; });
+
+        std::vector<ByteRange> merged{ranges.front()};
+        for (size_t i = 1; i < ranges.size(); ++i)
+        {
+            ByteRange& back = merged.back();
+            if (ranges[i].first <= back.last + 1)
+            {
+                back.last = std::max(back.last, ranges[i].last);
+            }
+            else
+            {
+                merged.push_back(ranges[i]);
+            }
+        }
+        ranges = std::move(merged);
+    }
+
+    return ranges;
+}
+
+std::optional<std::time_t> parse_http_date(const std::string& date)
+{
+    std::tm tm{};
+    std::istringstream iss{date};
+    iss.imbue(std::locale::classic());
+    iss >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S GMT");
+    if (iss.fail())
+    {
+        return std::nullopt;
+    }
+
+#ifdef _WIN32
+    return _mkgmtime(&tm);
+#else
+    return timegm(&tm);
+#endif
+}
+
+bool if_range_matches(std::string_view if_range, std::string_view etag, const std::time_t last_modified)
+{
+    if_range = trim_view(if_range);
+    if (if_range.empty())
+    {
+        return true;
+    }
+
+    if (if_range.starts_with("W/"))
+    {
+        return false;
+    }
+
+    // our etags are sent unquoted, but clients may quote them anyway
+    if (if_range.size() >= 2 && if_range.front() == '"' && if_range.back() == '"')
+    {
+        return if_range.substr(1, if_range.size() - 2) == etag;
+    }
+
+    if (if_range == etag)
+    {
+        return true;
+    }
+
+    const auto date = parse_http_date(std::string{if_range});
+    return date.has_value() && *date == last_modified;
+}
+
+} // namespace utils::range
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils::range
+{
+
+// an inclusive byte range, bytes=0-499 -> {0, 499}
+struct ByteRange
+{
+    uint64_t first = 0;
+    uint64_t last = 0;
+
+    [[nodiscard]]
+    uint64_t length() const noexcept
+    {
+        return last - first + 1;
+    }
+
+    bool operator==(const ByteRange&) const = default;
+};
+
+// more ranges than this in one request are treated as if no Range header was sent
+constexpr size_t MAX_RANGES = 32;
+
+/*
+    Parses a Range header against a file of file_size bytes (RFC 7233).
+    std::nullopt     -> the header is malformed or not in bytes, serve the whole file
+    empty vector     -> none of the ranges is satisfiable, respond 416
+    otherwise        -> the satisfiable ranges, clamped to the file and with overlapping ones merged
+
+    parse_range("bytes=0-99", 1000)        -> {{0, 99}}
+    parse_range("bytes=-100", 1000)        -> {{900, 999}}
+    parse_range("bytes=900-", 1000)        -> {{900, 999}}
+    parse_range("bytes=0-9,5-19", 1000)    -> {{0, 19}}
+    parse_range("bytes=2000-", 1000)       -> {}
+ */
+[[nodiscard]]
+std::optional<std::vector<ByteRange>> parse_range(std::string_view header, uint64_t file_size);
+
+/*
+    If-Range holds either an entity tag or an HTTP date, the range request is only honoured when it still
+    describes the current representation. Weak entity tags never match.
+ */
+[[nodiscard]]
+bool if_range_matches(std::string_view if_range, std::string_view etag, std::time_t last_modified);
+
+// "Sun, 06 Nov 1994 08:49:37 GMT" -> time_t
+[[nodiscard]]
+std::optional<std::time_t> parse_http_date(const std::string& date);
+
+} // namespace utils::range
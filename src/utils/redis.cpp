@@ -1,55 +1,190 @@
 #include "redis.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
 #include <hiredis/hiredis.h>
 
-#include <format>
-#include <stdexcept>
+#include "ConfigManager.h"
 
 namespace utils::redis
 {
 
-RedisContextT GetRedisContext(const std::string& host, int port) noexcept(false)
+Connection::Connection(const std::string& host, const int port, const std::string& user, const std::string& password) noexcept(false)
+    : ctx_(redisConnect(host.data(), port), &redisFree)
 {
-    redisContext* ptr = redisConnect(host.data(), port);
-    if (!ptr || ptr->err)
+    if (!ctx_ || ctx_->err)
     {
         throw std::runtime_error("Redis connection error.");
     }
 
-    return {ptr, &redisFree};
+    if (password.empty())
+    {
+        return;
+    }
+
+    const RedisReplyT repl = user.empty() ? Execute({"AUTH", password}) : Execute({"AUTH", user, password});
+    if (!repl || repl->type != REDIS_REPLY_STATUS || reply_str(repl.get()) != "OK")
+    {
+        throw std::runtime_error("Auth failed.");
+    }
 }
 
-auto RedisExecute(redisContext* ctx, const std::string& command) noexcept -> RedisReplyT
+static void to_argv(const CommandT& command, std::vector<const char*>& argv, std::vector<size_t>& argv_len)
 {
-    RedisReplyT repl{static_cast<redisReply*>(redisCommand(ctx, command.data())), &freeReplyObject};
-    if (ctx->err)
+    argv.clear();
+    argv_len.clear();
+    for (const std::string_view arg : command)
     {
-        repl.reset();
+        argv.push_back(arg.data());
+        argv_len.push_back(arg.size());
     }
+}
 
-    if (!repl)
+static RedisReplyT take_reply(void* reply)
+{
+    RedisReplyT repl{static_cast<redisReply*>(reply), &freeReplyObject};
+    if (repl && repl->type == REDIS_REPLY_NIL)
     {
         repl.reset();
     }
 
-    if (repl->type == REDIS_REPLY_NIL)
+    return repl;
+}
+
+RedisReplyT Connection::Execute(const CommandT& command) noexcept
+{
+    std::vector<const char*> argv;
+    std::vector<size_t> argv_len;
+    to_argv(command, argv, argv_len);
+
+    RedisReplyT repl = take_reply(redisCommandArgv(ctx_.get(), static_cast<int>(argv.size()), argv.data(), argv_len.data()));
+    if (ctx_->err)
     {
         repl.reset();
     }
 
-    return std::move(repl);
+    return repl;
+}
+
+std::vector<RedisReplyT> Connection::Pipeline(const std::vector<CommandT>& commands) noexcept
+{
+    std::vector<RedisReplyT> replies;
+    replies.reserve(commands.size());
+
+    // appending only fills hiredis' output buffer, it is written out by the first redisGetReply
+    std::vector<const char*> argv;
+    std::vector<size_t> argv_len;
+    size_t appended = 0;
+    for (const auto& command : commands)
+    {
+        to_argv(command, argv, argv_len);
+        if (redisAppendCommandArgv(ctx_.get(), static_cast<int>(argv.size()), argv.data(), argv_len.data()) != REDIS_OK)
+        {
+            break;
+        }
+        ++appended;
+    }
+
+    for (size_t i = 0; i < appended && !ctx_->err; ++i)
+    {
+        void* reply = nullptr;
+        if (redisGetReply(ctx_.get(), &reply) != REDIS_OK)
+        {
+            break;
+        }
+        replies.push_back(take_reply(reply));
+    }
+
+    // commands that got no reply answer nil
+    while (replies.size() < commands.size())
+    {
+        replies.emplace_back(nullptr, &freeReplyObject);
+    }
+
+    return replies;
+}
+
+bool Connection::IsBroken() const noexcept
+{
+    return ctx_->err != 0;
+}
+
+Pool& Pool::GetInstance()
+{
+    const auto& conf = ConfigManager::GetInstance();
+    static Pool instance{conf.GetRedisHost(), conf.GetRedisPort(), conf.GetRedisUserName(), conf.GetRedisPassword(),
+                         conf.GetHttpBlockingThreads() + conf.GetWebDavTraversalThreads()};
+    return instance;
+}
+
+Pool::Pool(std::string host, const int port, std::string user, std::string password, const size_t max_connections)
+    : host_(std::move(host)), port_(port), user_(std::move(user)), password_(std::move(password)), max_connections_(std::max<size_t>(max_connections, 1))
+{
+}
+
+Pool::Lease Pool::Acquire() noexcept(false)
+{
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this]() { return !idle_.empty() || connections_ < max_connections_; });
+
+    if (!idle_.empty())
+    {
+        std::unique_ptr<Connection> connection = std::move(idle_.back());
+        idle_.pop_back();
+        return {*this, std::move(connection)};
+    }
+
+    // connected outside of the lock, the slot is taken first so that the pool never grows past max_connections_
+    ++connections_;
+    lock.unlock();
+    try
+    {
+        return {*this, std::make_unique<Connection>(host_, port_, user_, password_)};
+    }
+    catch (...)
+    {
+        lock.lock();
+        --connections_;
+        cv_.notify_one();
+        throw;
+    }
+}
+
+void Pool::Release(std::unique_ptr<Connection> connection) noexcept
+{
+    {
+        std::lock_guard lock{mutex_};
+        if (connection->IsBroken())
+        {
+            --connections_;
+        }
+        else
+        {
+            idle_.push_back(std::move(connection));
+        }
+    }
+    cv_.notify_one();
+}
+
+Pool::Lease::Lease(Pool& pool, std::unique_ptr<Connection> connection) noexcept : pool_(pool), connection_(std::move(connection))
+{
+}
+
+Pool::Lease::~Lease()
+{
+    pool_.Release(std::move(connection_));
 }
 
-bool RedisAuth(redisContext* ctx, const std::string& user, const std::string& password) noexcept
+std::string_view reply_str(const redisReply* reply) noexcept
 {
-    const std::string auth_str = std::format("AUTH {} {}", user, password);
-    const RedisReplyT repl = RedisExecute(ctx, auth_str);
-    if (!repl)
+    if (reply == nullptr || reply->str == nullptr || (reply->type != REDIS_REPLY_STRING && reply->type != REDIS_REPLY_STATUS))
     {
-        return false;
+        return {};
     }
 
-    return std::strcmp(repl->str, "OK") == 0;
+    return {reply->str, reply->len};
 }
 
 } // namespace utils::redis
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <condition_variable>
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <hiredis/hiredis.h>
 
@@ -11,12 +16,80 @@ namespace utils::redis
 using RedisContextT = std::unique_ptr<redisContext, decltype(&redisFree)>;
 using RedisReplyT = std::unique_ptr<redisReply, decltype(&freeReplyObject)>;
 
-[[nodiscard]]
-RedisContextT GetRedisContext(const std::string& host, int port) noexcept(false);
+// a command as its arguments, each sent as is (binary safe, no quoting or escaping involved)
+using CommandT = std::vector<std::string_view>;
 
-[[nodiscard]]
-RedisReplyT RedisExecute(redisContext* ctx, const std::string& command) noexcept;
+// one connection, errors on the socket leave it broken and the pool drops it
+class Connection
+{
+  public:
+    Connection(const std::string& host, int port, const std::string& user, const std::string& password) noexcept(false);
+
+    // the reply, nullptr for a nil reply or when the connection failed
+    [[nodiscard]]
+    RedisReplyT Execute(const CommandT& command) noexcept;
+
+    // sends all the commands before reading the first reply, the replies come back in the same order
+    [[nodiscard]]
+    std::vector<RedisReplyT> Pipeline(const std::vector<CommandT>& commands) noexcept;
+
+    [[nodiscard]]
+    bool IsBroken() const noexcept;
+
+  private:
+    RedisContextT ctx_;
+};
+
+/*
+    Connections shared by the Redis engines, created on demand up to one per thread that calls into them (the
+    blocking pool and the traversal pool). A connection is leased for one call or one pipeline and handed back.
+ */
+class Pool
+{
+  public:
+    class Lease
+    {
+      public:
+        Lease(Pool& pool, std::unique_ptr<Connection> connection) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
 
-bool RedisAuth(redisContext* ctx, const std::string& user, const std::string& password) noexcept;
+        Connection* operator->() const noexcept
+        {
+            return connection_.get();
+        }
+
+      private:
+        Pool& pool_;
+        std::unique_ptr<Connection> connection_;
+    };
+
+    static Pool& GetInstance();
+
+    Pool(std::string host, int port, std::string user, std::string password, size_t max_connections);
+
+    [[nodiscard]]
+    Lease Acquire() noexcept(false);
+
+  private:
+    void Release(std::unique_ptr<Connection> connection) noexcept;
+
+    std::string host_;
+    int port_;
+    std::string user_;
+    std::string password_;
+    size_t max_connections_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<Connection>> idle_;
+    size_t connections_ = 0;
+};
+
+// the string of a reply, empty for a nil reply or anything else that is not a string
+[[nodiscard]]
+std::string_view reply_str(const redisReply* reply) noexcept;
 
 } // namespace utils::redis
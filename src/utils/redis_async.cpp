@@ -0,0 +1,302 @@
+#include "redis_async.h"
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <asio/steady_timer.hpp>
+#include <async_simple/Executor.h>
+#include <async_simple/Try.h>
+#include <cinatra/coro_http_connection.hpp>
+
+#include "ConfigManager.h"
+
+namespace utils::redis
+{
+
+// what one read asks the socket for, a reply larger than this is read in several
+static constexpr size_t READ_CHUNK_SIZE = 16 * 1024;
+
+// a Redis that has not answered by then is taken for gone, the connection is dropped and the command fails
+static constexpr std::chrono::seconds REPLY_TIMEOUT{5};
+
+struct AsyncClient::Endpoints
+{
+    asio::ip::tcp::resolver::results_type results;
+};
+
+struct AsyncClient::Connection : std::enable_shared_from_this<Connection>
+{
+    explicit Connection(const asio::any_io_executor& executor) : socket(executor), timer(executor)
+    {
+    }
+
+    // cancels what the socket waits for once REPLY_TIMEOUT passed, the aborted read then fails the command. Called on
+    // the socket's executor, where the handler runs too.
+    void ArmDeadline()
+    {
+        deadline = std::chrono::steady_clock::now() + REPLY_TIMEOUT;
+        timer.expires_at(deadline);
+        timer.async_wait([weak = weak_from_this()](const asio::error_code& ec) {
+            // a wait that expired right before the command completed must not cancel the next one
+            if (const auto self = weak.lock(); !ec && self != nullptr && self->Expired())
+            {
+                asio::error_code cancel_ec;
+                self->socket.cancel(cancel_ec);
+            }
+        });
+    }
+
+    void DisarmDeadline()
+    {
+        deadline = std::chrono::steady_clock::time_point::max();
+        timer.cancel();
+    }
+
+    bool Expired() const noexcept
+    {
+        return std::chrono::steady_clock::now() >= deadline;
+    }
+
+    std::runtime_error Error(const std::error_code& ec) const
+    {
+        return std::runtime_error(Expired() ? "Redis connection error: no reply in time" : "Redis connection error: " + ec.message());
+    }
+
+    asio::ip::tcp::socket socket;
+    asio::steady_timer timer;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+    // bytes read past the last parsed reply
+    std::string buffer;
+};
+
+/*
+    Runs a Send and resumes the awaiting coroutine on the executor (I/O thread) it was suspended on. The socket I/O
+    completes on the global executor's threads, the caller's connection and response must not be touched from there.
+ */
+class SendAwaiter
+{
+  public:
+    explicit SendAwaiter(async_simple::coro::Lazy<std::vector<resp::Reply>> send) : send_(std::move(send))
+    {
+    }
+
+    SendAwaiter coAwait(async_simple::Executor* executor) &&
+    {
+        executor_ = executor;
+        return std::move(*this);
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        async_simple::Executor::Context context = executor_ != nullptr ? executor_->checkout() : async_simple::Executor::NULLCTX;
+        std::move(send_).start([this, handle, context](async_simple::Try<std::vector<resp::Reply>> result) {
+            result_ = std::move(result);
+            if (executor_ == nullptr)
+            {
+                handle.resume();
+                return;
+            }
+            executor_->checkin([handle]() { handle.resume(); }, context);
+        });
+    }
+
+    async_simple::Try<std::vector<resp::Reply>> await_resume()
+    {
+        return std::move(result_);
+    }
+
+  private:
+    async_simple::coro::Lazy<std::vector<resp::Reply>> send_;
+    async_simple::Executor* executor_ = nullptr;
+    async_simple::Try<std::vector<resp::Reply>> result_;
+};
+
+AsyncClient& AsyncClient::GetInstance()
+{
+    const auto& conf = ConfigManager::GetInstance();
+    static AsyncClient instance{conf.GetRedisHost(), conf.GetRedisPort(), conf.GetRedisUserName(), conf.GetRedisPassword(),
+                                conf.GetHttpBlockingThreads() + conf.GetWebDavTraversalThreads()};
+    return instance;
+}
+
+AsyncClient::AsyncClient(const std::string& host, const int port, std::string user, std::string password, const size_t max_idle) noexcept(false)
+    : endpoints_(std::make_unique<Endpoints>()), user_(std::move(user)), password_(std::move(password)), max_idle_(max_idle)
+{
+    // resolved once, at startup
+    asio::ip::tcp::resolver resolver{coro_io::get_global_executor()->get_asio_executor()};
+    endpoints_->results = resolver.resolve(host, std::to_string(port));
+}
+
+AsyncClient::~AsyncClient() = default;
+
+async_simple::coro::Lazy<resp::Reply> AsyncClient::Execute(const std::vector<std::string_view>& command)
+{
+    std::string payload;
+    resp::encode(payload, command);
+
+    return [](AsyncClient& client, std::string payload) -> async_simple::coro::Lazy<resp::Reply> {
+        async_simple::Try<std::vector<resp::Reply>> replies = co_await SendAwaiter{client.Send(std::move(payload), 1)};
+        co_return std::move(std::move(replies).value().front());
+    }(*this, std::move(payload));
+}
+
+async_simple::coro::Lazy<std::vector<resp::Reply>> AsyncClient::Pipeline(const std::vector<std::vector<std::string_view>>& commands)
+{
+    std::string payload;
+    for (const auto& command : commands)
+    {
+        resp::encode(payload, command);
+    }
+
+    return [](AsyncClient& client, std::string payload, const size_t reply_count) -> async_simple::coro::Lazy<std::vector<resp::Reply>> {
+        async_simple::Try<std::vector<resp::Reply>> replies = co_await SendAwaiter{client.Send(std::move(payload), reply_count)};
+        co_return std::move(replies).value();
+    }(*this, std::move(payload), commands.size());
+}
+
+async_simple::coro::Lazy<std::vector<resp::Reply>> AsyncClient::Send(std::string payload, const size_t reply_count)
+{
+    std::shared_ptr<Connection> connection;
+    {
+        std::lock_guard lock{mutex_};
+        if (!idle_.empty())
+        {
+            connection = std::move(idle_.back());
+            idle_.pop_back();
+        }
+    }
+    if (connection == nullptr)
+    {
+        connection = co_await Connect();
+    }
+
+    // a connection that failed half way through has replies of somebody else's commands in flight, it is not reused
+    if (const auto [ec, size] = co_await coro_io::async_write(connection->socket, asio::buffer(payload)); ec)
+    {
+        throw std::runtime_error("Redis connection error: " + ec.message());
+    }
+
+    // on the socket's executor from here on, the write went to the kernel's buffer, the replies are what may stall
+    connection->ArmDeadline();
+
+    std::vector<resp::Reply> replies;
+    replies.reserve(reply_count);
+    std::string_view pending = connection->buffer;
+    char chunk[READ_CHUNK_SIZE];
+    while (true)
+    {
+        while (replies.size() < reply_count)
+        {
+            auto reply = resp::parse(pending);
+            if (!reply.has_value())
+            {
+                break;
+            }
+            replies.push_back(std::move(*reply));
+        }
+        if (replies.size() == reply_count)
+        {
+            break;
+        }
+
+        // keeps the unparsed tail only, then appends what the socket has
+        connection->buffer.erase(0, connection->buffer.size() - pending.size());
+        const auto [ec, size] = co_await coro_io::async_read_some(connection->socket, asio::buffer(chunk, sizeof(chunk)));
+        if (ec)
+        {
+            throw connection->Error(ec);
+        }
+        connection->buffer.append(chunk, size);
+        pending = connection->buffer;
+    }
+    connection->buffer.erase(0, connection->buffer.size() - pending.size());
+    connection->DisarmDeadline();
+
+    Release(std::move(connection));
+    co_return replies;
+}
+
+async_simple::coro::Lazy<std::shared_ptr<AsyncClient::Connection>> AsyncClient::Connect()
+{
+    auto connection = std::make_shared<Connection>(coro_io::get_global_executor()->get_asio_executor());
+
+    // nothing else uses the new connection yet, the deadline covers connecting and the AUTH reply
+    connection->ArmDeadline();
+
+    std::error_code ec = asio::error::host_not_found;
+    for (const auto& entry : endpoints_->results)
+    {
+        asio::error_code close_ec;
+        connection->socket.close(close_ec);
+        ec = co_await coro_io::async_io<std::error_code>(
+            [&connection, &entry](auto&& cb) { connection->socket.async_connect(entry.endpoint(), std::move(cb)); }, connection->socket);
+        if (!ec)
+        {
+            break;
+        }
+    }
+    if (ec)
+    {
+        throw connection->Error(ec);
+    }
+
+    asio::error_code option_ec;
+    connection->socket.set_option(asio::ip::tcp::no_delay{true}, option_ec);
+
+    if (!password_.empty())
+    {
+        std::string payload;
+        resp::encode(payload,
+                     user_.empty() ? std::vector<std::string_view>{"AUTH", password_} : std::vector<std::string_view>{"AUTH", user_, password_});
+        if (const auto [write_ec, size] = co_await coro_io::async_write(connection->socket, asio::buffer(payload)); write_ec)
+        {
+            throw std::runtime_error("Redis connection error: " + write_ec.message());
+        }
+
+        char chunk[256];
+        while (true)
+        {
+            std::string_view pending = connection->buffer;
+            if (const auto reply = resp::parse(pending); reply.has_value())
+            {
+                if (reply->type != resp::Reply::Type::Status)
+                {
+                    throw std::runtime_error("Auth failed.");
+                }
+                connection->buffer.erase(0, connection->buffer.size() - pending.size());
+                break;
+            }
+
+            const auto [read_ec, size] = co_await coro_io::async_read_some(connection->socket, asio::buffer(chunk, sizeof(chunk)));
+            if (read_ec)
+            {
+                throw connection->Error(read_ec);
+            }
+            connection->buffer.append(chunk, size);
+        }
+    }
+
+    connection->DisarmDeadline();
+    co_return connection;
+}
+
+void AsyncClient::Release(std::shared_ptr<Connection> connection) noexcept
+{
+    std::lock_guard lock{mutex_};
+    if (idle_.size() < max_idle_)
+    {
+        idle_.push_back(std::move(connection));
+    }
+}
+
+} // namespace utils::redis
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <async_simple/coro/Lazy.h>
+
+#include "resp.h"
+
+namespace utils::redis
+{
+
+/*
+    Redis client for coroutines, the commands are written and the replies read on asio sockets so an I/O thread
+    waiting on Redis goes on serving other connections. A connection is taken from the idle list for one command (or
+    one pipeline) and handed back afterwards, a new one is opened when none is idle, at most max_idle are kept.
+ */
+class AsyncClient
+{
+  public:
+    static AsyncClient& GetInstance();
+
+    AsyncClient(const std::string& host, int port, std::string user, std::string password, size_t max_idle) noexcept(false);
+    ~AsyncClient();
+
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+
+    // throws std::runtime_error when Redis can not be reached, an error reply is returned as such
+    async_simple::coro::Lazy<resp::Reply> Execute(const std::vector<std::string_view>& command);
+
+    // the replies in the order of commands, all commands are written before the first reply is read
+    async_simple::coro::Lazy<std::vector<resp::Reply>> Pipeline(const std::vector<std::vector<std::string_view>>& commands);
+
+  private:
+    // shared, the deadline's timer handler holds on to it weakly
+    struct Connection;
+
+    // the encoded commands are owned by the coroutine, the caller's arguments may be gone once it suspends
+    async_simple::coro::Lazy<std::vector<resp::Reply>> Send(std::string payload, size_t reply_count);
+
+    async_simple::coro::Lazy<std::shared_ptr<Connection>> Connect();
+
+    void Release(std::shared_ptr<Connection> connection) noexcept;
+
+    struct Endpoints;
+    std::unique_ptr<Endpoints> endpoints_;
+    std::string user_;
+    std::string password_;
+    size_t max_idle_;
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Connection>> idle_;
+};
+
+} // namespace utils::redis
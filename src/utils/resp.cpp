@@ -0,0 +1,137 @@
+#include "resp.h"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace utils::resp
+{
+
+static void append_length(std::string& out, const char type, const size_t length)
+{
+    out += type;
+    out += std::to_string(length);
+    out += "\r\n";
+}
+
+void encode(std::string& out, const std::vector<std::string_view>& command)
+{
+    append_length(out, '*', command.size());
+    for (const std::string_view arg : command)
+    {
+        append_length(out, '$', arg.size());
+        out += arg;
+        out += "\r\n";
+    }
+}
+
+// the line after the type byte, nullopt when the CRLF has not arrived yet
+static std::optional<std::string_view> read_line(std::string_view& buffer)
+{
+    const size_t end = buffer.find("\r\n", 1);
+    if (end == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+
+    const std::string_view line = buffer.substr(1, end - 1);
+    buffer.remove_prefix(end + 2);
+    return line;
+}
+
+static int64_t to_integer(const std::string_view line)
+{
+    int64_t value = 0;
+    if (const auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), value); ec != std::errc{} || ptr != line.data() + line.size())
+    {
+        throw std::runtime_error("Malformed RESP integer.");
+    }
+
+    return value;
+}
+
+static std::optional<Reply> parse_from(std::string_view& buffer)
+{
+    if (buffer.empty())
+    {
+        return std::nullopt;
+    }
+
+    const char type = buffer.front();
+    const auto line = read_line(buffer);
+    if (!line.has_value())
+    {
+        return std::nullopt;
+    }
+
+    Reply reply{};
+    switch (type)
+    {
+    case '+':
+        reply.type = Reply::Type::Status;
+        reply.str = *line;
+        return reply;
+    case '-':
+        reply.type = Reply::Type::Error;
+        reply.str = *line;
+        return reply;
+    case ':':
+        reply.type = Reply::Type::Integer;
+        reply.integer = to_integer(*line);
+        return reply;
+    case '$': {
+        const int64_t length = to_integer(*line);
+        if (length < 0)
+        {
+            return reply;
+        }
+        if (buffer.size() < static_cast<size_t>(length) + 2)
+        {
+            return std::nullopt;
+        }
+
+        reply.type = Reply::Type::String;
+        reply.str = buffer.substr(0, static_cast<size_t>(length));
+        buffer.remove_prefix(static_cast<size_t>(length) + 2);
+        return reply;
+    }
+    case '*': {
+        const int64_t count = to_integer(*line);
+        if (count < 0)
+        {
+            return reply;
+        }
+
+        reply.type = Reply::Type::Array;
+        reply.elements.reserve(static_cast<size_t>(std::min<int64_t>(count, 1024)));
+        for (int64_t i = 0; i < count; ++i)
+        {
+            auto element = parse_from(buffer);
+            if (!element.has_value())
+            {
+                return std::nullopt;
+            }
+            reply.elements.push_back(std::move(*element));
+        }
+        return reply;
+    }
+    default:
+        throw std::runtime_error("Malformed RESP reply.");
+    }
+}
+
+std::optional<Reply> parse(std::string_view& buffer) noexcept(false)
+{
+    // parsed on a copy, an incomplete reply must not consume anything
+    std::string_view rest = buffer;
+    auto reply = parse_from(rest);
+    if (reply.has_value())
+    {
+        buffer = rest;
+    }
+
+    return reply;
+}
+
+} // namespace utils::resp
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// RESP2, the protocol Redis speaks, see https://redis.io/docs/latest/develop/reference/protocol-spec/
+namespace utils::resp
+{
+
+struct Reply
+{
+    enum class Type
+    {
+        String,
+        Status,
+        Error,
+        Integer,
+        Nil,
+        Array,
+    };
+
+    Type type = Type::Nil;
+    std::string str;
+    int64_t integer = 0;
+    std::vector<Reply> elements;
+};
+
+// appends the command as an array of bulk strings, the arguments go out byte for byte
+void encode(std::string& out, const std::vector<std::string_view>& command);
+
+// Parses the reply at the front of buffer and advances buffer past it. Returns nullopt (leaving buffer alone) while
+// the reply is incomplete, throws std::runtime_error on something that is not RESP.
+[[nodiscard]]
+std::optional<Reply> parse(std::string_view& buffer) noexcept(false);
+
+} // namespace utils::resp
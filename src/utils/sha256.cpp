@@ -0,0 +1,285 @@
+#include "sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SHA256_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SHA256_NI_TARGET
+#else
+#include <cpuid.h>
+#define SHA256_NI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#endif
+#endif
+
+// the round loops only run fast fully unrolled, so that the message words stay in registers
+#if defined(__clang__)
+#define SHA256_UNROLL _Pragma("clang loop unroll(full)")
+#elif defined(__GNUC__)
+#define SHA256_UNROLL _Pragma("GCC unroll 64")
+#else
+#define SHA256_UNROLL
+#endif
+
+namespace utils
+{
+
+alignas(16) static constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+    0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+    0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+    0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+    0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static constexpr std::array<uint32_t, 8> INITIAL_STATE = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                                          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+static constexpr uint32_t rotr(const uint32_t x, const int n) noexcept
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static void compress_scalar(uint32_t* state, const uint8_t* blocks, size_t count)
+{
+    uint32_t w[64];
+    for (; count > 0; --count, blocks += Sha256::BLOCK_SIZE)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            const uint8_t* p = blocks + i * 4;
+            w[i] = (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | uint32_t{p[3]};
+        }
+        for (int i = 16; i < 64; ++i)
+        {
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+        SHA256_UNROLL
+        for (int i = 0; i < 64; ++i)
+        {
+            const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef SHA256_X86
+
+static bool cpu_has_sha_ni() noexcept
+{
+    // leaf 1: ssse3 (ecx bit 9) and sse4.1 (ecx bit 19), leaf 7: sha (ebx bit 29)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4]{};
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(regs, 1);
+    const unsigned ecx1 = static_cast<unsigned>(regs[2]);
+    __cpuidex(regs, 7, 0);
+    const unsigned ebx7 = static_cast<unsigned>(regs[1]);
+#else
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+    {
+        return false;
+    }
+    const unsigned ecx1 = ecx;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+    {
+        return false;
+    }
+    const unsigned ebx7 = ebx;
+#endif
+    return (ecx1 & (1u << 9)) != 0 && (ecx1 & (1u << 19)) != 0 && (ebx7 & (1u << 29)) != 0;
+}
+
+// the state is kept as the ABEF/CDGH halves sha256rnds2 works on, each 4-round group also extends the message schedule
+SHA256_NI_TARGET static void compress_sha_ni(uint32_t* state, const uint8_t* blocks, size_t count)
+{
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);  // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);                                                   // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);                                                        // CDGH
+
+    for (; count > 0; --count, blocks += Sha256::BLOCK_SIZE)
+    {
+        const __m128i abef = state0;
+        const __m128i cdgh = state1;
+
+        __m128i msg[4];
+        SHA256_UNROLL
+        for (int group = 0; group < 16; ++group)
+        {
+            __m128i& current = msg[group % 4];
+            if (group < 4)
+            {
+                current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + group * 16)), byte_swap);
+            }
+
+            __m128i words = _mm_add_epi32(current, _mm_load_si128(reinterpret_cast<const __m128i*>(K + group * 4)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, words);
+            if (group >= 3 && group <= 14)
+            {
+                __m128i& next = msg[(group + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(current, msg[(group + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, current);
+            }
+            words = _mm_shuffle_epi32(words, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, words);
+            if (group >= 1 && group <= 12)
+            {
+                __m128i& previous = msg[(group + 3) % 4];
+                previous = _mm_sha256msg1_epu32(previous, current);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);    // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(tmp, state1, 0xF0)); // DCBA
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(state1, tmp, 8)); // HGFE
+}
+
+#endif
+
+Sha256Backend sha256_backend() noexcept
+{
+#ifdef SHA256_X86
+    static const Sha256Backend backend = cpu_has_sha_ni() ? Sha256Backend::SHA_NI : Sha256Backend::SCALAR;
+    return backend;
+#else
+    return Sha256Backend::SCALAR;
+#endif
+}
+
+std::string_view to_string(const Sha256Backend backend) noexcept
+{
+    switch (backend)
+    {
+    case Sha256Backend::SHA_NI:
+        return "sha-ni";
+    default:
+        return "scalar";
+    }
+}
+
+Sha256::Sha256(const Sha256Backend backend) noexcept : compress_(compress_scalar), state_(INITIAL_STATE)
+{
+#ifdef SHA256_X86
+    if (backend == Sha256Backend::SHA_NI && sha256_backend() == Sha256Backend::SHA_NI)
+    {
+        compress_ = compress_sha_ni;
+    }
+#else
+    (void)backend;
+#endif
+}
+
+void Sha256::Update(std::string_view data) noexcept
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    size_t size = data.size();
+    length_ += size;
+
+    if (buffered_ > 0)
+    {
+        const size_t take = std::min(size, BLOCK_SIZE - buffered_);
+        std::memcpy(buffer_.data() + buffered_, bytes, take);
+        buffered_ += take;
+        bytes += take;
+        size -= take;
+        if (buffered_ < BLOCK_SIZE)
+        {
+            return;
+        }
+        compress_(state_.data(), buffer_.data(), 1);
+        buffered_ = 0;
+    }
+
+    if (const size_t blocks = size / BLOCK_SIZE; blocks > 0)
+    {
+        compress_(state_.data(), bytes, blocks);
+        bytes += blocks * BLOCK_SIZE;
+        size -= blocks * BLOCK_SIZE;
+    }
+
+    std::memcpy(buffer_.data(), bytes, size);
+    buffered_ = size;
+}
+
+Sha256::DigestT Sha256::Final() noexcept
+{
+    // 0x80, zeros up to 56 mod 64, then the length in bits big-endian
+    const uint64_t bits = length_ * 8;
+    buffer_[buffered_++] = 0x80;
+    if (buffered_ > BLOCK_SIZE - 8)
+    {
+        std::memset(buffer_.data() + buffered_, 0, BLOCK_SIZE - buffered_);
+        compress_(state_.data(), buffer_.data(), 1);
+        buffered_ = 0;
+    }
+    std::memset(buffer_.data() + buffered_, 0, BLOCK_SIZE - 8 - buffered_);
+    for (int i = 0; i < 8; ++i)
+    {
+        buffer_[BLOCK_SIZE - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+    compress_(state_.data(), buffer_.data(), 1);
+
+    DigestT digest{};
+    for (size_t i = 0; i < state_.size(); ++i)
+    {
+        digest[i * 4] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    return digest;
+}
+
+std::string Sha256::FinalHex()
+{
+    constexpr std::string_view DIGITS = "0123456789abcdef";
+
+    const DigestT digest = Final();
+    std::string hex(DIGEST_SIZE * 2, '\0');
+    for (size_t i = 0; i < DIGEST_SIZE; ++i)
+    {
+        hex[i * 2] = DIGITS[digest[i] >> 4];
+        hex[i * 2 + 1] = DIGITS[digest[i] & 0x0F];
+    }
+    return hex;
+}
+
+} // namespace utils
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace utils
+{
+
+enum class Sha256Backend
+{
+    SCALAR,
+    SHA_NI,
+};
+
+// the fastest backend this cpu supports, probed once
+[[nodiscard]]
+Sha256Backend sha256_backend() noexcept;
+
+[[nodiscard]]
+std::string_view to_string(Sha256Backend backend) noexcept;
+
+/*
+    Streaming SHA-256. The block function is picked at construction, SHA-NI where the cpu has it and a portable
+    scalar one otherwise. Whole blocks are hashed straight from the caller's data, only a trailing partial block is
+    copied, so feeding it large chunks (a request body, a file read in pieces) costs no more than one call.
+ */
+class Sha256
+{
+  public:
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t DIGEST_SIZE = 32;
+
+    using DigestT = std::array<uint8_t, DIGEST_SIZE>;
+
+    explicit Sha256(Sha256Backend backend = sha256_backend()) noexcept;
+
+    void Update(std::string_view data) noexcept;
+
+    // finishes the computation, the hasher must not be updated afterwards
+    [[nodiscard]]
+    DigestT Final() noexcept;
+
+    [[nodiscard]]
+    std::string FinalHex();
+
+  private:
+    using CompressT = void (*)(uint32_t* state, const uint8_t* blocks, size_t count);
+
+    CompressT compress_;
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, BLOCK_SIZE> buffer_{};
+    size_t buffered_ = 0;
+    uint64_t length_ = 0;
+};
+
+} // namespace utils
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace utils
+{
+
+/*
+    Hash map split into SHARD_COUNT independently locked shards, readers of a shard share its lock so lookups on
+    different keys only contend when they land in the same shard while somebody writes to it. A key is hashed once,
+    the hash picks the shard and is stored next to the key so the shard's own table (lookups and rehashing alike)
+    never hashes again.
+
+    Values are handed out by copy (Find) or visited under the shard's lock (Visit), never by reference.
+ */
+template <class K, class V, class Hash = std::hash<K>, size_t SHARD_COUNT = 64> class ShardedMap
+{
+    static_assert(SHARD_COUNT > 0 && (SHARD_COUNT & (SHARD_COUNT - 1)) == 0, "SHARD_COUNT must be a power of two");
+
+  public:
+    [[nodiscard]]
+    std::optional<V> Find(const K& key) const
+    {
+        std::optional<V> value;
+        Visit(key, [&value](const V& v) { value = v; });
+        return value;
+    }
+
+    // calls func(const V&) under the shard's shared lock, returns false when the key is not there
+    template <class F> bool Visit(const K& key, F&& func) const
+    {
+        const size_t hash = Hash{}(key);
+        const Shard& shard = ShardOf(hash);
+
+        std::shared_lock lock{shard.mutex};
+        const auto it = shard.map.find(KeyRef{key, hash});
+        if (it == shard.map.end())
+        {
+            return false;
+        }
+
+        std::forward<F>(func)(it->second);
+        return true;
+    }
+
+    void InsertOrAssign(const K& key, V value)
+    {
+        const size_t hash = Hash{}(key);
+        Shard& shard = ShardOf(hash);
+
+        std::lock_guard lock{shard.mutex};
+        if (const auto it = shard.map.find(KeyRef{key, hash}); it != shard.map.end())
+        {
+            it->second = std::move(value);
+            return;
+        }
+
+        shard.map.emplace(HashedKey{key, hash}, std::move(value));
+    }
+
+    // returns false (and leaves the stored value alone) when the key is already there
+    bool InsertIfAbsent(const K& key, V value)
+    {
+        const size_t hash = Hash{}(key);
+        Shard& shard = ShardOf(hash);
+
+        std::lock_guard lock{shard.mutex};
+        if (shard.map.contains(KeyRef{key, hash}))
+        {
+            return false;
+        }
+
+        shard.map.emplace(HashedKey{key, hash}, std::move(value));
+        return true;
+    }
+
+    // calls func(V&) under the shard's exclusive lock, a default constructed value is inserted first when the key is not there
+    template <class F> void Update(const K& key, F&& func)
+    {
+        const size_t hash = Hash{}(key);
+        Shard& shard = ShardOf(hash);
+
+        std::lock_guard lock{shard.mutex};
+        auto it = shard.map.find(KeyRef{key, hash});
+        if (it == shard.map.end())
+        {
+            it = shard.map.emplace(HashedKey{key, hash}, V{}).first;
+        }
+
+        std::forward<F>(func)(it->second);
+    }
+
+    // calls func(V&) under the shard's exclusive lock, returns false (without calling it) when the key is not there
+    template <class F> bool Modify(const K& key, F&& func)
+    {
+        const size_t hash = Hash{}(key);
+        Shard& shard = ShardOf(hash);
+
+        std::lock_guard lock{shard.mutex};
+        const auto it = shard.map.find(KeyRef{key, hash});
+        if (it == shard.map.end())
+        {
+            return false;
+        }
+
+        std::forward<F>(func)(it->second);
+        return true;
+    }
+
+    bool Erase(const K& key)
+    {
+        return EraseIf(key, [](const V&) { return true; });
+    }
+
+    // erases the entry when pred(const V&) holds, decided under the shard's exclusive lock
+    template <class Pred> bool EraseIf(const K& key, Pred&& pred)
+    {
+        const size_t hash = Hash{}(key);
+        Shard& shard = ShardOf(hash);
+
+        std::lock_guard lock{shard.mutex};
+        const auto it = shard.map.find(KeyRef{key, hash});
+        if (it == shard.map.end() || !std::forward<Pred>(pred)(it->second))
+        {
+            return false;
+        }
+
+        shard.map.erase(it);
+        return true;
+    }
+
+    // erases every entry pred(const V&) holds for, one shard at a time, returns how many were erased
+    template <class Pred> size_t EraseIf(Pred&& pred)
+    {
+        size_t erased = 0;
+        for (Shard& shard : shards_)
+        {
+            std::lock_guard lock{shard.mutex};
+            erased += std::erase_if(shard.map, [&pred](const auto& entry) { return pred(entry.second); });
+        }
+
+        return erased;
+    }
+
+    // calls func(const K&, const V&) for every entry, one shard at a time
+    template <class F> void ForEach(F&& func) const
+    {
+        for (const Shard& shard : shards_)
+        {
+            std::shared_lock lock{shard.mutex};
+            for (const auto& [key, value] : shard.map)
+            {
+                func(key.key, value);
+            }
+        }
+    }
+
+    [[nodiscard]]
+    size_t Size() const
+    {
+        size_t size = 0;
+        for (const Shard& shard : shards_)
+        {
+            std::shared_lock lock{shard.mutex};
+            size += shard.map.size();
+        }
+
+        return size;
+    }
+
+  private:
+    struct HashedKey
+    {
+        K key;
+        size_t hash;
+    };
+
+    // what lookups use, so the key is neither copied nor hashed again
+    struct KeyRef
+    {
+        const K& key;
+        size_t hash;
+    };
+
+    struct StoredHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(const HashedKey& key) const noexcept
+        {
+            return key.hash;
+        }
+
+        size_t operator()(const KeyRef& key) const noexcept
+        {
+            return key.hash;
+        }
+    };
+
+    struct KeyEqual
+    {
+        using is_transparent = void;
+
+        bool operator()(const HashedKey& lhs, const HashedKey& rhs) const
+        {
+            return lhs.hash == rhs.hash && lhs.key == rhs.key;
+        }
+
+        bool operator()(const KeyRef& lhs, const HashedKey& rhs) const
+        {
+            return lhs.hash == rhs.hash && lhs.key == rhs.key;
+        }
+
+        bool operator()(const HashedKey& lhs, const KeyRef& rhs) const
+        {
+            return lhs.hash == rhs.hash && lhs.key == rhs.key;
+        }
+    };
+
+    // a cache line each, so that locking one shard does not slow down its neighbours
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<HashedKey, V, StoredHash, KeyEqual> map;
+    };
+
+    // the shard's table uses the low bits of the hash, the shard is picked from the high bits of a mixed hash
+    static size_t ShardIndex(size_t hash) noexcept
+    {
+        constexpr size_t SHIFT = 64 - std::countr_zero(SHARD_COUNT);
+        if constexpr (SHARD_COUNT == 1)
+        {
+            return 0;
+        }
+        else
+        {
+            return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> SHIFT);
+        }
+    }
+
+    Shard& ShardOf(size_t hash) noexcept
+    {
+        return shards_[ShardIndex(hash)];
+    }
+
+    const Shard& ShardOf(size_t hash) const noexcept
+    {
+        return shards_[ShardIndex(hash)];
+    }
+
+    std::array<Shard, SHARD_COUNT> shards_;
+};
+
+} // namespace utils
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace utils
+{
+
+struct CacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    // entries dropped to stay within the budget, invalidations are not counted
+    uint64_t evictions = 0;
+
+    uint64_t memory_usage = 0;
+};
+
+/*
+    Segmented LRU with a byte budget. A new entry starts on probation and is only promoted to the protected segment
+    (four fifths of the budget) when it is hit again, so a scan over many cold keys (a PROPFIND of a large tree)
+    evicts other cold keys rather than the hot ones. The keys are spread over SHARD_COUNT shards, each with its own lock
+    and its share of the budget.
+
+    A lookup that misses hands out a ticket, filling the entry in with that ticket is skipped when a key of the shard
+    was invalidated in between. That keeps a reader that fetched the old value before a write from caching it after
+    the write invalidated the entry.
+ */
+template <class K, class V, class Hash = std::hash<K>, size_t SHARD_COUNT = 16> class SlruCache
+{
+    static_assert(SHARD_COUNT > 1 && (SHARD_COUNT & (SHARD_COUNT - 1)) == 0, "SHARD_COUNT must be a power of two greater than one");
+
+  public:
+    // the heap footprint of an entry, good enough to keep the cache within its budget
+    using SizeOfT = std::function<size_t(const K&, const V&)>;
+
+    struct Lookup
+    {
+        std::optional<V> value;
+        uint64_t ticket = 0;
+    };
+
+    SlruCache(size_t budget, SizeOfT size_of) : size_of_(std::move(size_of))
+    {
+        for (Shard& shard : shards_)
+        {
+            shard.budget = budget / SHARD_COUNT;
+            shard.protected_budget = shard.budget / 5 * 4;
+        }
+    }
+
+    [[nodiscard]]
+    Lookup Get(const K& key)
+    {
+        Shard& shard = ShardOf(key);
+
+        std::lock_guard lock{shard.mutex};
+        const auto it = shard.nodes.find(key);
+        if (it == shard.nodes.end())
+        {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return {std::nullopt, shard.epoch};
+        }
+
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        Node& node = it->second;
+        if (node.is_protected)
+        {
+            shard.protected_lru.splice(shard.protected_lru.begin(), shard.protected_lru, node.lru_it);
+        }
+        else
+        {
+            // the second hit promotes it, whatever no longer fits into the protected segment goes back on probation
+            shard.probation_lru.erase(node.lru_it);
+            shard.protected_lru.push_front(&it->first);
+            node.lru_it = shard.protected_lru.begin();
+            node.is_protected = true;
+            shard.protected_bytes += node.bytes;
+            Demote(shard);
+        }
+
+        return {node.value, shard.epoch};
+    }
+
+    // fills an entry in after a miss, returns false when the shard was invalidated since the ticket was handed out
+    bool Put(const K& key, V value, const uint64_t ticket)
+    {
+        const size_t bytes = size_of_(key, value);
+        Shard& shard = ShardOf(key);
+        if (bytes > shard.budget)
+        {
+            return false;
+        }
+
+        std::lock_guard lock{shard.mutex};
+        if (shard.epoch != ticket)
+        {
+            return false;
+        }
+
+        if (const auto it = shard.nodes.find(key); it != shard.nodes.end())
+        {
+            EraseLocked(shard, it);
+        }
+
+        while (shard.bytes + bytes > shard.budget && Evict(shard))
+        {
+        }
+
+        const auto it = shard.nodes.emplace(key, Node{std::move(value), bytes, {}, false}).first;
+        shard.probation_lru.push_front(&it->first);
+        it->second.lru_it = shard.probation_lru.begin();
+        shard.bytes += bytes;
+        return true;
+    }
+
+    // drops the entry and moves the shard on to a new ticket, which is returned
+    uint64_t Invalidate(const K& key)
+    {
+        Shard& shard = ShardOf(key);
+
+        std::lock_guard lock{shard.mutex};
+        if (const auto it = shard.nodes.find(key); it != shard.nodes.end())
+        {
+            EraseLocked(shard, it);
+        }
+
+        return ++shard.epoch;
+    }
+
+    void Clear()
+    {
+        for (Shard& shard : shards_)
+        {
+            std::lock_guard lock{shard.mutex};
+            shard.nodes.clear();
+            shard.probation_lru.clear();
+            shard.protected_lru.clear();
+            shard.bytes = 0;
+            shard.protected_bytes = 0;
+            ++shard.epoch;
+        }
+    }
+
+    [[nodiscard]]
+    CacheStats GetStats()
+    {
+        CacheStats stats{hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+                         evictions_.load(std::memory_order_relaxed), 0};
+        for (Shard& shard : shards_)
+        {
+            std::lock_guard lock{shard.mutex};
+            stats.memory_usage += shard.bytes;
+        }
+
+        return stats;
+    }
+
+  private:
+    // the lists point at the keys stored in the map, whose addresses are stable
+    using LruT = std::list<const K*>;
+
+    struct Node
+    {
+        V value;
+        size_t bytes = 0;
+        typename LruT::iterator lru_it;
+        bool is_protected = false;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<K, Node, Hash> nodes;
+        LruT probation_lru;
+        LruT protected_lru;
+        size_t budget = 0;
+        size_t protected_budget = 0;
+        size_t bytes = 0;
+        size_t protected_bytes = 0;
+        uint64_t epoch = 0;
+    };
+
+    Shard& ShardOf(const K& key) noexcept
+    {
+        constexpr size_t SHIFT = 64 - std::countr_zero(SHARD_COUNT);
+        return shards_[static_cast<size_t>((static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull) >> SHIFT)];
+    }
+
+    // moves the least recently used protected entries back on probation until the segment fits
+    void Demote(Shard& shard)
+    {
+        while (shard.protected_bytes > shard.protected_budget && !shard.protected_lru.empty())
+        {
+            Node& node = shard.nodes.find(*shard.protected_lru.back())->second;
+            shard.probation_lru.splice(shard.probation_lru.begin(), shard.protected_lru, node.lru_it);
+            node.is_protected = false;
+            shard.protected_bytes -= node.bytes;
+        }
+    }
+
+    // drops the least recently used entry on probation (of the protected segment when probation is empty)
+    bool Evict(Shard& shard)
+    {
+        LruT& lru = shard.probation_lru.empty() ? shard.protected_lru : shard.probation_lru;
+        if (lru.empty())
+        {
+            return false;
+        }
+
+        EraseLocked(shard, shard.nodes.find(*lru.back()));
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void EraseLocked(Shard& shard, typename std::unordered_map<K, Node, Hash>::iterator it)
+    {
+        Node& node = it->second;
+        shard.bytes -= node.bytes;
+        if (node.is_protected)
+        {
+            shard.protected_bytes -= node.bytes;
+            shard.protected_lru.erase(node.lru_it);
+        }
+        else
+        {
+            shard.probation_lru.erase(node.lru_it);
+        }
+        shard.nodes.erase(it);
+    }
+
+    SizeOfT size_of_;
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> misses_ = 0;
+    std::atomic<uint64_t> evictions_ = 0;
+};
+
+} // namespace utils
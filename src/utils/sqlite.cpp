@@ -0,0 +1,295 @@
+#include "sqlite.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <sqlite3.h>
+
+#include "ConfigManager.h"
+#include "utils/path.h"
+
+namespace utils::sqlite
+{
+
+// a writer holding the lock longer than this (e.g. another process) makes the statement fail instead of waiting forever
+static constexpr int BUSY_TIMEOUT_MS = 5000;
+
+// upper bound on the writes sharing one transaction, so that a long queue does not keep readers on an old snapshot
+static constexpr size_t MAX_BATCH_SIZE = 512;
+
+static std::runtime_error make_error(sqlite3* db, std::string_view what)
+{
+    return std::runtime_error{std::string{what} + ": " + sqlite3_errmsg(db)};
+}
+
+Statement::Statement(sqlite3* db, const std::string_view sql) : db_(db)
+{
+    if (sqlite3_prepare_v3(db_, sql.data(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &stmt_, nullptr) != SQLITE_OK)
+    {
+        throw make_error(db_, "Unable to prepare a statement");
+    }
+}
+
+Statement::~Statement()
+{
+    sqlite3_finalize(stmt_);
+}
+
+Statement& Statement::Bind(const int index, const std::string_view text)
+{
+    if (sqlite3_bind_text(stmt_, index, text.data(), static_cast<int>(text.size()), SQLITE_TRANSIENT) != SQLITE_OK)
+    {
+        throw make_error(db_, "Unable to bind a parameter");
+    }
+    return *this;
+}
+
+Statement& Statement::Bind(const int index, const int64_t value)
+{
+    if (sqlite3_bind_int64(stmt_, index, value) != SQLITE_OK)
+    {
+        throw make_error(db_, "Unable to bind a parameter");
+    }
+    return *this;
+}
+
+bool Statement::Step()
+{
+    switch (sqlite3_step(stmt_))
+    {
+    case SQLITE_ROW:
+        return true;
+    case SQLITE_DONE:
+        return false;
+    default:
+        throw make_error(db_, "Statement failed");
+    }
+}
+
+std::string Statement::ColumnText(const int index) const
+{
+    const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, index));
+    return text != nullptr ? std::string{text, static_cast<size_t>(sqlite3_column_bytes(stmt_, index))} : std::string{};
+}
+
+int64_t Statement::ColumnInt(const int index) const
+{
+    return sqlite3_column_int64(stmt_, index);
+}
+
+void Statement::Reset() noexcept
+{
+    sqlite3_reset(stmt_);
+    sqlite3_clear_bindings(stmt_);
+}
+
+Connection::Connection(const std::filesystem::path& path, const bool read_only)
+{
+    const int flags = (read_only ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) | SQLITE_OPEN_NOMUTEX;
+    if (sqlite3_open_v2(utils::path::to_string(path).c_str(), &db_, flags, nullptr) != SQLITE_OK)
+    {
+        const std::runtime_error error = make_error(db_, "Unable to open the database");
+        sqlite3_close(db_);
+        throw error;
+    }
+
+    sqlite3_busy_timeout(db_, BUSY_TIMEOUT_MS);
+    if (!read_only)
+    {
+        // WAL lets the readers go on while the writer commits, the mode is stored in the database file
+        Execute("PRAGMA journal_mode=WAL");
+        Execute("PRAGMA synchronous=FULL");
+    }
+}
+
+Connection::~Connection()
+{
+    statements_.clear();
+    sqlite3_close(db_);
+}
+
+Statement& Connection::Prepare(const std::string& sql)
+{
+    auto it = statements_.find(sql);
+    if (it == statements_.end())
+    {
+        it = statements_.emplace(sql, std::make_unique<Statement>(db_, sql)).first;
+    }
+
+    it->second->Reset();
+    return *it->second;
+}
+
+void Connection::Execute(const char* sql)
+{
+    char* message = nullptr;
+    if (sqlite3_exec(db_, sql, nullptr, nullptr, &message) != SQLITE_OK)
+    {
+        std::runtime_error error{std::string{sql} + ": " + (message != nullptr ? message : "unknown error")};
+        sqlite3_free(message);
+        throw error;
+    }
+}
+
+void Connection::ResetAll() noexcept
+{
+    for (const auto& [sql, statement] : statements_)
+    {
+        statement->Reset();
+    }
+}
+
+int Connection::Changes() const noexcept
+{
+    return sqlite3_changes(db_);
+}
+
+Database& Database::GetInstance()
+{
+    const auto& conf = ConfigManager::GetInstance();
+    static Database instance{conf.GetSQLiteDB(), conf.GetHttpBlockingThreads()};
+    return instance;
+}
+
+Database::Database(std::filesystem::path path, const size_t max_readers) : path_(std::move(path)), max_readers_(std::max<size_t>(max_readers, 1))
+{
+    if (path_.has_parent_path())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(path_.parent_path(), ec);
+    }
+
+    writer_connection_ = std::make_unique<Connection>(path_, false);
+    writer_ = std::jthread{[this](std::stop_token stop_token) { WriterLoop(std::move(stop_token)); }};
+}
+
+Database::~Database()
+{
+    writer_ = {};
+}
+
+void Database::Write(WriteT func)
+{
+    auto pending = std::make_shared<Pending>();
+    pending->func = std::move(func);
+    std::future<void> done = pending->done.get_future();
+
+    {
+        std::lock_guard lock{writes_mutex_};
+        writes_.push_back(std::move(pending));
+    }
+    writes_cv_.notify_one();
+
+    done.get();
+}
+
+void Database::WriterLoop(std::stop_token stop_token)
+{
+    Connection& connection = *writer_connection_;
+    std::vector<std::shared_ptr<Pending>> batch;
+    while (true)
+    {
+        {
+            // whatever was queued while the last transaction committed goes into the next one
+            std::unique_lock lock{writes_mutex_};
+            if (!writes_cv_.wait(lock, stop_token, [this]() { return !writes_.empty(); }))
+            {
+                return;
+            }
+
+            while (!writes_.empty() && batch.size() < MAX_BATCH_SIZE)
+            {
+                batch.push_back(std::move(writes_.front()));
+                writes_.pop_front();
+            }
+        }
+
+        std::exception_ptr commit_error;
+        try
+        {
+            connection.Execute("BEGIN IMMEDIATE");
+            for (const auto& pending : batch)
+            {
+                connection.Execute("SAVEPOINT write");
+                try
+                {
+                    pending->func(connection);
+                    connection.Execute("RELEASE write");
+                }
+                catch (...)
+                {
+                    pending->error = std::current_exception();
+                    connection.Execute("ROLLBACK TO write");
+                    connection.Execute("RELEASE write");
+                }
+            }
+            connection.Execute("COMMIT");
+        }
+        catch (...)
+        {
+            commit_error = std::current_exception();
+            try
+            {
+                connection.Execute("ROLLBACK");
+            }
+            catch (...)
+            {
+                // there was no transaction to roll back
+            }
+        }
+
+        for (const auto& pending : batch)
+        {
+            if (const std::exception_ptr error = pending->error ? pending->error : commit_error)
+            {
+                pending->done.set_exception(error);
+                continue;
+            }
+            pending->done.set_value();
+        }
+        batch.clear();
+    }
+}
+
+Database::ReaderLease::ReaderLease(Database& database) : database(database)
+{
+    std::unique_lock lock{database.readers_mutex_};
+    database.readers_cv_.wait(lock, [&database]() { return !database.idle_readers_.empty() || database.readers_ < database.max_readers_; });
+
+    if (!database.idle_readers_.empty())
+    {
+        connection = std::move(database.idle_readers_.back());
+        database.idle_readers_.pop_back();
+        return;
+    }
+
+    // opened outside of the lock, the slot is taken first so that the pool never grows past max_readers_
+    ++database.readers_;
+    lock.unlock();
+    try
+    {
+        connection = std::make_unique<Connection>(database.path_, true);
+    }
+    catch (...)
+    {
+        lock.lock();
+        --database.readers_;
+        database.readers_cv_.notify_one();
+        throw;
+    }
+}
+
+Database::ReaderLease::~ReaderLease()
+{
+    // a statement left on a row keeps its read transaction, and with it an old snapshot of the database, open
+    connection->ResetAll();
+    {
+        std::lock_guard lock{database.readers_mutex_};
+        database.idle_readers_.push_back(std::move(connection));
+    }
+    database.readers_cv_.notify_one();
+}
+
+} // namespace utils::sqlite
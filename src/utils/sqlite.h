@@ -0,0 +1,147 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace utils::sqlite
+{
+
+// a prepared statement, bound by index (1-based like sqlite3_bind_*), errors are thrown as std::runtime_error
+class Statement
+{
+  public:
+    Statement(sqlite3* db, std::string_view sql);
+    ~Statement();
+
+    Statement(const Statement&) = delete;
+    Statement& operator=(const Statement&) = delete;
+
+    Statement& Bind(int index, std::string_view text);
+
+    Statement& Bind(int index, int64_t value);
+
+    // true while there is a row to read
+    bool Step();
+
+    [[nodiscard]]
+    std::string ColumnText(int index) const;
+
+    [[nodiscard]]
+    int64_t ColumnInt(int index) const;
+
+    void Reset() noexcept;
+
+  private:
+    sqlite3* db_;
+    sqlite3_stmt* stmt_ = nullptr;
+};
+
+// one connection in WAL mode, statements are prepared once per connection and reused
+class Connection
+{
+  public:
+    Connection(const std::filesystem::path& path, bool read_only);
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // the cached statement for sql, reset and ready to be bound
+    Statement& Prepare(const std::string& sql);
+
+    void Execute(const char* sql);
+
+    // resets every cached statement, ending the read transactions of statements that were not stepped to the end
+    void ResetAll() noexcept;
+
+    // rows changed by the last statement
+    [[nodiscard]]
+    int Changes() const noexcept;
+
+  private:
+    sqlite3* db_ = nullptr;
+    std::unordered_map<std::string, std::unique_ptr<Statement>> statements_;
+};
+
+/*
+    A database shared by the SQLite engines. Reads run on a pool of read-only connections (created on demand, at
+    most one per blocking thread), all writes go through one writer thread that runs whatever was queued while the
+    last transaction committed as one transaction, each write in its own savepoint so that a failing write does not
+    take the others with it. Write() returns once the transaction holding it has committed.
+ */
+class Database
+{
+  public:
+    using WriteT = std::function<void(Connection&)>;
+
+    static Database& GetInstance();
+
+    Database(std::filesystem::path path, size_t max_readers);
+    ~Database();
+
+    Database(const Database&) = delete;
+    Database& operator=(const Database&) = delete;
+
+    // runs func(Connection&) on a read connection and returns what it returns
+    template <class F> auto Read(F&& func) -> std::invoke_result_t<F, Connection&>
+    {
+        ReaderLease lease{*this};
+        return std::forward<F>(func)(*lease.connection);
+    }
+
+    // runs func(Connection&) in the writer's next transaction, exceptions thrown by func (or the commit) are rethrown here
+    void Write(WriteT func);
+
+  private:
+    struct Pending
+    {
+        WriteT func;
+        std::promise<void> done;
+        std::exception_ptr error;
+    };
+
+    struct ReaderLease
+    {
+        explicit ReaderLease(Database& database);
+        ~ReaderLease();
+
+        Database& database;
+        std::unique_ptr<Connection> connection;
+    };
+
+    void WriterLoop(std::stop_token stop_token);
+
+    std::filesystem::path path_;
+    size_t max_readers_;
+
+    std::mutex readers_mutex_;
+    std::condition_variable readers_cv_;
+    std::vector<std::unique_ptr<Connection>> idle_readers_;
+    size_t readers_ = 0;
+
+    std::mutex writes_mutex_;
+    std::condition_variable_any writes_cv_;
+    std::deque<std::shared_ptr<Pending>> writes_;
+
+    std::unique_ptr<Connection> writer_connection_;
+    std::jthread writer_;
+};
+
+} // namespace utils::sqlite
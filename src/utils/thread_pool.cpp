@@ -0,0 +1,144 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace utils
+{
+
+// which pool and which worker of it the current thread belongs to
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+WorkStealingPool::WorkStealingPool(size_t thread_count)
+{
+    thread_count = std::max<size_t>(thread_count, 1);
+
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        threads_.emplace_back(&WorkStealingPool::Run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard lock{sleep_mutex_};
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::Post(TaskT task)
+{
+    const size_t index = current_pool == this ? current_worker : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    {
+        // counted before the lock is released, a worker taking the task right away must not decrement first
+        std::lock_guard lock{workers_[index]->mutex};
+        workers_[index]->tasks.push_back(std::move(task));
+        pending_.fetch_add(1, std::memory_order_release);
+    }
+
+    // a worker that just found nothing pending is either asleep already or sees the new count
+    std::lock_guard lock{sleep_mutex_};
+    sleep_cv_.notify_one();
+}
+
+size_t WorkStealingPool::Size() const noexcept
+{
+    return workers_.size();
+}
+
+void WorkStealingPool::Run(const size_t index)
+{
+    current_pool = this;
+    current_worker = index;
+
+    TaskT task;
+    while (true)
+    {
+        if (TryPop(index, task) || TrySteal(index, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock{sleep_mutex_};
+        sleep_cv_.wait(lock, [this] { return stop_ || pending_.load(std::memory_order_acquire) > 0; });
+        if (stop_ && pending_.load(std::memory_order_acquire) == 0)
+        {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::TryPop(const size_t index, TaskT& task)
+{
+    Worker& worker = *workers_[index];
+    std::lock_guard lock{worker.mutex};
+    if (worker.tasks.empty())
+    {
+        return false;
+    }
+
+    // uncounted under the same lock it was counted under, pending_ never reports a task nobody can take
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    pending_.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+bool WorkStealingPool::TrySteal(const size_t index, TaskT& task)
+{
+    const auto take = [this, &task](Worker& victim) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+    };
+
+    // a victim busy with its own deque is skipped at first, the others may have work right away
+    std::vector<Worker*> contended;
+    for (size_t i = 1; i < workers_.size(); ++i)
+    {
+        Worker& victim = *workers_[(index + i) % workers_.size()];
+        std::unique_lock lock{victim.mutex, std::try_to_lock};
+        if (!lock.owns_lock())
+        {
+            contended.push_back(&victim);
+            continue;
+        }
+        if (!victim.tasks.empty())
+        {
+            take(victim);
+            return true;
+        }
+    }
+
+    // then waited for, giving up on it would leave its tasks pending and this worker spinning instead of sleeping
+    for (Worker* victim : contended)
+    {
+        std::lock_guard lock{victim->mutex};
+        if (!victim->tasks.empty())
+        {
+            take(*victim);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace utils
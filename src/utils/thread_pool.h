@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace utils
+{
+
+/*
+    Fixed number of workers, each owning a deque of tasks. A worker pops its own deque from the back (the task it
+    pushed last is the one with the warmest cache) and, once that is empty, steals from the front of the others.
+    Tasks submitted from outside the pool are spread round-robin over the workers, tasks submitted from inside a
+    worker go to that worker's own deque.
+ */
+class WorkStealingPool
+{
+  public:
+    using TaskT = std::function<void()>;
+
+    explicit WorkStealingPool(size_t thread_count);
+
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void Post(TaskT task);
+
+    template <class F> auto Submit(F&& func) -> std::future<std::invoke_result_t<F>>
+    {
+        using ResultT = std::invoke_result_t<F>;
+
+        auto task = std::make_shared<std::packaged_task<ResultT()>>(std::forward<F>(func));
+        std::future<ResultT> future = task->get_future();
+        Post([task = std::move(task)]() { (*task)(); });
+
+        return future;
+    }
+
+    [[nodiscard]]
+    size_t Size() const noexcept;
+
+  private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<TaskT> tasks;
+    };
+
+    void Run(size_t index);
+
+    bool TryPop(size_t index, TaskT& task);
+
+    bool TrySteal(size_t index, TaskT& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_worker_{0};
+
+    std::atomic<size_t> pending_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool stop_ = false;
+};
+
+} // namespace utils
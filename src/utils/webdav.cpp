@@ -2,123 +2,332 @@
 
 #include <cassert>
 #include <chrono>
+#include <deque>
+#include <exception>
 #include <filesystem>
-#include <format>
 #include <mutex>
+#include <optional>
 #include <regex>
-#include <stack>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
+#include <async_simple/Future.h>
+#include <async_simple/Promise.h>
+#include <async_simple/coro/FutureAwaiter.h>
+
+#include "ConfigManager.h"
+#include "file.h"
 #include "http_exceptions.hpp"
+#include "logger.hpp"
 #include "path.h"
+#include "services/DirectoryCacheService.h"
 #include "services/FileETagServiceFactory.h"
 #include "services/FileLockService.h"
+#include "services/FileWatcherService.h"
+#include "blocking.h"
+#include "thread_pool.h"
 
 std::mutex utils_webdav_ComputeEtag_LOCK;
 
 namespace utils::webdav
 {
 
-pugi::xml_node generate_multistatus_header(pugi::xml_node& xml_doc)
+std::string to_href(const std::filesystem::path& abs_path, const bool is_dir)
 {
-    pugi::xml_node xml_ms = xml_doc.append_child("D:multistatus");
-    xml_ms.append_attribute("xmlns:D").set_value("DAV:");
+    static const auto& conf = ConfigManager::GetInstance();
+
+    std::filesystem::path relative_path = abs_path.lexically_relative(conf.GetWebDavAbsoluteDataPath());
+    if (!relative_path.has_filename())
+    {
+        relative_path = relative_path.parent_path(); // "a/b/" -> "a/b"
+    }
 
-    return xml_ms;
+    std::string href = conf.GetWebDavPrefix();
+    href += '/';
+    href += utils::path::with_separator(relative_path, is_dir, '/');
+    if (href.ends_with("./"))
+    {
+        href.resize(href.size() - 2);
+    }
+
+    return href;
 }
 
-void generate_response(pugi::xml_node& multistatus, const std::filesystem::path& path)
+// everything but the etag
+static ResourceInfo stat_resource_info(const std::filesystem::directory_entry& entry, std::string href)
+{
+    ResourceInfo info{std::move(href)};
+    info.is_directory = entry.is_directory();
+    if (!info.is_directory)
+    {
+        info.size = entry.file_size();
+    }
+
+    const auto file_time = std::chrono::clock_cast<std::chrono::system_clock>(entry.last_write_time());
+    info.last_modified = std::chrono::system_clock::to_time_t(file_time);
+
+    return info;
+}
+
+ResourceInfo make_resource_info(const std::filesystem::directory_entry& entry, std::string href)
+{
+    ResourceInfo info = stat_resource_info(entry, std::move(href));
+
+    // Whatever etag is stored, PROPFIND never hashes a file. A directory's etag only combines its members' stored
+    // ones, so one that was never computed (or changed behind our back) is computed here.
+    static auto& etag_service = FileETagService::GetService();
+    info.etag = info.is_directory ? etag_service.GetValidated(entry.path()) : etag_service.Get(entry.path());
+
+    return info;
+}
+
+// what one directory scan hands back to the writer, the members in directory order plus the sub directories to descend into
+struct DirectoryListing
+{
+    std::vector<ResourceInfo> entries;
+    std::vector<std::pair<std::filesystem::path, std::string>> sub_dirs;
+};
+
+// the mtime of a stat tuple, which counts from file_clock's epoch where get_file_stat has no stat()
+static std::time_t mtime_to_time_t(const int64_t mtime_ns)
 {
-    const bool is_directory = std::filesystem::is_directory(path);
-    auto xml_res = multistatus.append_child("D:response");
+#ifdef _WIN32
+    const std::filesystem::file_time_type file_time{
+        std::chrono::duration_cast<std::filesystem::file_time_type::duration>(std::chrono::nanoseconds{mtime_ns})};
+    return std::chrono::system_clock::to_time_t(std::chrono::clock_cast<std::chrono::system_clock>(file_time));
+#else
+    return static_cast<std::time_t>(mtime_ns / 1'000'000'000);
+#endif
+}
 
-    auto relative_file_path = std::filesystem::relative(path, std::filesystem::current_path());
-    std::string file_path = utils::path::with_separator(relative_file_path, is_directory, '/', 1);
-    file_path.insert(file_path.begin(), '/'); // begin with '/'
+// all the stat calls of a directory happen here
+static DirectoryCache::CachedDirectoryPtrT read_directory(const std::filesystem::path& dir)
+{
+    namespace fs = std::filesystem;
 
-    xml_res.append_child("D:href").text().set(file_path.c_str());
+    static auto& etag_service = FileETagService::GetService();
 
-    auto xml_propstat = xml_res.append_child("D:propstat");
-    auto xml_prop = xml_propstat.append_child("D:prop");
+    auto listing = std::make_shared<DirectoryCache::CachedDirectory>();
+    listing->stat = utils::file::get_file_stat(dir).value_or(utils::file::FileStat{});
 
-    if (is_directory)
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::directory_iterator(dir, fs::directory_options::skip_permission_denied))
     {
-        xml_prop.append_child("D:resourcetype").append_child("D:collection");
+        const bool is_dir = entry.is_directory();
+        if (!is_dir && !entry.is_regular_file())
+        {
+            continue;
+        }
+
+        // one stat per member, the size and mtime are taken from the tuple as well; gone meanwhile
+        const auto stat = utils::file::get_file_stat(entry.path());
+        if (!stat.has_value())
+        {
+            continue;
+        }
+
+        listing->entries.push_back({utils::path::to_string(entry.path().filename()), is_dir, is_dir ? 0 : stat->size,
+                                    mtime_to_time_t(stat->mtime_ns), {}, *stat});
+        paths.push_back(entry.path());
     }
-    else
+
+    // the etags of all members in one request, for the engines behind a network round trip
+    std::vector<std::string> etags = etag_service.GetMany(paths);
+    for (size_t i = 0; i < listing->entries.size(); ++i)
     {
-        xml_prop.append_child("D:getcontentlength").text().set(std::to_string(std::filesystem::file_size(path)).c_str());
+        // clients compare the etags of sub directories to skip unchanged subtrees, so those are always reported
+        if (etags[i].empty() && listing->entries[i].is_directory)
+        {
+            etags[i] = etag_service.GetValidated(paths[i]);
+        }
+        listing->entries[i].etag = std::move(etags[i]);
+    }
 
-        auto file_time = std::chrono::clock_cast<std::chrono::system_clock>(std::filesystem::last_write_time(path));
-        std::time_t file_time_t = std::chrono::system_clock::to_time_t(file_time);
-        char buffer[100];
-        std::strftime(buffer, 100, "%a, %d %b %Y %H:%M:%S GMT", std::localtime(&file_time_t));
+    return listing;
+}
 
-        xml_prop.append_child("D:getlastmodified").text().set(buffer);
+/*
+    A listing of a directory the FileWatcher does not cover may have been changed behind our back. Adding or removing
+    a member changes the directory's own mtime, a member written in place only changes its own stat, so the directory
+    and each member are stat-ed, which is still far cheaper than reading the directory and its etags again.
+ */
+static bool is_listing_fresh(const std::filesystem::path& dir, const DirectoryCache::CachedDirectory& cached)
+{
+    const auto dir_stat = utils::file::get_file_stat(dir);
+    if (!dir_stat.has_value() || *dir_stat != cached.stat)
+    {
+        return false;
     }
 
-    xml_propstat.append_child("D:status").text().set("HTTP/1.1 200 OK");
+    for (const auto& entry : cached.entries)
+    {
+        if (const auto stat = utils::file::get_file_stat(dir / entry.name); !stat.has_value() || *stat != entry.stat)
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
-void generate_response_list(pugi::xml_node& multistatus, const std::filesystem::path& path)
+// runs on the traversal pool, answered from the directory cache when the listing is in there (and still valid)
+static DirectoryListing scan_directory(const std::filesystem::path& dir, const std::string& href_prefix, const bool collect_sub_dirs)
 {
-    for (const auto& entry : std::filesystem::directory_iterator(path))
+    static auto& directory_cache = DirectoryCache::Service::GetInstance();
+    static auto& file_watcher = FileWatcher::Service::GetInstance();
+
+    auto [cached, ticket] = directory_cache.Get(dir);
+    if (cached != nullptr && !file_watcher.IsWatched(dir) && !is_listing_fresh(dir, *cached))
     {
-        generate_response(multistatus, entry.path());
+        cached = nullptr;
     }
+    if (cached == nullptr)
+    {
+        // a change committed while the directory is read drops the fill, the next PROPFIND reads it again
+        cached = read_directory(dir);
+        directory_cache.Put(dir, cached, ticket);
+    }
+
+    DirectoryListing listing;
+    listing.entries.reserve(cached->entries.size());
+    for (const auto& entry : cached->entries)
+    {
+        // the href is the parent's href plus the name, no need to compute a relative path per entry
+        std::string href = href_prefix + entry.name;
+        if (entry.is_directory)
+        {
+            href += '/';
+            if (collect_sub_dirs)
+            {
+                listing.sub_dirs.emplace_back(dir / entry.name, href);
+            }
+        }
+
+        listing.entries.push_back({std::move(href), entry.is_directory, entry.size, entry.last_modified, entry.etag});
+    }
+
+    return listing;
+}
+
+static utils::WorkStealingPool& traversal_pool()
+{
+    static utils::WorkStealingPool pool{ConfigManager::GetInstance().GetWebDavTraversalThreads()};
+    return pool;
 }
 
-// NOLINTNEXTLINE
-void generate_response_list_recurse(pugi::xml_node& multistatus, std::stack<std::filesystem::path> dirs, const int8_t depth)
+async_simple::coro::Lazy<bool> generate_response_list_recurse(MultistatusWriter& writer, const std::filesystem::path& path, const int8_t depth,
+                                                              const bool include_root)
 {
     namespace fs = std::filesystem;
 
-    if (depth <= 0 || dirs.empty())
-        return;
+    ResourceInfo root = co_await blocking::run([&path]() {
+        const fs::directory_entry entry{path};
+        return make_resource_info(entry, to_href(path, entry.is_directory()));
+    });
+    const bool is_dir = root.is_directory;
+    std::string root_href = root.href;
+    if (include_root && !(co_await writer.Write(root)))
+    {
+        co_return false;
+    }
 
-    std::stack<fs::path> sub_dirs;
+    if (!is_dir || depth <= 0)
+    {
+        co_return true;
+    }
 
-    while (!dirs.empty())
+    /*
+        Directories are scanned concurrently on the traversal pool but emitted strictly in breadth first order, so the
+        response is the same as a serial walk would produce. Only a window of directories ahead of the one being
+        written is scanned, which bounds the number of finished listings waiting in memory.
+     */
+    struct PendingDirectory
     {
-        for (const auto& entry : fs::directory_iterator(dirs.top()))
+        fs::path path;
+        std::string href;
+        int8_t level;
+        std::optional<async_simple::Future<DirectoryListing>> listing;
+    };
+
+    auto& pool = traversal_pool();
+    const size_t window = pool.Size() * 4;
+
+    std::deque<PendingDirectory> pending;
+    size_t scheduled = 0;
+    auto schedule = [&pending, &scheduled, &pool, window, depth]() {
+        for (; scheduled < pending.size() && scheduled < window; ++scheduled)
         {
-            auto xml_res = multistatus.append_child("D:response");
-            std::string file_path = utils::path::with_separator(fs::relative(entry, std::filesystem::current_path()), entry.is_directory(), '/', 1);
-            file_path.insert(file_path.begin(), '/');
-            xml_res.append_child("D:href").set_value(file_path.c_str());
+            PendingDirectory& dir = pending[scheduled];
+            async_simple::Promise<DirectoryListing> promise;
+            dir.listing.emplace(promise.getFuture());
+            pool.Post([promise = std::move(promise), dir_path = dir.path, href = dir.href, collect_sub_dirs = dir.level + 1 < depth]() mutable {
+                try
+                {
+                    promise.setValue(scan_directory(dir_path, href, collect_sub_dirs));
+                }
+                catch (...)
+                {
+                    promise.setException(std::current_exception());
+                }
+            });
+        }
+    };
 
-            auto xml_propstat = xml_res.append_child("D:propstat");
-            auto xml_prop = xml_propstat.append_child("D:prop");
+    pending.push_back({path, std::move(root_href), 0, {}});
+    schedule();
 
-            if (entry.is_directory())
-            {
-                sub_dirs.push(entry.path());
-                xml_prop.append_child("D:resourcetype").append_child("D:collection");
-            }
-            else if (entry.is_regular_file())
+    while (!pending.empty())
+    {
+        PendingDirectory dir = std::move(pending.front());
+        pending.pop_front();
+        --scheduled;
+
+        // resumes on this connection's I/O thread once the scan is done, the thread is never blocked waiting
+        DirectoryListing listing;
+        try
+        {
+            listing = co_await std::move(*dir.listing);
+        }
+        catch (const fs::filesystem_error& err)
+        {
+            // removed or made unreadable since its parent was listed, the directory itself has been reported already,
+            // the rest of the tree still is
+            LOG_WARN(err.what())
+        }
+        for (auto& [sub_path, sub_href] : listing.sub_dirs)
+        {
+            pending.push_back({std::move(sub_path), std::move(sub_href), static_cast<int8_t>(dir.level + 1), {}});
+        }
+        schedule();
+
+        for (const auto& info : listing.entries)
+        {
+            if (!(co_await writer.Write(info)))
             {
-                xml_prop.append_child("D:getcontentlength").text().set(std::to_string(entry.file_size()).c_str());
-                auto file_time = std::chrono::clock_cast<std::chrono::system_clock>(entry.last_write_time());
-                std::time_t file_time_t = std::chrono::system_clock::to_time_t(file_time);
-                char buffer[100];
-                std::strftime(buffer, 100, "%a, %d %b %Y %H:%M:%S GMT", std::localtime(&file_time_t));
-                xml_prop.append_child("D:getlastmodified").text().set(buffer);
+                co_return false;
             }
-
-            xml_propstat.append_child("D:status").text().set("HTTP/1.1 200 OK");
         }
-        dirs.pop();
     }
 
-    generate_response_list_recurse(multistatus, std::move(sub_dirs), static_cast<int8_t>(depth - 1));
+    co_return true;
 }
 
-void generate_response_list_recurse(pugi::xml_node& multistatus, const std::filesystem::path& path, const int8_t depth)
+// [W/"etag"] -> etag, the brackets, the weak marker and the quotes are optional around the stored form
+static std::string_view unwrap_entity_tag(std::string_view condition)
 {
-    std::stack<std::filesystem::path> stack;
-    stack.push(path);
-    generate_response_list_recurse(multistatus, std::move(stack), depth);
+    condition.remove_prefix(1);
+    condition.remove_suffix(1);
+    if (condition.starts_with("W/"))
+    {
+        condition.remove_prefix(2);
+    }
+    if (condition.size() >= 2 && condition.front() == '"' && condition.back() == '"')
+    {
+        condition = condition.substr(1, condition.size() - 2);
+    }
+    return condition;
 }
 
 void check_precondition(const std::filesystem::path& abs_path, std::string conditions)
@@ -131,16 +340,19 @@ void check_precondition(const std::filesystem::path& abs_path, std::string condi
 
     /*
         (<urn:uuid:lock-token>) -> <urn:uuid:lock-token>
-        ([sha256]) -> [sha256]
+        ([etag]) -> [etag]
         (Not <urn:uuid:lock-token>) -> Not <urn:uuid:lock-token>
-        (Not [sha256]) -> Not [sha256]
-        (Not <urn:uuid:lock-token> [sha256]) -> Not <urn:uuid:lock-token> [sha256]
-        (<urn:uuid:lock-token> Not [sha256]) -> <urn:uuid:lock-token> Not [sha256]
-        (Not <urn:uuid:lock-token> Not [sha256] -> Not <urn:uuid:lock-token> Not [sha256]
+        (Not [etag]) -> Not [etag]
+        (Not <urn:uuid:lock-token> [etag]) -> Not <urn:uuid:lock-token> [etag]
+        (<urn:uuid:lock-token> Not [etag]) -> <urn:uuid:lock-token> Not [etag]
+        (Not <urn:uuid:lock-token> Not [etag] -> Not <urn:uuid:lock-token> Not [etag]
+
+        an etag is "algorithm:hex" (sha256, blake3: 64 digits, xxh3: 32) or a bare sha256 from before the prefix,
+        optionally quoted and marked weak
     */
-    static const std::regex extract_condition{R"((Not )?(\<urn:uuid:[^\s]+\>|\[[A-Za-z0-9]{64}\]))"};
+    static const std::regex extract_condition{R"((Not )?(\<urn:uuid:[^\s]+\>|\[(?:W/)?"?(?:[a-z0-9]+:)?[A-Za-z0-9]{32,64}"?\]))"};
 
-    // [sha256]
+    // [etag]
     static const std::regex is_entity_tag{R"(^\[(.*)\]$)"};
 
     // <urn:uuid:lock-token>
@@ -182,7 +394,7 @@ void check_precondition(const std::filesystem::path& abs_path, std::string condi
 
         if (condition.starts_with('[') && condition.ends_with(']'))
         {
-            bool res = etag_service.Get(resource_path) == std::format("[{}]", condition);
+            bool res = etag_service.Get(resource_path) == unwrap_entity_tag(condition);
             if (not_flag)
                 res = !res;
             if (!res)
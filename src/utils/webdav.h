@@ -2,21 +2,25 @@
 
 #include <cstdint>
 #include <filesystem>
-#include <stack>
+#include <string>
 
-#include <pugixml.hpp>
+#include <async_simple/coro/Lazy.h>
+
+#include "utils/multistatus.h"
 
 namespace utils::webdav
 {
 
+// "/data/root/a/b" -> "/webdav/a/b" ("/webdav/a/b/" for directories)
 [[nodiscard]]
-pugi::xml_node generate_multistatus_header(pugi::xml_node& xml_doc);
-
-void generate_response_list(pugi::xml_node& multistatus, const std::filesystem::path& path);
+std::string to_href(const std::filesystem::path& abs_path, bool is_dir);
 
-void generate_response_list_recurse(pugi::xml_node& multistatus, std::stack<std::filesystem::path> dirs, int8_t depth);
+[[nodiscard]]
+ResourceInfo make_resource_info(const std::filesystem::directory_entry& entry, std::string href);
 
-void generate_response_list_recurse(pugi::xml_node& multistatus, const std::filesystem::path& path, int8_t depth);
+// streams the resource itself (unless include_root is false) followed by its members down to depth levels, breadth first
+async_simple::coro::Lazy<bool> generate_response_list_recurse(MultistatusWriter& writer, const std::filesystem::path& path, int8_t depth,
+                                                              bool include_root = true);
 
 void check_precondition(const std::filesystem::path& abs_path, std::string conditions);
 
@@ -0,0 +1,68 @@
+#include "utils/sha256.h"
+#include <PicoSHA2/picosha2.h>
+
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+    SHA-256 throughput of picosha2 against the scalar and the accelerated kernels, for the sizes the server hashes:
+    digest auth strings, small files and large ones. Not a test, run it by hand on the machine that serves.
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static double measure(const std::string& data, const std::function<std::string(const std::string&)>& hash)
+{
+    // enough repetitions for roughly 256 MiB per case, at least 16
+    const size_t rounds = std::max<size_t>(16, 256 * 1024 * 1024 / std::max<size_t>(data.size(), 1));
+
+    volatile size_t sink = 0;
+    const auto start = Clock::now();
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        sink = sink + hash(data).size();
+    }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    return static_cast<double>(data.size() * rounds) / (1024.0 * 1024.0) / elapsed.count();
+}
+
+int main()
+{
+    std::cout << std::format("accelerated backend: {}\n\n", utils::to_string(utils::sha256_backend()));
+    std::cout << std::format("{:>10} {:>14} {:>14} {:>14}\n", "size", "picosha2 MB/s", "scalar MB/s", "dispatch MB/s");
+
+    for (const size_t size : {64, 1024, 64 * 1024, 16 * 1024 * 1024})
+    {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<char>(i * 131 + 7);
+        }
+
+        const double pico = measure(data, [](const std::string& text) {
+            std::string hex{};
+            picosha2::hash256_hex_string(text, hex);
+            return hex;
+        });
+        const double scalar = measure(data, [](const std::string& text) {
+            utils::Sha256 hasher{utils::Sha256Backend::SCALAR};
+            hasher.Update(text);
+            return hasher.FinalHex();
+        });
+        const double dispatch = measure(data, [](const std::string& text) {
+            utils::Sha256 hasher{};
+            hasher.Update(text);
+            return hasher.FinalHex();
+        });
+
+        std::cout << std::format("{:>10} {:>14.1f} {:>14.1f} {:>14.1f}\n", size, pico, scalar, dispatch);
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "utils/buffer_pool.h"
+#include <gtest/gtest.h>
+
+using utils::BufferPool;
+
+TEST(TestBufferPool, SizeClasses)
+{
+    EXPECT_EQ(BufferPool::SizeClassOf(1), BufferPool::MIN_BUFFER_SIZE);
+    EXPECT_EQ(BufferPool::SizeClassOf(16 * 1024), 16 * 1024);
+    EXPECT_EQ(BufferPool::SizeClassOf(16 * 1024 + 1), 32 * 1024);
+    EXPECT_EQ(BufferPool::SizeClassOf(1000 * 1024), 1024 * 1024);
+    EXPECT_EQ(BufferPool::SizeClassOf(64 * 1024 * 1024), BufferPool::MAX_BUFFER_SIZE);
+}
+
+TEST(TestBufferPool, ReusesReleasedBuffers)
+{
+    BufferPool pool{BufferPool::CLASS_COUNT * 1024 * 1024};
+
+    const char* first = nullptr;
+    {
+        auto buffer = pool.Acquire(20 * 1024);
+        EXPECT_EQ(buffer.size(), 32 * 1024);
+        first = buffer.data();
+        EXPECT_EQ(pool.GetStats().in_use_bytes, 32 * 1024);
+    }
+    EXPECT_EQ(pool.GetStats().in_use_bytes, 0);
+    EXPECT_EQ(pool.GetStats().retained_bytes, 32 * 1024);
+
+    auto buffer = pool.Acquire(32 * 1024);
+    EXPECT_EQ(buffer.data(), first);
+
+    const auto stats = pool.GetStats();
+    EXPECT_EQ(stats.acquires, 2);
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.retained_bytes, 0);
+}
+
+TEST(TestBufferPool, DiscardsBeyondBudget)
+{
+    // room for a single 1 MiB buffer per class
+    BufferPool pool{BufferPool::CLASS_COUNT * BufferPool::MAX_BUFFER_SIZE};
+    {
+        auto a = pool.Acquire(BufferPool::MAX_BUFFER_SIZE);
+        auto b = pool.Acquire(BufferPool::MAX_BUFFER_SIZE);
+    }
+
+    const auto stats = pool.GetStats();
+    EXPECT_EQ(stats.discards, 1);
+    EXPECT_EQ(stats.retained_bytes, BufferPool::MAX_BUFFER_SIZE);
+}
+
+TEST(TestBufferPool, PickBufferSize)
+{
+    // nothing measured yet, small files get small buffers
+    EXPECT_EQ(utils::pick_buffer_size(1000, 0), BufferPool::MIN_BUFFER_SIZE);
+    EXPECT_EQ(utils::pick_buffer_size(100 * 1024 * 1024, 0), 64 * 1024);
+
+    // ~20ms worth of throughput
+    EXPECT_EQ(utils::pick_buffer_size(100 * 1024 * 1024, 50 * 256 * 1024), 256 * 1024);
+    EXPECT_EQ(utils::pick_buffer_size(100 * 1024 * 1024, 1ull << 40), BufferPool::MAX_BUFFER_SIZE);
+
+    // the configured floor wins over a slow client
+    EXPECT_EQ(utils::pick_buffer_size(100 * 1024 * 1024, 1, 128 * 1024), 128 * 1024);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
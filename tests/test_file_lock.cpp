@@ -1,357 +1,144 @@
-#include <algorithm>
-#include <cassert>
-#include <filesystem>
-#include <list>
+#include "services/FileLockService.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
-template <class T>
-concept IsTimeType = std::is_same_v<T, std::chrono::nanoseconds> || std::is_same_v<T, std::chrono::microseconds> ||
-std::is_same_v<T, std::chrono::milliseconds> || std::is_same_v<T, std::chrono::seconds>;
-template <IsTimeType T = std::chrono::nanoseconds> T get_timestamp()
+static FileLock::EntryLock make_lock(const std::string& user, short depth, long long ttl = 3600)
 {
-	using namespace std::chrono;
-	return duration_cast<T>(system_clock::now().time_since_epoch());
+    FileLock::EntryLock lock;
+    lock.user = user;
+    lock.token = "urn:uuid:" + user;
+    lock.depth = depth;
+    lock.expires_at = utils::get_timestamp<std::chrono::seconds>().count() + ttl;
+    return lock;
 }
 
-enum class LockScope
+TEST(TestFileLock, LockDepthAndUnlock)
 {
-	SHARED = 0,
-	EXCLUSIVE
-};
+    auto& service = FileLock::Service::GetInstance();
+    ASSERT_TRUE(service.Lock("/a/b", make_lock("alice", 3)));
+
+    EXPECT_TRUE(service.IsLocked("/a/b"));
+    EXPECT_TRUE(service.IsLocked("/a/b/c/d/e"));
+    EXPECT_FALSE(service.IsLocked("/a/b/c/d/e/f"));
+    EXPECT_FALSE(service.IsLocked("/a"));
+    EXPECT_FALSE(service.IsLocked("/a/c"));
+
+    ASSERT_TRUE(service.GetLock("/a/b", "alice").has_value());
+    EXPECT_EQ(service.GetLock("/a/b/c", "alice")->token, "urn:uuid:alice");
+    EXPECT_FALSE(service.GetLock("/a/b", "bob").has_value());
+    EXPECT_TRUE(service.LockedByToken("/a/b", "urn:uuid:alice"));
+    EXPECT_FALSE(service.HoldingExclusiveLock("/a/b"));
+
+    EXPECT_FALSE(service.Unlock("/a/b", "bob"));
+    EXPECT_FALSE(service.Unlock("/a", "alice"));
+    EXPECT_TRUE(service.Unlock("/a/b", "alice"));
+    EXPECT_FALSE(service.IsLocked("/a/b"));
+    EXPECT_FALSE(service.IsLocked("/a/b/c/d/e"));
+
+    // the nodes leading to the lock went away with it
+    EXPECT_EQ(service.GetNodeCount(), 1);
+}
 
-enum class LockType
+TEST(TestFileLock, ManySiblings)
 {
-	WRITE = 0,
-	READ
-};
+    auto& service = FileLock::Service::GetInstance();
+    for (int i = 0; i < 10000; ++i)
+    {
+        ASSERT_TRUE(service.Lock("/data/dir/file" + std::to_string(i), make_lock("alice", 0)));
+    }
+    EXPECT_EQ(service.GetNodeCount(), 10003);
+
+    EXPECT_TRUE(service.IsLocked("/data/dir/file0"));
+    EXPECT_TRUE(service.IsLocked("/data/dir/file9999"));
+    EXPECT_FALSE(service.IsLocked("/data/dir/file10000"));
+    EXPECT_FALSE(service.IsLocked("/data/dir/file0/child"));
+    EXPECT_FALSE(service.IsLocked("/data/dir"));
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        ASSERT_TRUE(service.Unlock("/data/dir/file" + std::to_string(i), "alice"));
+    }
+    EXPECT_EQ(service.GetNodeCount(), 1);
+}
 
-struct EntryLock
+TEST(TestFileLock, SharedNodesAndPaths)
 {
-	std::string token;
-	short depth = std::numeric_limits<short>::min();
-	LockScope scope = LockScope::SHARED;
-	LockType type = LockType::WRITE;
-	long long expires_at = 0;
-	long long creation_date = get_timestamp<std::chrono::seconds>().count();
-
-	EntryLock() = default;
-
-	EntryLock(const EntryLock& lock) noexcept
-		: token(lock.token), depth(lock.depth), scope(lock.scope), type(lock.type), expires_at(lock.expires_at), creation_date(lock.creation_date) {};
-
-	EntryLock(EntryLock&& lock) noexcept
-		: token(std::move(lock.token)), depth(lock.depth), scope(lock.scope), type(lock.type), expires_at(lock.expires_at),
-		creation_date(lock.creation_date) {};
-
-	~EntryLock() = default;
-
-	std::chrono::seconds ExpiresAt() const
-	{
-		return std::chrono::seconds{ expires_at };
-	}
-
-	std::chrono::seconds CreationDate() const
-	{
-		return std::chrono::seconds{ creation_date };
-	}
-};
+    auto& service = FileLock::Service::GetInstance();
+    ASSERT_TRUE(service.Lock("/x/y", make_lock("alice", 0)));
+    ASSERT_TRUE(service.Lock("/x/y/", make_lock("bob", 1)));
+    EXPECT_FALSE(service.Lock("/x/./z/../y", make_lock("alice", 0)));
+    EXPECT_THROW(static_cast<void>(service.Lock("../x", make_lock("alice", 0))), std::runtime_error);
+
+    EXPECT_EQ(service.GetAllLock("/x/y").size(), 2);
+    EXPECT_TRUE(service.IsLocked("/x/y/child"));
+
+    // the same name below another parent is another node
+    ASSERT_TRUE(service.Lock("/y/y", make_lock("alice", 0)));
+    EXPECT_TRUE(service.Unlock("/x/y", "alice"));
+    EXPECT_TRUE(service.Unlock("/x/y", "bob"));
+    EXPECT_TRUE(service.IsLocked("/y/y"));
+    EXPECT_TRUE(service.Unlock("/y/y", "alice"));
+    EXPECT_EQ(service.GetNodeCount(), 1);
+}
 
-class Service
+TEST(TestFileLock, ExpiredLocksAreDropped)
 {
-public:
-	Service()
-	{
-		root_ = new Entry();
-	}
-
-	~Service()
-	{
-		if (root_ == nullptr)
-		{
-			return;
-		}
-
-		delete root_;
-		root_ = nullptr;
-	}
-
-	void Lock(const std::filesystem::path& path, const EntryLock& lock)
-	{
-		std::list<std::string> cwd;
-		Entry* entry = root_;
-		std::string part_str;
-
-		for (const std::filesystem::path& part : path)
-		{
-			part_str = part.string();
-
-			if (part_str == "/")
-			{
-				entry = root_;
-				cwd.clear();
-				cwd.push_back("/");
-				continue;
-			}
-
-			if (part_str == ".")
-			{
-				continue;
-			}
-
-			if (part_str == "..")
-			{
-				if (entry->parent == nullptr)
-				{
-					throw std::runtime_error("Illegial path.");
-				}
-				entry = entry->parent;
-				cwd.pop_back();
-				continue;
-			}
-
-			std::list<Entry*>* sub_entry = entry->children;
-			if (sub_entry == nullptr)
-			{
-				entry->children = new std::list<Entry*>();
-				sub_entry = entry->children;
-			}
-
-			auto it = std::find_if(sub_entry->begin(), sub_entry->end(), [&part_str](const Entry* elm) { return elm->name == part_str; });
-			if (it == sub_entry->end())
-			{
-				auto new_entry = new Entry{};
-				new_entry->name = part_str;
-				for (const std::string& str : cwd)
-				{
-					new_entry->path /= str;
-				}
-				new_entry->path /= part_str;
-				new_entry->parent = entry;
-				sub_entry->push_back(new_entry);
-
-				entry = new_entry;
-				cwd.push_back(part_str);
-				continue;
-			}
-
-			entry = *it;
-			cwd.push_back(part_str);
-		}
-
-		entry->lock = new EntryLock(lock);
-	}
-
-	bool Unlock(const std::filesystem::path& path)
-	{
-		Entry* entry = FindEntry(path);
-		if (entry == nullptr)
-		{
-			return false;
-		}
-
-		delete entry->lock;
-		entry->lock = nullptr;
-		return true;
-	}
-
-	const EntryLock* GetLock(const std::filesystem::path& path)
-	{
-		const Entry* entry = FindLock(path);
-		if (entry == nullptr)
-		{
-			return nullptr;
-		}
-
-		return entry->lock;
-	}
-
-	bool IsLocked(const std::filesystem::path& path)
-	{
-		const Entry* entry = FindLock(path);
-
-		if (entry == nullptr || entry->lock == nullptr)
-		{
-			return false;
-		}
-
-		if (entry->path == path)
-		{
-			return true;
-		}
+    auto& service = FileLock::Service::GetInstance();
+    ASSERT_TRUE(service.Lock("/old/lock", make_lock("alice", 5, -10)));
 
-		short diff_depth = 0;
-		auto it1 = entry->path.begin();
-		auto it2 = path.begin();
-		while (it1 != entry->path.end() && it2 != path.end())
-		{
-			++it1;
-			++it2;
-		}
-
-		if (it1 == entry->path.end())
-		{
-			while (it2 != path.end())
-			{
-				++it2;
-				diff_depth += 1;
-			}
-		}
-		else
-		{
-			while (it1 != entry->path.end())
-			{
-				++it1;
-				diff_depth += 1;
-			}
-		}
-
-		return entry->lock->depth >= diff_depth;
-	}
-
-	bool LockExists(const std::filesystem::path& path)
-	{
-		return FindEntry(path) != nullptr;
-	}
-
-private:
-	struct Entry
-	{
-		std::string name = "";
-		std::filesystem::path path = "/";
-
-		EntryLock* lock = nullptr;
-		Entry* parent = nullptr;
-		std::list<Entry*>* children = nullptr;
-
-		Entry() = default;
-		~Entry()
-		{
-			if (lock != nullptr)
-			{
-				delete lock;
-				lock = nullptr;
-			}
-
-			if (children == nullptr)
-			{
-				return;
-			}
-
-			for (Entry* it : *children)
-			{
-				delete it;
-			}
-            delete children;
-			children = nullptr;
-		}
-	};
-
-	Entry* FindEntry(const std::filesystem::path& path)
-	{
-		Entry* entry = root_;
-
-		std::string part_str;
-		for (const std::filesystem::path& part : path)
-		{
-			part_str = part.string();
-			if (part_str == "/")
-			{
-				continue;
-			}
-
-			const std::list<Entry*>* sub_entry = entry->children;
-			if (sub_entry == nullptr)
-			{
-				return nullptr;
-			}
-
-			auto it = std::find_if(sub_entry->begin(), sub_entry->end(), [&part_str](const Entry* elm) { return elm->name == part_str; });
-			if (it == sub_entry->end())
-			{
-				return nullptr;
-			}
-
-			entry = *it;
-		}
-
-		return entry;
-	}
-
-	const Service::Entry* FindLock(const std::filesystem::path& path)
-	{
-		Entry* entry = root_;
-
-		std::string part_str;
-		for (const std::filesystem::path& part : path)
-		{
-			if (entry->lock != nullptr)
-			{
-				return entry;
-			}
-
-			part_str = part.string();
-			if (part_str == "/")
-			{
-				continue;
-			}
-
-			auto* sub_entry = entry->children;
-			if (sub_entry == nullptr)
-			{
-				return nullptr;
-			}
-
-			auto it = std::find_if(sub_entry->begin(), sub_entry->end(), [&part_str](const Entry* elm) { return elm->name == part_str; });
-			if (it == sub_entry->end())
-			{
-				return nullptr;
-			}
-
-			entry = *it;
-		}
-
-		return entry;
-	}
-
-	Entry* root_ = nullptr;
-};
+    EXPECT_FALSE(service.IsLocked("/old/lock/child"));
+    EXPECT_TRUE(service.GetAllLock("/old/lock").empty());
+    EXPECT_EQ(service.GetNodeCount(), 1);
+}
 
-void test()
+TEST(TestFileLock, ChecksWhileLocking)
 {
-	Service service{};
-
-	{ // set lock
-		EntryLock lock;
-		lock.depth = 3;
-		lock.token = "123";
-		service.Lock("/a/b", std::move(lock));
-	}
-
-	{ // locked
-		assert(service.IsLocked("/a/b"));
-		assert(service.IsLocked("/a/b/c/d/e"));
-		assert(!service.IsLocked("/a/b/c/d/e/f"));
-	}
-
-	{ // get lock
-		const EntryLock* lock = service.GetLock("/a/b");
-		assert(lock != nullptr);
-	}
-
-	{ // unlock
-		assert(service.Unlock("/a/b"));
-	}
-
-	{ // locked
-		assert(!service.IsLocked("/a/b"));
-		assert(!service.IsLocked("/a/b/c/d/e"));
-		assert(!service.IsLocked("/a/b/c/d/e/f"));
-	}
+    auto& service = FileLock::Service::GetInstance();
+    std::atomic<bool> done{false};
+
+    // the checks run against a trie that writers keep growing and pruning underneath them
+    std::vector<std::jthread> readers;
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&service, &done, i]() {
+            while (!done.load())
+            {
+                const std::string path = "/w/" + std::to_string(i) + "/f";
+                static_cast<void>(service.IsLocked(path + "/child"));
+                static_cast<void>(service.GetAllLock(path));
+                static_cast<void>(service.LockedByToken(path, "urn:uuid:alice"));
+            }
+        });
+    }
+
+    std::vector<std::jthread> writers;
+    for (int i = 0; i < 4; ++i)
+    {
+        writers.emplace_back([&service, i]() {
+            const std::string path = "/w/" + std::to_string(i) + "/f";
+            for (int round = 0; round < 2000; ++round)
+            {
+                EXPECT_TRUE(service.Lock(path, make_lock("alice", 1)));
+                EXPECT_TRUE(service.IsLocked(path + "/child"));
+                EXPECT_TRUE(service.Unlock(path, "alice"));
+            }
+        });
+    }
+
+    writers.clear();
+    done = true;
+    readers.clear();
+    EXPECT_EQ(service.GetNodeCount(), 1);
+    EXPECT_FALSE(service.IsLocked("/w/0/f"));
 }
 
-int main()
+int main(int argc, char** argv)
 {
-	test();
-
-	return 0;
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
 }
@@ -0,0 +1,87 @@
+#include "utils/blake3.h"
+#include "utils/hash.h"
+#include "utils/thread_pool.h"
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using utils::Blake3;
+using utils::hash::Algorithm;
+
+namespace fs = std::filesystem;
+
+// the input of the official BLAKE3 test vectors
+static std::string test_input(size_t size)
+{
+    std::string input(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+    {
+        input[i] = static_cast<char>(i % 251);
+    }
+    return input;
+}
+
+TEST(HashTest, Blake3KnownDigests)
+{
+    EXPECT_EQ(utils::hash::hex(test_input(0), Algorithm::BLAKE3), "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262");
+    EXPECT_EQ(utils::hash::hex(test_input(1), Algorithm::BLAKE3), "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213");
+    EXPECT_EQ(utils::hash::hex(test_input(1024), Algorithm::BLAKE3), "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7");
+    EXPECT_EQ(utils::hash::hex(test_input(1025), Algorithm::BLAKE3), "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444");
+    EXPECT_EQ(utils::hash::hex(test_input(102400), Algorithm::BLAKE3), "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085");
+}
+
+TEST(HashTest, Xxh3AndSha256KnownDigests)
+{
+    EXPECT_EQ(utils::hash::hex("", Algorithm::XXH3), "99aa06d3014798d86001c324468d497f");
+    EXPECT_EQ(utils::hash::hex("abc", Algorithm::SHA256), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(HashTest, Blake3SubtreesMatchSequentialHashing)
+{
+    const std::string input = test_input(3 * Blake3::SUBTREE_SIZE + 5);
+    const auto* bytes = reinterpret_cast<const uint8_t*>(input.data());
+
+    Blake3 sequential{};
+    sequential.Update(input);
+
+    Blake3 split{};
+    for (uint64_t i = 0; i < 3; ++i)
+    {
+        split.UpdateSubtree(Blake3::HashSubtree(bytes + i * Blake3::SUBTREE_SIZE, i));
+    }
+    split.Update(std::string_view{input}.substr(3 * Blake3::SUBTREE_SIZE));
+
+    EXPECT_TRUE(split.Final() == sequential.Final());
+}
+
+TEST(HashTest, FileMatchesInMemoryHash)
+{
+    const fs::path file = fs::temp_directory_path() / "davsync_test_hash.bin";
+    utils::WorkStealingPool pool{4};
+
+    // a whole number of subtrees makes the last one go through Update(), the others straddle it
+    for (const size_t size : {size_t{0}, size_t{100}, 2 * Blake3::SUBTREE_SIZE, 5 * Blake3::SUBTREE_SIZE + 4097})
+    {
+        const std::string input = test_input(size);
+        {
+            std::ofstream ofs{file, std::ios::binary | std::ios::trunc};
+            ofs.write(input.data(), static_cast<std::streamsize>(input.size()));
+        }
+
+        for (const Algorithm algorithm : {Algorithm::SHA256, Algorithm::BLAKE3, Algorithm::XXH3})
+        {
+            EXPECT_EQ(utils::hash::file_hex(file, algorithm, &pool), utils::hash::hex(input, algorithm))
+                << utils::hash::to_string(algorithm) << " " << size;
+        }
+    }
+
+    fs::remove(file);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
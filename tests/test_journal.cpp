@@ -0,0 +1,124 @@
+#include "utils/journal.h"
+#include "utils/mapped_table.h"
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using utils::Journal;
+using utils::MappedTable;
+
+namespace fs = std::filesystem;
+
+static fs::path make_temp_dir(const std::string& name)
+{
+    const fs::path dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+static std::vector<std::string> recover(const fs::path& base)
+{
+    std::vector<std::string> records;
+    Journal journal{base, 1024 * 1024, [](const Journal::EmitT&) {}};
+    journal.Open([&records](std::string_view record) { records.emplace_back(record); });
+    return records;
+}
+
+TEST(TestJournal, Fields)
+{
+    std::string record;
+    utils::journal::append_field(record, "S");
+    utils::journal::append_field(record, "/a@b,c");
+
+    std::string_view view = record;
+    EXPECT_EQ(utils::journal::read_field(view), "S");
+    EXPECT_EQ(utils::journal::read_field(view), "/a@b,c");
+    EXPECT_FALSE(utils::journal::read_field(view).has_value());
+    EXPECT_EQ(utils::journal::crc32("123456789"), 0xCBF43926u);
+}
+
+TEST(TestJournal, ReplaysSegmentsAfterCrash)
+{
+    const fs::path dir = make_temp_dir("davsync_test_journal_crash");
+    const fs::path base = dir / "etag.dat";
+    const fs::path copy = dir / "copy";
+    fs::create_directories(copy);
+
+    {
+        Journal journal{base, 1024 * 1024, [](const Journal::EmitT&) {}};
+        EXPECT_TRUE(journal.Open([](std::string_view) {}));
+        journal.Append("one");
+        journal.WaitDurable(journal.Append("two"));
+
+        // what is on disk at this point is what a crash would leave behind
+        for (const auto& entry : fs::directory_iterator{dir})
+        {
+            if (entry.is_regular_file())
+            {
+                fs::copy_file(entry.path(), copy / entry.path().filename());
+            }
+        }
+    }
+
+    // a record cut in half by the crash is dropped, the ones before it are kept
+    const fs::path segment = copy / "etag.dat.journal.1";
+    {
+        std::ofstream ofs{segment, std::ios::binary | std::ios::app};
+        ofs.write("\x10\x00\x00\x00\x01\x02", 6);
+    }
+
+    EXPECT_EQ(recover(copy / "etag.dat"), (std::vector<std::string>{"one", "two"}));
+    fs::remove_all(dir);
+}
+
+TEST(TestJournal, CompactsIntoTable)
+{
+    const fs::path dir = make_temp_dir("davsync_test_journal_snapshot");
+    const fs::path base = dir / "prop.dat";
+
+    std::vector<MappedTable::EntryT> state;
+    {
+        Journal journal{base, 1024 * 1024, [&state](const Journal::EmitT& emit) {
+                            for (const auto& [key, value] : state)
+                            {
+                                emit(key, value);
+                            }
+                        }};
+        EXPECT_TRUE(journal.Open([](std::string_view) {}));
+        for (const std::string key : {"/c", "/a", "/b"})
+        {
+            state.emplace_back(key, key + "-value");
+            journal.Append(key);
+        }
+    }
+
+    // the final snapshot replaced the segments, nothing is left to replay
+    EXPECT_FALSE(fs::exists(dir / "prop.dat.journal.1"));
+
+    const auto table = MappedTable::Open(base);
+    ASSERT_TRUE(table != nullptr);
+    EXPECT_TRUE(table->VerifyBody());
+    EXPECT_EQ(table->Size(), 3);
+    EXPECT_EQ(table->Find("/b"), "/b-value");
+    EXPECT_FALSE(table->Find("/d").has_value());
+
+    std::string keys;
+    table->ForEach([&keys](std::string_view key, std::string_view) {
+        keys += key;
+        return true;
+    });
+    EXPECT_EQ(keys, "/a/b/c");
+
+    EXPECT_TRUE(recover(base).empty());
+    fs::remove_all(dir);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,80 @@
+#include "utils/range.h"
+#include <gtest/gtest.h>
+
+using utils::range::ByteRange;
+
+TEST(TestRange, SingleRange)
+{
+    auto ranges = utils::range::parse_range("bytes=0-99", 1000);
+    ASSERT_TRUE(ranges.has_value());
+    ASSERT_EQ(ranges->size(), 1);
+    EXPECT_EQ(ranges->front(), (ByteRange{0, 99}));
+    EXPECT_EQ(ranges->front().length(), 100);
+}
+
+TEST(TestRange, OpenAndSuffixRange)
+{
+    auto open_ranges = utils::range::parse_range("bytes=900-", 1000);
+    ASSERT_TRUE(open_ranges.has_value());
+    EXPECT_EQ(open_ranges->front(), (ByteRange{900, 999}));
+
+    auto suffix_ranges = utils::range::parse_range("bytes=-100", 1000);
+    ASSERT_TRUE(suffix_ranges.has_value());
+    EXPECT_EQ(suffix_ranges->front(), (ByteRange{900, 999}));
+
+    auto clamped_ranges = utils::range::parse_range("bytes=-5000", 1000);
+    ASSERT_TRUE(clamped_ranges.has_value());
+    EXPECT_EQ(clamped_ranges->front(), (ByteRange{0, 999}));
+}
+
+TEST(TestRange, MultipleRanges)
+{
+    auto ranges = utils::range::parse_range("bytes=500-599, 0-9", 1000);
+    ASSERT_TRUE(ranges.has_value());
+    ASSERT_EQ(ranges->size(), 2);
+    EXPECT_EQ((*ranges)[0], (ByteRange{0, 9}));
+    EXPECT_EQ((*ranges)[1], (ByteRange{500, 599}));
+
+    auto merged = utils::range::parse_range("bytes=0-9,5-19,20-29", 1000);
+    ASSERT_TRUE(merged.has_value());
+    ASSERT_EQ(merged->size(), 1);
+    EXPECT_EQ(merged->front(), (ByteRange{0, 29}));
+}
+
+TEST(TestRange, Unsatisfiable)
+{
+    auto ranges = utils::range::parse_range("bytes=2000-", 1000);
+    ASSERT_TRUE(ranges.has_value());
+    EXPECT_TRUE(ranges->empty());
+
+    auto partially = utils::range::parse_range("bytes=2000-,0-0", 1000);
+    ASSERT_TRUE(partially.has_value());
+    EXPECT_EQ(partially->size(), 1);
+}
+
+TEST(TestRange, Malformed)
+{
+    EXPECT_FALSE(utils::range::parse_range("items=0-9", 1000).has_value());
+    EXPECT_FALSE(utils::range::parse_range("bytes=9-0", 1000).has_value());
+    EXPECT_FALSE(utils::range::parse_range("bytes=a-b", 1000).has_value());
+    EXPECT_FALSE(utils::range::parse_range("bytes=", 1000).has_value());
+}
+
+TEST(TestRange, IfRange)
+{
+    constexpr std::time_t last_modified = 784111777; // Sun, 06 Nov 1994 08:49:37 GMT
+
+    EXPECT_TRUE(utils::range::if_range_matches("", "abc", last_modified));
+    EXPECT_TRUE(utils::range::if_range_matches("abc", "abc", last_modified));
+    EXPECT_TRUE(utils::range::if_range_matches("\"abc\"", "abc", last_modified));
+    EXPECT_FALSE(utils::range::if_range_matches("W/\"abc\"", "abc", last_modified));
+    EXPECT_FALSE(utils::range::if_range_matches("\"def\"", "abc", last_modified));
+    EXPECT_TRUE(utils::range::if_range_matches("Sun, 06 Nov 1994 08:49:37 GMT", "abc", last_modified));
+    EXPECT_FALSE(utils::range::if_range_matches("Sun, 06 Nov 1994 08:49:38 GMT", "abc", last_modified));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,65 @@
+#include "utils/resp.h"
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+using utils::resp::Reply;
+
+TEST(TestResp, EncodeIsBinarySafe)
+{
+    std::string out;
+    utils::resp::encode(out, {"SET", "etag:/a b/\"c\"", std::string_view{"x\r\ny", 4}});
+    EXPECT_EQ(out, std::string{"*3\r\n$3\r\nSET\r\n$13\r\netag:/a b/\"c\"\r\n$4\r\nx\r\ny\r\n"});
+}
+
+TEST(TestResp, ParseScalars)
+{
+    std::string_view buffer = "+OK\r\n-ERR wrong\r\n:42\r\n$5\r\nhe\r\no\r\n$-1\r\n";
+
+    auto reply = utils::resp::parse(buffer);
+    ASSERT_TRUE(reply.has_value());
+    EXPECT_TRUE(reply->type == Reply::Type::Status);
+    EXPECT_EQ(reply->str, "OK");
+
+    reply = utils::resp::parse(buffer);
+    EXPECT_TRUE(reply->type == Reply::Type::Error);
+    EXPECT_EQ(reply->str, "ERR wrong");
+
+    reply = utils::resp::parse(buffer);
+    EXPECT_TRUE(reply->type == Reply::Type::Integer);
+    EXPECT_EQ(reply->integer, 42);
+
+    reply = utils::resp::parse(buffer);
+    EXPECT_TRUE(reply->type == Reply::Type::String);
+    EXPECT_EQ(reply->str, "he\r\no");
+
+    reply = utils::resp::parse(buffer);
+    EXPECT_TRUE(reply->type == Reply::Type::Nil);
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(TestResp, ParseWaitsForTheWholeReply)
+{
+    const std::string full = "*2\r\n$3\r\nkey\r\n$5\r\nvalue\r\n";
+    for (size_t size = 0; size < full.size(); ++size)
+    {
+        std::string_view partial{full.data(), size};
+        EXPECT_FALSE(utils::resp::parse(partial).has_value());
+        EXPECT_EQ(partial.size(), size);
+    }
+
+    std::string_view buffer = full;
+    const auto reply = utils::resp::parse(buffer);
+    ASSERT_TRUE(reply.has_value());
+    ASSERT_EQ(reply->elements.size(), 2);
+    EXPECT_EQ(reply->elements[0].str, "key");
+    EXPECT_EQ(reply->elements[1].str, "value");
+    EXPECT_TRUE(buffer.empty());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
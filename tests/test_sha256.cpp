@@ -0,0 +1,69 @@
+#include "utils/sha256.h"
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using utils::Sha256;
+using utils::Sha256Backend;
+
+static std::string hash(const std::string& text, Sha256Backend backend)
+{
+    Sha256 hasher{backend};
+    hasher.Update(text);
+    return hasher.FinalHex();
+}
+
+static std::vector<Sha256Backend> backends()
+{
+    std::vector<Sha256Backend> backends{Sha256Backend::SCALAR};
+    if (utils::sha256_backend() != Sha256Backend::SCALAR)
+    {
+        backends.push_back(utils::sha256_backend());
+    }
+    return backends;
+}
+
+TEST(Sha256Test, KnownDigests)
+{
+    for (const Sha256Backend backend : backends())
+    {
+        SCOPED_TRACE(std::string{utils::to_string(backend)});
+        EXPECT_EQ(hash("", backend), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        EXPECT_EQ(hash("abc", backend), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        EXPECT_EQ(hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", backend),
+                  "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+        EXPECT_EQ(hash(std::string(1000000, 'a'), backend), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+    }
+}
+
+TEST(Sha256Test, StreamingMatchesOneShot)
+{
+    std::string data(5000, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<char>(i * 131 + 7);
+    }
+
+    for (const Sha256Backend backend : backends())
+    {
+        const std::string expected = hash(data, backend);
+
+        // chunk sizes that straddle block boundaries in every way
+        for (const size_t chunk : {1, 3, 63, 64, 65, 1000})
+        {
+            Sha256 hasher{backend};
+            for (size_t offset = 0; offset < data.size(); offset += chunk)
+            {
+                hasher.Update(std::string_view{data}.substr(offset, chunk));
+            }
+            EXPECT_EQ(hasher.FinalHex(), expected) << utils::to_string(backend) << " chunk " << chunk;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
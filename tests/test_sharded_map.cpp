@@ -0,0 +1,83 @@
+#include "utils/sharded_map.h"
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using utils::ShardedMap;
+
+TEST(TestShardedMap, InsertFindErase)
+{
+    ShardedMap<std::string, int> map;
+    EXPECT_FALSE(map.Find("a").has_value());
+
+    map.InsertOrAssign("a", 1);
+    map.InsertOrAssign("b", 2);
+    map.InsertOrAssign("a", 3);
+    EXPECT_EQ(map.Size(), 2);
+    EXPECT_EQ(map.Find("a"), 3);
+
+    EXPECT_FALSE(map.EraseIf("a", [](int value) { return value == 1; }));
+    EXPECT_TRUE(map.EraseIf("a", [](int value) { return value == 3; }));
+    EXPECT_TRUE(map.Erase("b"));
+    EXPECT_FALSE(map.Erase("b"));
+    EXPECT_EQ(map.Size(), 0);
+}
+
+TEST(TestShardedMap, EraseIfAll)
+{
+    ShardedMap<std::string, int> map;
+    for (int i = 0; i < 100; ++i)
+    {
+        map.InsertOrAssign(std::to_string(i), i % 2);
+    }
+
+    EXPECT_EQ(map.EraseIf([](int value) { return value == 0; }), 50);
+    EXPECT_EQ(map.Size(), 50);
+    EXPECT_FALSE(map.Find("0").has_value());
+    EXPECT_EQ(map.Find("1"), 1);
+}
+
+TEST(TestShardedMap, UpdateAndModify)
+{
+    ShardedMap<std::string, std::vector<int>> map;
+    EXPECT_FALSE(map.Modify("a", [](std::vector<int>& values) { values.push_back(0); }));
+
+    map.Update("a", [](std::vector<int>& values) { values.push_back(1); });
+    EXPECT_TRUE(map.Modify("a", [](std::vector<int>& values) { values.push_back(2); }));
+    EXPECT_EQ(map.Find("a"), (std::vector<int>{1, 2}));
+}
+
+TEST(TestShardedMap, ConcurrentWriters)
+{
+    constexpr int THREADS = 8;
+    constexpr int KEYS_PER_THREAD = 2000;
+
+    ShardedMap<std::string, int> map;
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            threads.emplace_back([&map, t]() {
+                for (int i = 0; i < KEYS_PER_THREAD; ++i)
+                {
+                    map.InsertOrAssign(std::to_string(t) + "/" + std::to_string(i), i);
+                    EXPECT_EQ(map.Find(std::to_string(t) + "/" + std::to_string(i / 2)), i / 2);
+                }
+            });
+        }
+    }
+
+    EXPECT_EQ(map.Size(), THREADS * KEYS_PER_THREAD);
+
+    size_t visited = 0;
+    map.ForEach([&visited](const std::string&, int) { ++visited; });
+    EXPECT_EQ(visited, THREADS * KEYS_PER_THREAD);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
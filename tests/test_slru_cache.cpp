@@ -0,0 +1,59 @@
+#include "utils/slru_cache.h"
+#include <gtest/gtest.h>
+
+#include <string>
+
+using Cache = utils::SlruCache<std::string, std::string, std::hash<std::string>, 2>;
+
+// one byte per entry, so the budget is a number of entries per shard
+static Cache make_cache(size_t entries_per_shard)
+{
+    return Cache{entries_per_shard * 2, [](const std::string&, const std::string&) { return size_t{1}; }};
+}
+
+TEST(TestSlruCache, HitMissAndInvalidate)
+{
+    Cache cache = make_cache(16);
+
+    auto lookup = cache.Get("a");
+    EXPECT_FALSE(lookup.value.has_value());
+    EXPECT_TRUE(cache.Put("a", "1", lookup.ticket));
+    EXPECT_EQ(cache.Get("a").value, std::string{"1"});
+
+    // a miss fetched before the invalidation must not be cached after it
+    lookup = cache.Get("b");
+    cache.Invalidate("b");
+    EXPECT_FALSE(cache.Put("b", "stale", lookup.ticket));
+    EXPECT_FALSE(cache.Get("b").value.has_value());
+
+    const auto stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 3);
+}
+
+TEST(TestSlruCache, ScanDoesNotEvictHotEntries)
+{
+    Cache cache = make_cache(10);
+    for (const char* key : {"hot1", "hot2"})
+    {
+        cache.Put(key, key, cache.Get(key).ticket);
+        EXPECT_TRUE(cache.Get(key).value.has_value());
+    }
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        const std::string key = "cold" + std::to_string(i);
+        cache.Put(key, key, cache.Get(key).ticket);
+    }
+
+    EXPECT_TRUE(cache.Get("hot1").value.has_value());
+    EXPECT_TRUE(cache.Get("hot2").value.has_value());
+    EXPECT_TRUE(cache.GetStats().evictions > 0);
+    EXPECT_TRUE(cache.GetStats().memory_usage <= 20);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}